@@ -0,0 +1,54 @@
+#ifndef H_CPU_AFFINITY_H_
+#define H_CPU_AFFINITY_H_
+
+#include <iostream>
+#include <pthread.h>
+#include <sched.h>
+
+using namespace std;
+
+/*
+ * Moves the calling thread onto a single CPU for as long as it is in scope, then
+ * puts back the CPUs it was allowed on before. A CPU of -1 leaves the thread alone.
+ */
+class ScopedCpuAffinity
+{
+public:
+	ScopedCpuAffinity(const int CPU) : pinned(false)
+	{
+		if(CPU < 0 || pthread_getaffinity_np(pthread_self(), sizeof(previousCpus), &previousCpus) != 0)
+		{
+			return;
+		}
+
+		cpu_set_t cpus;
+		CPU_ZERO(&cpus);
+		CPU_SET(CPU, &cpus);
+
+		this->pinned = (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0);
+
+		if(!this->pinned)
+		{
+			cout << "Warning: ScopedCpuAffinity - Could not move the thread to CPU " << CPU << endl;
+		}
+	}
+
+	~ScopedCpuAffinity()
+	{
+		if(this->pinned)
+		{
+			pthread_setaffinity_np(pthread_self(), sizeof(previousCpus), &previousCpus);
+		}
+	}
+
+	ScopedCpuAffinity(const ScopedCpuAffinity &) = delete;
+	ScopedCpuAffinity &operator=(const ScopedCpuAffinity &) = delete;
+
+	bool isPinned(void) const { return pinned; }
+
+private:
+	bool pinned;
+	cpu_set_t previousCpus;
+};
+
+#endif /* H_CPU_AFFINITY_H_ */
@@ -0,0 +1,333 @@
+#ifndef H_EDGE_COUNTER_H_
+#define H_EDGE_COUNTER_H_
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+#include "GpioBase.h"
+#include "MemMap.h"
+#include "PinTable.h"
+#include "Timestamp.h"
+#include "CpuAffinity.h"
+
+/*
+ * Counts edges on many pins without a wakeup per edge, e.g. flow meters and
+ * tachometers. The GPIO module latches every detected edge into IRQSTATUS_RAW_0,
+ * whether or not the interrupt is enabled. harvest() reads that register once for
+ * each bank holding counted pins, clears the bits it found (IRQSTATUS_0 is write 1
+ * to clear) and adds one to the count of each pin. The cost per harvest does not
+ * depend on the number of edges.
+ *
+ * A status bit latches at most one edge between two harvests, so a pin can be
+ * counted up to half the harvest rate for EDGE::BOTH and up to the harvest rate for
+ * RISING or FALLING. Faster signals are undercounted.
+ *
+ * The counted pins must not also have their edges delivered through sysfs: the
+ * kernel would clear the status bits before they are harvested.
+ *
+ * REGISTERS is MemMap on the board or a model of the banks (see updateBits()).
+ * The pins must already be muxed and set as inputs.
+ */
+template<typename REGISTERS = MemMap>
+class EdgeCounter
+{
+public:
+	/*
+	 * Description:
+	 * 	Arm edge detection on the pins and clear any edge already latched.
+	 *
+	 * Args:
+	 * 	registers The register file the pins are in
+	 * 	gpioPins The GPIO numbers of the pins to count
+	 * 	edgeType The edges counted: RISING, FALLING or BOTH
+	 * 	windowNs The period over which getFrequencyHz() is averaged
+	 */
+	EdgeCounter(REGISTERS &registers, const vector<unsigned int> &gpioPins, GpioBase::EDGE edgeType = GpioBase::EDGE::RISING,
+				uint64_t windowNs = 1000000000ULL) :
+		registers(registers), pins(gpioPins.size()), edgeType(edgeType), windowNs(windowNs), windowStartNs(0),
+		harvestCount(0), missedHarvestCount(0), running(false)
+	{
+		for(unsigned int bank = 0; bank < GPIO_BANKS; ++bank)
+		{
+			this->bankMasks[bank] = 0;
+			this->previousRising[bank] = 0;
+			this->previousFalling[bank] = 0;
+
+			for(unsigned int bit = 0; bit < 32; ++bit)
+			{
+				this->pinIndex[bank][bit] = -1;
+			}
+		}
+
+		for(size_t index = 0; index < gpioPins.size(); ++index)
+		{
+			PinCount &pin = this->pins[index];
+			pin.gpio = gpioPins[index];
+
+			if(gpioPins[index] >= GPIO_COUNT)
+			{
+				cout << "ERROR: EdgeCounter - GPIO " << gpioPins[index] << " does not exist" << endl;
+				continue;
+			}
+
+			const PinDescriptor &DESCRIPTOR = getPinDescriptor(gpioPins[index]);
+
+			this->bankMasks[(unsigned int)DESCRIPTOR.bank] |= DESCRIPTOR.mask;
+			this->pinIndex[(unsigned int)DESCRIPTOR.bank][__builtin_ctz(DESCRIPTOR.mask)] = (int)index;
+		}
+
+		for(unsigned int bank = 0; bank < GPIO_BANKS; ++bank)
+		{
+			if(this->bankMasks[bank] != 0)
+			{
+				this->usedBanks.push_back((MemMap::BANK)bank);
+			}
+		}
+
+		arm();
+		this->windowStartNs = monotonicTimeNs();
+	}
+
+	/*
+	 * Destructor. Stops the harvest thread and puts the detect registers back as they were.
+	 */
+	~EdgeCounter()
+	{
+		stop();
+		disarm();
+	}
+
+	EdgeCounter(const EdgeCounter &) = delete;
+	EdgeCounter &operator=(const EdgeCounter &) = delete;
+
+	/*
+	 * Description:
+	 * 	Collect the edges latched since the last harvest: one read, and one store if
+	 * 	anything was latched, per bank. Called by the harvest thread, or straight from
+	 * 	the caller's own loop when start() is not used (never both).
+	 *
+	 * Return
+	 * 	The number of edges counted
+	 */
+	unsigned int harvest(void)
+	{
+		unsigned int counted = 0;
+
+		for(const MemMap::BANK BANK : this->usedBanks)
+		{
+			uint32_t latched = this->registers.read(BANK, GPIO_IRQSTATUS_RAW_0_OFFSET) & this->bankMasks[(unsigned int)BANK];
+
+			if(latched == 0)
+			{
+				continue;
+			}
+
+			this->registers.write(BANK, GPIO_IRQSTATUS_0_OFFSET, latched);
+
+			while(latched != 0)
+			{
+				const unsigned int BIT = __builtin_ctz(latched);
+				this->pins[this->pinIndex[(unsigned int)BANK][BIT]].count.fetch_add(1, memory_order_relaxed);
+
+				latched &= latched - 1;
+				counted++;
+			}
+		}
+
+		this->harvestCount.fetch_add(1, memory_order_relaxed);
+
+		const uint64_t NOW = monotonicTimeNs();
+
+		if(NOW - this->windowStartNs >= this->windowNs)
+		{
+			updateFrequencies(NOW);
+		}
+
+		return counted;
+	}
+
+	/*
+	 * Description:
+	 * 	Harvest every PERIOD_NS on a thread of its own until stop(). The thread
+	 * 	sleeps between harvests, so it costs the same whatever the edge rate.
+	 *
+	 * Args:
+	 * 	PERIOD_NS The time between two harvests: at most one edge per pin is counted per period
+	 * 	CPU The CPU to run the thread on, -1 for any
+	 *
+	 * Return
+	 * 	False if the thread is already running
+	 */
+	bool start(const uint64_t PERIOD_NS, const int CPU = -1)
+	{
+		if(this->running.exchange(true))
+		{
+			cout << "ERROR: EdgeCounter::start - The harvest thread is already running" << endl;
+			return false;
+		}
+
+		this->harvester = thread(&EdgeCounter::run, this, PERIOD_NS == 0 ? 1 : PERIOD_NS, CPU);
+		return true;
+	}
+
+	/*
+	 * Description:
+	 * 	Stop the harvest thread after one last harvest.
+	 */
+	void stop(void)
+	{
+		this->running.store(false);
+
+		if(this->harvester.joinable())
+		{
+			this->harvester.join();
+		}
+	}
+
+	/*
+	 * Description:
+	 * 	The edges counted on a pin since the counter was created. Can be called from any thread.
+	 */
+	uint64_t getCount(const unsigned int GPIO_PIN) const
+	{
+		const PinCount *pin = findPin(GPIO_PIN);
+		return (pin == nullptr) ? 0 : pin->count.load(memory_order_relaxed);
+	}
+
+	/*
+	 * Description:
+	 * 	The edge rate of a pin over the last complete window. Can be called from any thread.
+	 */
+	double getFrequencyHz(const unsigned int GPIO_PIN) const
+	{
+		const PinCount *pin = findPin(GPIO_PIN);
+		return (pin == nullptr) ? 0 : pin->frequencyHz.load(memory_order_relaxed);
+	}
+
+	uint64_t getHarvestCount(void) const { return harvestCount.load(memory_order_relaxed); }
+
+	/* Periods the harvest thread slept through: edges of those periods may have been merged */
+	uint64_t getMissedHarvestCount(void) const { return missedHarvestCount.load(memory_order_relaxed); }
+
+private:
+	struct PinCount
+	{
+		unsigned int gpio;
+		atomic<uint64_t> count;
+		uint64_t windowCount;   //count at the start of the current window
+		atomic<double> frequencyHz;
+
+		PinCount() : gpio(INVALID_GPIO), count(0), windowCount(0), frequencyHz(0) {}
+	};
+
+	REGISTERS &registers;
+	vector<PinCount> pins;
+	vector<MemMap::BANK> usedBanks;
+	uint32_t bankMasks[GPIO_BANKS];
+	int pinIndex[GPIO_BANKS][32]; //Bit of a bank to index in pins, -1 if not counted
+
+	GpioBase::EDGE edgeType;
+	uint32_t previousRising[GPIO_BANKS];  //The detect bits of the counted pins before arm()
+	uint32_t previousFalling[GPIO_BANKS];
+
+	uint64_t windowNs;
+	uint64_t windowStartNs;
+
+	atomic<uint64_t> harvestCount;
+	atomic<uint64_t> missedHarvestCount;
+	atomic<bool> running;
+	thread harvester;
+
+	const PinCount *findPin(const unsigned int GPIO_PIN) const
+	{
+		for(const PinCount &pin : this->pins)
+		{
+			if(pin.gpio == GPIO_PIN)
+			{
+				return &pin;
+			}
+		}
+
+		return nullptr;
+	}
+
+	void updateFrequencies(const uint64_t NOW)
+	{
+		const double SECONDS = (double)(NOW - this->windowStartNs) / 1e9;
+
+		for(PinCount &pin : this->pins)
+		{
+			const uint64_t COUNT = pin.count.load(memory_order_relaxed);
+
+			pin.frequencyHz.store((double)(COUNT - pin.windowCount) / SECONDS, memory_order_relaxed);
+			pin.windowCount = COUNT;
+		}
+
+		this->windowStartNs = NOW;
+	}
+
+	void run(const uint64_t PERIOD_NS, const int CPU)
+	{
+		ScopedCpuAffinity affinity(CPU);
+
+		uint64_t deadline = monotonicTimeNs();
+
+		while(this->running.load(memory_order_relaxed))
+		{
+			deadline += PERIOD_NS;
+			sleepUntilNs(deadline);
+
+			harvest();
+
+			//Woken up whole periods late: restart the schedule rather than harvesting back to back
+			const uint64_t NOW = monotonicTimeNs();
+			if(NOW - deadline >= PERIOD_NS)
+			{
+				this->missedHarvestCount.fetch_add((NOW - deadline) / PERIOD_NS, memory_order_relaxed);
+				deadline = NOW;
+			}
+		}
+
+		harvest();
+	}
+
+	/*
+	 * Set the detect bits of the counted pins, then clear whatever they had latched
+	 * before.
+	 */
+	void arm(void)
+	{
+		const bool RISING = (this->edgeType == GpioBase::EDGE::RISING || this->edgeType == GpioBase::EDGE::BOTH);
+		const bool FALLING = (this->edgeType == GpioBase::EDGE::FALLING || this->edgeType == GpioBase::EDGE::BOTH);
+
+		for(const MemMap::BANK BANK : this->usedBanks)
+		{
+			const uint32_t MASK = this->bankMasks[(unsigned int)BANK];
+
+			this->previousRising[(unsigned int)BANK] = readBits(this->registers, BANK, GPIO_RISINGDETECT_OFFSET) & MASK;
+			this->previousFalling[(unsigned int)BANK] = readBits(this->registers, BANK, GPIO_FALLINGDETECT_OFFSET) & MASK;
+
+			setDetect(BANK, MASK, RISING ? MASK : 0, FALLING ? MASK : 0);
+			this->registers.write(BANK, GPIO_IRQSTATUS_0_OFFSET, MASK);
+		}
+	}
+
+	void disarm(void)
+	{
+		for(const MemMap::BANK BANK : this->usedBanks)
+		{
+			setDetect(BANK, this->bankMasks[(unsigned int)BANK], this->previousRising[(unsigned int)BANK],
+					  this->previousFalling[(unsigned int)BANK]);
+		}
+	}
+
+	void setDetect(const MemMap::BANK BANK, const uint32_t MASK, const uint32_t RISING, const uint32_t FALLING)
+	{
+		updateBits(this->registers, BANK, GPIO_RISINGDETECT_OFFSET, MASK, RISING);
+		updateBits(this->registers, BANK, GPIO_FALLINGDETECT_OFFSET, MASK, FALLING);
+	}
+};
+
+#endif /* H_EDGE_COUNTER_H_ */
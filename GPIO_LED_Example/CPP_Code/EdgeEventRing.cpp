@@ -0,0 +1,27 @@
+#include "EdgeEventRing.h"
+
+/*
+ * Description:
+ * 	Allocate the ring up front, nothing is allocated when pushing or draining.
+ *
+ * Args:
+ * 	capacity The maximum number of queued events, rounded up to a power of two
+ */
+EdgeEventRing::EdgeEventRing(size_t capacity) : capacity(1), mask(0), head(0), tailCache(0),
+	droppedCount(0), tail(0)
+{
+	while(this->capacity < capacity)
+	{
+		this->capacity <<= 1;
+	}
+
+	this->mask = this->capacity - 1;
+	this->events.reset(new EdgeEvent[this->capacity]()); //Zeroed, so the pages are touched now rather than on the first push
+}
+
+/*
+ * Destructor
+ */
+EdgeEventRing::~EdgeEventRing()
+{
+}
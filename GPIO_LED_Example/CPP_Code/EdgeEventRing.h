@@ -0,0 +1,103 @@
+#ifndef H_EDGE_EVENT_RING_H_
+#define H_EDGE_EVENT_RING_H_
+
+#include <atomic>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "GpioBase.h"
+
+/* A single detected edge, as stored in the EdgeEventRing */
+struct EdgeEvent
+{
+	uint64_t timestampNs; //CLOCK_MONOTONIC time taken right after epoll_wait() returned
+	uint32_t pin;         //GPIO pin number
+	GpioBase::EDGE edge;      //RISING or FALLING (BOTH if the direction could not be read)
+};
+
+/*
+ * Bounded single-producer/single-consumer lock-free queue of edge events. The
+ * edge-polling thread pushes, and one consumer thread at a time drains events in
+ * batches, so a slow consumer never delays the detection of the next edge.
+ *
+ * When the ring is full the new event is dropped and counted, see getDroppedCount().
+ */
+class EdgeEventRing
+{
+public:
+	EdgeEventRing(size_t capacity);
+	~EdgeEventRing();
+
+	EdgeEventRing(const EdgeEventRing &) = delete;
+	EdgeEventRing &operator=(const EdgeEventRing &) = delete;
+
+	/*
+	 * Producer side. Returns false (and counts the event as dropped) if the ring is full.
+	 */
+	inline bool push(const EdgeEvent &event)
+	{
+		const size_t HEAD = head.load(memory_order_relaxed);
+
+		if(HEAD - tailCache == capacity)
+		{
+			tailCache = tail.load(memory_order_acquire);
+
+			if(HEAD - tailCache == capacity)
+			{
+				droppedCount.store(droppedCount.load(memory_order_relaxed) + 1, memory_order_relaxed);
+				return false;
+			}
+		}
+
+		events[HEAD & mask] = event;
+		head.store(HEAD + 1, memory_order_release);
+		return true;
+	}
+
+	/*
+	 * Consumer side. Copies up to MAX_EVENTS of the oldest events into batch.
+	 * Returns the number of events copied.
+	 */
+	inline size_t drain(EdgeEvent *batch, const size_t MAX_EVENTS)
+	{
+		const size_t TAIL = tail.load(memory_order_relaxed);
+		const size_t HEAD = head.load(memory_order_acquire);
+
+		size_t count = HEAD - TAIL;
+		if(count > MAX_EVENTS)
+		{
+			count = MAX_EVENTS;
+		}
+
+		for(size_t index = 0; index < count; ++index)
+		{
+			batch[index] = events[(TAIL + index) & mask];
+		}
+
+		tail.store(TAIL + count, memory_order_release);
+		return count;
+	}
+
+	size_t getCapacity(void) const { return capacity; }
+	size_t size(void) const { return head.load(memory_order_acquire) - tail.load(memory_order_acquire); }
+
+	uint64_t getPushedCount(void) const { return head.load(memory_order_acquire); }
+	uint64_t getDroppedCount(void) const { return droppedCount.load(memory_order_relaxed); }
+
+private:
+	static const size_t CACHE_LINE_SIZE = 64;
+
+	size_t capacity; //Always a power of two
+	size_t mask;
+	unique_ptr<EdgeEvent[]> events;
+
+	//Producer and consumer indices live on separate cache lines so they don't bounce between cores.
+	alignas(CACHE_LINE_SIZE) atomic<size_t> head;
+	size_t tailCache; //Producer's last seen value of tail
+	atomic<uint64_t> droppedCount;
+
+	alignas(CACHE_LINE_SIZE) atomic<size_t> tail;
+};
+
+#endif /* H_EDGE_EVENT_RING_H_ */
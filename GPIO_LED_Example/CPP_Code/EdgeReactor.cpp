@@ -0,0 +1,591 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <mutex>
+#include <new>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+#include "EdgeReactor.h"
+#include "EdgeStatistics.h"
+#include "Timestamp.h"
+
+/* ************************************************************************
+ * EdgeFramePool
+ * ************************************************************************/
+alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) static unsigned char frames[EdgeFramePool::FRAME_COUNT][EdgeFramePool::FRAME_SIZE];
+static unsigned int freeFrames[EdgeFramePool::FRAME_COUNT];
+static unsigned int freeFrameCount = 0;
+static bool framesInitialised = false;
+static uint64_t heapAllocationCount = 0;
+static mutex framesMutex;
+
+void *EdgeFramePool::allocate(const size_t SIZE)
+{
+	{
+		lock_guard<mutex> lock(framesMutex);
+
+		if(!framesInitialised)
+		{
+			for(unsigned int frame = 0; frame < FRAME_COUNT; ++frame)
+			{
+				freeFrames[frame] = FRAME_COUNT - 1 - frame;
+			}
+
+			freeFrameCount = FRAME_COUNT;
+			framesInitialised = true;
+		}
+
+		if(SIZE <= FRAME_SIZE && freeFrameCount > 0)
+		{
+			return frames[freeFrames[--freeFrameCount]];
+		}
+
+		heapAllocationCount++;
+	}
+
+	return ::operator new(SIZE);
+}
+
+void EdgeFramePool::release(void *frame)
+{
+	unsigned char *const FRAME = static_cast<unsigned char*>(frame);
+	unsigned char *const FIRST = &frames[0][0];
+
+	if(FRAME >= FIRST && FRAME < FIRST + FRAME_COUNT * FRAME_SIZE)
+	{
+		lock_guard<mutex> lock(framesMutex);
+		freeFrames[freeFrameCount++] = (unsigned int)((FRAME - FIRST) / FRAME_SIZE);
+		return;
+	}
+
+	::operator delete(frame);
+}
+
+uint64_t EdgeFramePool::getHeapAllocationCount(void)
+{
+	lock_guard<mutex> lock(framesMutex);
+	return heapAllocationCount;
+}
+
+/* ************************************************************************
+ * EdgeReactor
+ * ************************************************************************/
+
+/*
+ * Description:
+ * 	Create the epoll set, the timerfd for timeouts and the eventfd used by stop().
+ *
+ * Args:
+ * 	maxTasks The number of tasks expected to be alive at once, the queues are sized for it
+ * 	maxEvents The maximum number of ready descriptors handled per call to epoll_wait()
+ */
+EdgeReactor::EdgeReactor(unsigned int maxTasks, unsigned int maxEvents) : epollFileDescriptor(-1),
+	timerFileDescriptor(-1), wakeupFileDescriptor(-1), taskCount(0), stopRequested(false), armedDeadlineNs(0)
+{
+	this->readyEvents.resize(maxEvents == 0 ? 1 : maxEvents);
+	this->ready.reserve(maxTasks);
+	this->timers.reserve(maxTasks * 2);
+
+	this->epollFileDescriptor = epoll_create1(EPOLL_CLOEXEC);
+	if(this->epollFileDescriptor == -1)
+	{
+		perror("EdgeReactor - Failed to create a new epoll instance: epoll_create1()");
+		exit(EXIT_FAILURE);
+	}
+
+	this->timerFileDescriptor = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if(this->timerFileDescriptor == -1)
+	{
+		perror("EdgeReactor - Failed to create the timer: timerfd_create()");
+		exit(EXIT_FAILURE);
+	}
+
+	this->wakeupFileDescriptor = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if(this->wakeupFileDescriptor == -1)
+	{
+		perror("EdgeReactor - Failed to create the wakeup descriptor: eventfd()");
+		exit(EXIT_FAILURE);
+	}
+
+	struct epoll_event event;
+	event.events = EPOLLIN;
+
+	event.data.u64 = TIMER_SLOT;
+	if(epoll_ctl(this->epollFileDescriptor, EPOLL_CTL_ADD, this->timerFileDescriptor, &event) == -1)
+	{
+		perror("EdgeReactor - Failed to add the timer: epoll_ctl()");
+		exit(EXIT_FAILURE);
+	}
+
+	event.data.u64 = WAKEUP_SLOT;
+	if(epoll_ctl(this->epollFileDescriptor, EPOLL_CTL_ADD, this->wakeupFileDescriptor, &event) == -1)
+	{
+		perror("EdgeReactor - Failed to add the wakeup descriptor: epoll_ctl()");
+		exit(EXIT_FAILURE);
+	}
+}
+
+/*
+ * Destructor. Tasks still waiting are destroyed without being resumed.
+ */
+EdgeReactor::~EdgeReactor()
+{
+	vector<std::coroutine_handle<>> handles;
+
+	for(PinEntry &entry : this->pins)
+	{
+		while(entry.head != nullptr)
+		{
+			handles.push_back(entry.head->group->handle);
+			disarm(*entry.head->group);
+		}
+	}
+
+	while(!this->timers.empty())
+	{
+		handles.push_back(this->timers[0]->group->handle);
+		disarm(*this->timers[0]->group);
+	}
+
+	for(const ReadyTask &TASK : this->ready)
+	{
+		handles.push_back(TASK.handle);
+	}
+
+	for(std::coroutine_handle<> &handle : handles)
+	{
+		handle.destroy();
+	}
+
+	close(this->wakeupFileDescriptor);
+	close(this->timerFileDescriptor);
+	close(this->epollFileDescriptor);
+}
+
+/*
+ * Description:
+ * 	Hand a task to the reactor. It starts running on the next turn of run().
+ */
+void EdgeReactor::spawn(EdgeTask task)
+{
+	if(!task.handle)
+	{
+		return;
+	}
+
+	task.handle.promise().reactor = this;
+	this->ready.push_back({task.handle, nullptr, 0});
+	this->taskCount++;
+
+	task.handle = nullptr; //Owned by the reactor (and freed by the task itself) from now on
+}
+
+/*
+ * Description:
+ * 	Run the tasks until they have all returned or stop() is called.
+ */
+void EdgeReactor::run(void)
+{
+	ScopedRealTimeProfile realTime(this->realTimeProfile);
+
+	while(!this->stopRequested)
+	{
+		resumeReady();
+
+		if(this->stopRequested || this->taskCount == 0)
+		{
+			break;
+		}
+
+		int epollEventsNum = epoll_wait(this->epollFileDescriptor, this->readyEvents.data(), (int)this->readyEvents.size(), -1);
+		const uint64_t WAKEUP_TIME_NS = monotonicTimeNs();
+
+		if(epollEventsNum == -1)
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+
+			perror("EdgeReactor::run - Failed to wait for a file descriptor to be ready: epoll_wait()");
+			break;
+		}
+
+		for(int index = 0; index < epollEventsNum; ++index)
+		{
+			const uint64_t SLOT = this->readyEvents[index].data.u64;
+
+			if(SLOT == TIMER_SLOT)
+			{
+				expireTimers();
+			}
+			else if(SLOT == WAKEUP_SLOT)
+			{
+				uint64_t wakeups;
+				while(read(this->wakeupFileDescriptor, &wakeups, sizeof(wakeups)) > 0)
+				{
+				}
+			}
+			else if(SLOT < this->pins.size())
+			{
+				dispatchEdge(this->pins[SLOT], WAKEUP_TIME_NS);
+			}
+		}
+	}
+
+	this->stopRequested = false;
+}
+
+/*
+ * Description:
+ * 	Make run() return. Can be called from any thread, the tasks are left suspended.
+ * 	If the reactor is not running yet, the next run() returns straight away.
+ */
+void EdgeReactor::stop(void)
+{
+	this->stopRequested = true;
+
+	const uint64_t ONE = 1;
+
+	if(write(this->wakeupFileDescriptor, &ONE, sizeof(ONE)) == -1)
+	{
+		perror("EdgeReactor - Failed to wake up the reactor: write()");
+	}
+}
+
+/*
+ * Description:
+ * 	Start the waits of a co_await: link them to their pins and the timer heap.
+ */
+void EdgeReactor::arm(EdgeWaitGroup &group)
+{
+	const uint64_t NOW = monotonicTimeNs();
+
+	group.fired = group.count;
+
+	for(unsigned int index = 0; index < group.count; ++index)
+	{
+		EdgeWait &wait = group.waits[index];
+
+		wait.group = &group;
+		wait.linked = false;
+		wait.next = nullptr;
+		wait.previous = nullptr;
+		wait.timerIndex = NO_TIMER;
+		wait.deadlineNs = (wait.timeoutNs == EdgeAwaitable::FOREVER) ? 0 : NOW + wait.timeoutNs;
+	}
+
+	for(unsigned int index = 0; index < group.count; ++index)
+	{
+		EdgeWait &wait = group.waits[index];
+
+		if(wait.pin != nullptr)
+		{
+			if(!findPin(wait.pin, wait.pinSlot))
+			{
+				//The pin can never report an edge: treat it as an immediate timeout.
+				fire(wait, {true, GpioBase::EDGE::NONE, NOW});
+				break;
+			}
+
+			PinEntry &entry = this->pins[wait.pinSlot];
+
+			wait.previous = entry.tail;
+
+			if(entry.tail != nullptr)
+			{
+				entry.tail->next = &wait;
+			}
+			else
+			{
+				entry.head = &wait;
+			}
+
+			entry.tail = &wait;
+			wait.linked = true;
+		}
+
+		if(wait.deadlineNs != 0)
+		{
+			pushTimer(&wait);
+		}
+	}
+
+	updateTimer();
+}
+
+/*
+ * Find a pin in the table, adding it (and its edge descriptor to the epoll set) the first time.
+ */
+bool EdgeReactor::findPin(const GpioBase *pin, size_t &slot)
+{
+	for(slot = 0; slot < this->pins.size(); ++slot)
+	{
+		if(this->pins[slot].pin == pin)
+		{
+			return true;
+		}
+	}
+
+	if(pin->getEdgeFileDescriptor() == -1)
+	{
+		cout << "ERROR: EdgeReactor - GPIO " << pin->getPinNumber() << " has no edge descriptor open" << endl;
+		return false;
+	}
+
+	struct epoll_event event;
+	event.events = EPOLLIN | EPOLLET | EPOLLPRI;
+	event.data.u64 = slot;
+
+	if(epoll_ctl(this->epollFileDescriptor, EPOLL_CTL_ADD, pin->getEdgeFileDescriptor(), &event) == -1)
+	{
+		perror("EdgeReactor - Failed to add the pin: epoll_ctl()");
+		return false;
+	}
+
+	this->pins.push_back({pin, false, nullptr, nullptr});
+	return true;
+}
+
+void EdgeReactor::dispatchEdge(PinEntry &entry, const uint64_t WAKEUP_TIME_NS)
+{
+	const unsigned int PIN_NUMBER = entry.pin->getPinNumber();
+
+	EdgeStatistics::recordWakeup(PIN_NUMBER);
+
+	//Ignore the first trigger, epoll_wait always reports a value file as ready once.
+	if(!entry.primed)
+	{
+		entry.primed = true;
+		EdgeStatistics::recordSpuriousWakeup(PIN_NUMBER);
+		return;
+	}
+
+	if(!entry.pin->acceptEdge(WAKEUP_TIME_NS))
+	{
+		EdgeStatistics::recordSpuriousWakeup(PIN_NUMBER);
+		return;
+	}
+
+	const GpioBase::EDGE DETECTED = entry.pin->getDetectedEdge();
+
+	//Firing a wait unlinks its whole group, so start over from the oldest wait every time.
+	EdgeWait *wait = entry.head;
+
+	while(wait != nullptr)
+	{
+		if(wait->edge == GpioBase::EDGE::BOTH || DETECTED == GpioBase::EDGE::BOTH || wait->edge == DETECTED)
+		{
+			fire(*wait, {false, DETECTED, WAKEUP_TIME_NS}, entry.pin);
+			wait = entry.head;
+		}
+		else
+		{
+			wait = wait->next;
+		}
+	}
+}
+
+void EdgeReactor::expireTimers(void)
+{
+	uint64_t expirations;
+	while(read(this->timerFileDescriptor, &expirations, sizeof(expirations)) > 0)
+	{
+	}
+
+	this->armedDeadlineNs = 0;
+
+	const uint64_t NOW = monotonicTimeNs();
+
+	while(!this->timers.empty() && this->timers[0]->deadlineNs <= NOW)
+	{
+		fire(*this->timers[0], {true, GpioBase::EDGE::NONE, NOW});
+	}
+
+	updateTimer();
+}
+
+/*
+ * Complete a co_await with the result of one of its waits, and queue the coroutine.
+ */
+void EdgeReactor::fire(EdgeWait &wait, const EdgeResult &RESULT, const GpioBase *pin)
+{
+	EdgeWaitGroup &group = *wait.group;
+
+	wait.result = RESULT;
+	group.fired = (unsigned int)(&wait - group.waits);
+
+	disarm(group);
+	this->ready.push_back({group.handle, pin, RESULT.timestampNs});
+}
+
+void EdgeReactor::disarm(EdgeWaitGroup &group)
+{
+	for(unsigned int index = 0; index < group.count; ++index)
+	{
+		EdgeWait &wait = group.waits[index];
+
+		if(wait.linked)
+		{
+			PinEntry &entry = this->pins[wait.pinSlot];
+
+			if(wait.previous != nullptr)
+			{
+				wait.previous->next = wait.next;
+			}
+			else
+			{
+				entry.head = wait.next;
+			}
+
+			if(wait.next != nullptr)
+			{
+				wait.next->previous = wait.previous;
+			}
+			else
+			{
+				entry.tail = wait.previous;
+			}
+		}
+
+		if(wait.timerIndex != NO_TIMER)
+		{
+			removeTimer(&wait);
+		}
+
+		wait.linked = false;
+		wait.next = nullptr;
+		wait.previous = nullptr;
+	}
+}
+
+void EdgeReactor::resumeReady(void)
+{
+	//Resumed tasks may queue more (a spawn, a failed wait), which run in this same pass.
+	for(size_t index = 0; index < this->ready.size(); ++index)
+	{
+		const ReadyTask TASK = this->ready[index];
+		const uint64_t START = monotonicTimeNs();
+
+		TASK.handle.resume();
+
+		if(TASK.pin != nullptr)
+		{
+			EdgeStatistics::recordEdge(TASK.pin->getPinNumber(), START - TASK.wakeupTimeNs, monotonicTimeNs() - START);
+		}
+	}
+
+	this->ready.clear();
+}
+
+/*
+ * Set the timerfd to the earliest deadline, if it changed.
+ */
+void EdgeReactor::updateTimer(void)
+{
+	const uint64_t DEADLINE = this->timers.empty() ? 0 : this->timers[0]->deadlineNs;
+
+	if(DEADLINE == this->armedDeadlineNs)
+	{
+		return;
+	}
+
+	struct itimerspec timer = {};
+	timer.it_value.tv_sec = (time_t)(DEADLINE / 1000000000ULL);
+	timer.it_value.tv_nsec = (long)(DEADLINE % 1000000000ULL);
+
+	if(timerfd_settime(this->timerFileDescriptor, TFD_TIMER_ABSTIME, &timer, nullptr) == -1)
+	{
+		perror("EdgeReactor - Failed to set the timer: timerfd_settime()");
+		return;
+	}
+
+	this->armedDeadlineNs = DEADLINE;
+}
+
+/* ************************************************************************
+ * Timer heap, each wait knows its index so it can be removed when disarmed
+ * ************************************************************************/
+void EdgeReactor::pushTimer(EdgeWait *wait)
+{
+	wait->timerIndex = this->timers.size();
+	this->timers.push_back(wait);
+	siftUp(wait->timerIndex);
+}
+
+void EdgeReactor::removeTimer(EdgeWait *wait)
+{
+	const size_t INDEX = wait->timerIndex;
+	const size_t LAST = this->timers.size() - 1;
+
+	if(INDEX != LAST)
+	{
+		swapTimers(INDEX, LAST);
+	}
+
+	this->timers.pop_back();
+	wait->timerIndex = NO_TIMER;
+
+	if(INDEX < this->timers.size())
+	{
+		siftUp(INDEX);
+		siftDown(INDEX);
+	}
+}
+
+void EdgeReactor::siftUp(size_t index)
+{
+	while(index > 0)
+	{
+		const size_t PARENT = (index - 1) / 2;
+
+		if(this->timers[PARENT]->deadlineNs <= this->timers[index]->deadlineNs)
+		{
+			break;
+		}
+
+		swapTimers(index, PARENT);
+		index = PARENT;
+	}
+}
+
+void EdgeReactor::siftDown(size_t index)
+{
+	while(true)
+	{
+		const size_t LEFT = index * 2 + 1;
+		const size_t RIGHT = LEFT + 1;
+		size_t smallest = index;
+
+		if(LEFT < this->timers.size() && this->timers[LEFT]->deadlineNs < this->timers[smallest]->deadlineNs)
+		{
+			smallest = LEFT;
+		}
+
+		if(RIGHT < this->timers.size() && this->timers[RIGHT]->deadlineNs < this->timers[smallest]->deadlineNs)
+		{
+			smallest = RIGHT;
+		}
+
+		if(smallest == index)
+		{
+			break;
+		}
+
+		swapTimers(index, smallest);
+		index = smallest;
+	}
+}
+
+void EdgeReactor::swapTimers(size_t first, size_t second)
+{
+	EdgeWait *wait = this->timers[first];
+
+	this->timers[first] = this->timers[second];
+	this->timers[second] = wait;
+
+	this->timers[first]->timerIndex = first;
+	this->timers[second]->timerIndex = second;
+}
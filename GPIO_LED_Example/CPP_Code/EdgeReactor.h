@@ -0,0 +1,320 @@
+#ifndef H_EDGE_REACTOR_H_
+#define H_EDGE_REACTOR_H_
+
+#include <array>
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/epoll.h>
+
+#include "GpioBase.h"
+#include "RealTimeProfile.h"
+
+class EdgeReactor;
+
+/* What co_await on an edge (or a timer) gives back */
+struct EdgeResult
+{
+	bool timedOut;
+	GpioBase::EDGE edge;  //RISING or FALLING (BOTH if the direction could not be read), NONE on timeout
+	uint64_t timestampNs; //When the edge was detected or the timeout expired
+
+	explicit operator bool(void) const { return !timedOut; }
+};
+
+/*
+ * Fixed pool of coroutine frames. EdgeTask frames come from here, so starting and
+ * finishing tasks does not touch the heap once running. Frames bigger than
+ * FRAME_SIZE, or asked for when all FRAME_COUNT are in use, fall back to the heap
+ * and are counted, see getHeapAllocationCount().
+ */
+class EdgeFramePool
+{
+public:
+	static const size_t FRAME_SIZE = 2048;
+	static const size_t FRAME_COUNT = 64;
+
+	static void *allocate(const size_t SIZE);
+	static void release(void *frame);
+	static uint64_t getHeapAllocationCount(void);
+};
+
+/*
+ * A coroutine run by an EdgeReactor, e.g.
+ *
+ *     EdgeTask sequence(GPIO &button, GPIO &sensor)
+ *     {
+ *         co_await button.edge(GPIO::EDGE::RISING);
+ *
+ *         if(!co_await sensor.edge(GPIO::EDGE::FALLING, 500000000))
+ *         {
+ *             cout << "No pulse within 500 ms" << endl;
+ *         }
+ *     }
+ *
+ *     reactor.spawn(sequence(button, sensor));
+ *
+ * The task starts when the reactor runs it and frees itself when it returns.
+ */
+class EdgeTask
+{
+public:
+	struct promise_type;
+	typedef std::coroutine_handle<promise_type> handle_type;
+
+	struct FinalAwaiter
+	{
+		bool await_ready(void) const noexcept { return false; }
+		void await_suspend(handle_type handle) noexcept;
+		void await_resume(void) const noexcept {}
+	};
+
+	struct promise_type
+	{
+		EdgeReactor *reactor = nullptr;
+
+		EdgeTask get_return_object(void) { return EdgeTask(handle_type::from_promise(*this)); }
+		std::suspend_always initial_suspend(void) noexcept { return {}; }
+		FinalAwaiter final_suspend(void) noexcept { return {}; }
+		void return_void(void) {}
+		void unhandled_exception(void) { std::terminate(); }
+
+		static void *operator new(size_t size) { return EdgeFramePool::allocate(size); }
+		static void operator delete(void *frame) { EdgeFramePool::release(frame); }
+	};
+
+	EdgeTask(EdgeTask &&other) : handle(other.handle) { other.handle = nullptr; }
+	EdgeTask(const EdgeTask &) = delete;
+	EdgeTask &operator=(const EdgeTask &) = delete;
+
+	/* A task never spawned is destroyed with its handle */
+	~EdgeTask()
+	{
+		if(handle)
+		{
+			handle.destroy();
+		}
+	}
+
+private:
+	friend class EdgeReactor;
+
+	explicit EdgeTask(handle_type handle) : handle(handle) {}
+
+	handle_type handle;
+};
+
+struct EdgeWaitGroup;
+
+/*
+ * One thing a coroutine is waiting for: an edge on a pin (with an optional timeout)
+ * or, with no pin, only a timeout. Linked into the reactor while armed, so arming
+ * and firing allocate nothing.
+ */
+struct EdgeWait
+{
+	const GpioBase *pin;
+	GpioBase::EDGE edge;
+	uint64_t timeoutNs;
+	EdgeResult result;
+
+	uint64_t deadlineNs;
+	size_t pinSlot;     //The pin's entry in the reactor
+	bool linked;        //In the waits of the pin
+	EdgeWait *next;     //In the waits of the pin, oldest first
+	EdgeWait *previous;
+	size_t timerIndex;  //In the timer heap, NO_TIMER if not there
+	EdgeWaitGroup *group;
+};
+
+/* Waits armed together by a single co_await. The first one to fire resumes the coroutine and disarms the others. */
+struct EdgeWaitGroup
+{
+	std::coroutine_handle<> handle;
+	EdgeWait *waits;
+	unsigned int count;
+	unsigned int fired; //Index of the wait that fired
+};
+
+/*
+ * co_await pin.edge(EDGE, timeoutNs) or co_await EdgeReactor::sleepFor(ns). Can only
+ * be awaited from an EdgeTask.
+ */
+class EdgeAwaitable
+{
+public:
+	static const uint64_t FOREVER = UINT64_MAX;
+
+	EdgeAwaitable(const GpioBase *pin, const GpioBase::EDGE EDGE_TYPE, const uint64_t TIMEOUT_NS)
+	{
+		wait.pin = pin;
+		wait.edge = EDGE_TYPE;
+		wait.timeoutNs = TIMEOUT_NS;
+		wait.result = {true, GpioBase::EDGE::NONE, 0};
+	}
+
+	bool await_ready(void) const noexcept { return false; }
+	void await_suspend(EdgeTask::handle_type handle);
+	EdgeResult await_resume(void) const { return wait.result; }
+
+private:
+	template<size_t COUNT> friend class WhenAnyAwaitable;
+
+	EdgeWait wait;
+	EdgeWaitGroup group;
+};
+
+/* What co_await whenAny(...) gives back: which awaitable fired first, and its result */
+struct WhenAnyResult
+{
+	size_t index;
+	EdgeResult result;
+};
+
+template<size_t COUNT>
+class WhenAnyAwaitable
+{
+public:
+	explicit WhenAnyAwaitable(const std::array<EdgeAwaitable, COUNT> &awaitables)
+	{
+		for(size_t index = 0; index < COUNT; ++index)
+		{
+			waits[index] = awaitables[index].wait;
+		}
+	}
+
+	bool await_ready(void) const noexcept { return false; }
+	void await_suspend(EdgeTask::handle_type handle);
+	WhenAnyResult await_resume(void) const { return {group.fired, waits[group.fired].result}; }
+
+private:
+	std::array<EdgeWait, COUNT> waits;
+	EdgeWaitGroup group;
+};
+
+/*
+ * Description:
+ * 	Wait for whichever comes first of several edges and timers, e.g.
+ *
+ * 	    WhenAnyResult first = co_await whenAny(start.edge(GPIO::EDGE::RISING),
+ * 	                                           stop.edge(GPIO::EDGE::RISING),
+ * 	                                           EdgeReactor::sleepFor(1000000000));
+ *
+ * 	The others are disarmed before the coroutine resumes.
+ */
+template<typename... AWAITABLES>
+WhenAnyAwaitable<sizeof...(AWAITABLES)> whenAny(const AWAITABLES &... awaitables)
+{
+	return WhenAnyAwaitable<sizeof...(AWAITABLES)>(std::array<EdgeAwaitable, sizeof...(AWAITABLES)>{awaitables...});
+}
+
+/*
+ * Runs EdgeTask coroutines on a single thread. The edge descriptors of the pins they
+ * wait for and one timerfd (armed for the earliest timeout) share one epoll set, so
+ * every step of a sequence is resumed straight from epoll_wait() on this thread,
+ * with no thread hand-off. Pins join the epoll set the first time they are awaited
+ * and must outlive the reactor.
+ *
+ * spawn() must be called before run() or from a task. stop() can be called from any thread.
+ */
+class EdgeReactor
+{
+public:
+	EdgeReactor(unsigned int maxTasks = EdgeFramePool::FRAME_COUNT, unsigned int maxEvents = 16);
+	~EdgeReactor();
+
+	EdgeReactor(const EdgeReactor &) = delete;
+	EdgeReactor &operator=(const EdgeReactor &) = delete;
+
+	void spawn(EdgeTask task);
+	void run(void);
+	void stop(void);
+
+	unsigned int getTaskCount(void) const { return taskCount; }
+
+	void setRealTimeProfile(const RealTimeProfile &profile) { realTimeProfile = profile; }
+
+	static EdgeAwaitable sleepFor(const uint64_t DURATION_NS) { return EdgeAwaitable(nullptr, GpioBase::EDGE::NONE, DURATION_NS); }
+
+	//Used by the awaitables and tasks
+	void arm(EdgeWaitGroup &group);
+	void finishTask(void) { taskCount--; }
+
+private:
+	static const uint64_t TIMER_SLOT = 0xFFFFFFFEULL;
+	static const uint64_t WAKEUP_SLOT = 0xFFFFFFFFULL;
+	static const size_t NO_TIMER = SIZE_MAX;
+
+	struct PinEntry
+	{
+		const GpioBase *pin;
+		bool primed;    //The first (spurious) event reported for a value file is ignored
+		EdgeWait *head; //Waits on the pin, oldest first
+		EdgeWait *tail;
+	};
+
+	/* A coroutine to resume, and the edge that woke it (for the statistics) */
+	struct ReadyTask
+	{
+		std::coroutine_handle<> handle;
+		const GpioBase *pin;
+		uint64_t wakeupTimeNs;
+	};
+
+	int epollFileDescriptor;
+	int timerFileDescriptor;
+	int wakeupFileDescriptor;
+	unsigned int taskCount;
+	std::atomic<bool> stopRequested; //Set by stop(), cleared when run() returns
+	uint64_t armedDeadlineNs; //What the timerfd is set to, 0 when disarmed
+	RealTimeProfile realTimeProfile;
+
+	std::vector<struct epoll_event> readyEvents;
+	std::vector<PinEntry> pins;
+	std::vector<EdgeWait*> timers; //Min-heap on deadlineNs
+	std::vector<ReadyTask> ready;
+
+	bool findPin(const GpioBase *pin, size_t &slot);
+	void dispatchEdge(PinEntry &entry, const uint64_t WAKEUP_TIME_NS);
+	void expireTimers(void);
+	void fire(EdgeWait &wait, const EdgeResult &RESULT, const GpioBase *pin = nullptr);
+	void disarm(EdgeWaitGroup &group);
+	void resumeReady(void);
+	void updateTimer(void);
+
+	void pushTimer(EdgeWait *wait);
+	void removeTimer(EdgeWait *wait);
+	void siftUp(size_t index);
+	void siftDown(size_t index);
+	void swapTimers(size_t first, size_t second);
+};
+
+inline void EdgeTask::FinalAwaiter::await_suspend(handle_type handle) noexcept
+{
+	EdgeReactor *reactor = handle.promise().reactor;
+
+	handle.destroy();
+
+	if(reactor != nullptr)
+	{
+		reactor->finishTask();
+	}
+}
+
+inline void EdgeAwaitable::await_suspend(EdgeTask::handle_type handle)
+{
+	group = {handle, &wait, 1, 0};
+	handle.promise().reactor->arm(group);
+}
+
+template<size_t COUNT>
+void WhenAnyAwaitable<COUNT>::await_suspend(EdgeTask::handle_type handle)
+{
+	group = {handle, waits.data(), COUNT, 0};
+	handle.promise().reactor->arm(group);
+}
+
+#endif /* H_EDGE_REACTOR_H_ */
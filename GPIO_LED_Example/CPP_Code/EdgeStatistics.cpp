@@ -0,0 +1,363 @@
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "EdgeStatistics.h"
+#include "Timestamp.h"
+
+/* ************************************************************************
+ * LatencyHistogram / HistogramSnapshot
+ * ************************************************************************/
+LatencyHistogram::LatencyHistogram() : count(0), sum(0), max(0)
+{
+	for(atomic<uint64_t> &bucket : this->buckets)
+	{
+		bucket.store(0, memory_order_relaxed);
+	}
+}
+
+/*
+ * Description:
+ * 	The smallest value recorded into BUCKET, the inverse of getBucket().
+ */
+uint64_t LatencyHistogram::getBucketLowerBound(const unsigned int BUCKET)
+{
+	if(BUCKET < SUB_BUCKETS)
+	{
+		return BUCKET;
+	}
+
+	const unsigned int EXPONENT = BUCKET / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+	const uint64_t SUB_BUCKET = BUCKET % SUB_BUCKETS;
+
+	return (SUB_BUCKETS + SUB_BUCKET) << (EXPONENT - SUB_BUCKET_BITS);
+}
+
+HistogramSnapshot::HistogramSnapshot() : count(0), sum(0), max(0)
+{
+	buckets.fill(0);
+}
+
+void HistogramSnapshot::add(const LatencyHistogram &histogram)
+{
+	for(unsigned int bucket = 0; bucket < LatencyHistogram::BUCKETS; ++bucket)
+	{
+		this->buckets[bucket] += histogram.buckets[bucket].load(memory_order_relaxed);
+	}
+
+	this->count += histogram.count.load(memory_order_relaxed);
+	this->sum += histogram.sum.load(memory_order_relaxed);
+
+	const uint64_t MAX = histogram.max.load(memory_order_relaxed);
+	if(MAX > this->max)
+	{
+		this->max = MAX;
+	}
+}
+
+/*
+ * Description:
+ * 	The value below which FRACTION of the recorded values fall, to the precision
+ * 	of the buckets (the middle of the bucket it falls in is returned).
+ */
+uint64_t HistogramSnapshot::getPercentile(const double FRACTION) const
+{
+	if(this->count == 0)
+	{
+		return 0;
+	}
+
+	uint64_t rank = (uint64_t)(FRACTION * (double)this->count);
+	if(rank >= this->count)
+	{
+		rank = this->count - 1;
+	}
+
+	uint64_t seen = 0;
+
+	for(unsigned int bucket = 0; bucket < LatencyHistogram::BUCKETS; ++bucket)
+	{
+		seen += this->buckets[bucket];
+
+		if(seen > rank)
+		{
+			const uint64_t LOWER = LatencyHistogram::getBucketLowerBound(bucket);
+			const uint64_t UPPER = (bucket + 1 < LatencyHistogram::BUCKETS) ? LatencyHistogram::getBucketLowerBound(bucket + 1) : this->max;
+			const uint64_t MIDDLE = LOWER + (UPPER - LOWER) / 2;
+
+			return (MIDDLE > this->max) ? this->max : MIDDLE;
+		}
+	}
+
+	return this->max;
+}
+
+void HistogramSnapshot::toText(ostream &output) const
+{
+	output << "count " << this->count << ", mean " << (uint64_t)getMean() << " ns, p50 " << getPercentile(0.50)
+		   << " ns, p99 " << getPercentile(0.99) << " ns, p999 " << getPercentile(0.999) << " ns, max " << this->max << " ns";
+}
+
+void HistogramSnapshot::toJson(ostream &output) const
+{
+	output << "{\"count\": " << this->count << ", \"mean\": " << (uint64_t)getMean()
+		   << ", \"p50\": " << getPercentile(0.50) << ", \"p99\": " << getPercentile(0.99)
+		   << ", \"p999\": " << getPercentile(0.999) << ", \"max\": " << this->max << "}";
+}
+
+/* ************************************************************************
+ * EdgeStatistics
+ * ************************************************************************/
+thread_local EdgeStatistics::ThreadBlock *EdgeStatistics::threadBlock = nullptr;
+
+//Every block ever handed to a thread. Blocks are never freed, threads that exit hand theirs back.
+static mutex blocksMutex;
+static vector<void*> blocks;
+
+//Periodic dump
+static mutex dumpMutex;
+static condition_variable dumpCondition;
+static thread dumpThread;
+static bool dumping = false;
+
+EdgeStatistics::ThreadBlock::ThreadBlock() : inUse(true)
+{
+	for(atomic<PinCounters*> &pin : this->pins)
+	{
+		pin.store(nullptr, memory_order_relaxed);
+	}
+}
+
+/*
+ * Hands the thread's block back when the thread exits.
+ */
+struct ThreadBlockRelease
+{
+	~ThreadBlockRelease()
+	{
+		EdgeStatistics::stopRecording();
+	}
+};
+
+/*
+ * Description:
+ *	Slow path of recording: give the thread a block (a free one if a thread has
+ *	exited, otherwise a new one) and/or allocate the counters of a pin in it.
+ *	Only ever runs once per thread and pin.
+ */
+EdgeStatistics::PinCounters &EdgeStatistics::allocate(const unsigned int SLOT)
+{
+	if(threadBlock == nullptr)
+	{
+		static thread_local ThreadBlockRelease release;
+		(void)release;
+
+		lock_guard<mutex> lock(blocksMutex);
+
+		for(void *block : blocks)
+		{
+			ThreadBlock *candidate = static_cast<ThreadBlock*>(block);
+
+			if(!candidate->inUse.load(memory_order_relaxed))
+			{
+				candidate->inUse.store(true, memory_order_relaxed);
+				threadBlock = candidate;
+				break;
+			}
+		}
+
+		if(threadBlock == nullptr)
+		{
+			threadBlock = new ThreadBlock();
+			blocks.push_back(threadBlock);
+		}
+	}
+
+	PinCounters *counters = threadBlock->pins[SLOT].load(memory_order_relaxed);
+
+	if(counters == nullptr)
+	{
+		counters = new PinCounters();
+		threadBlock->pins[SLOT].store(counters, memory_order_release);
+	}
+
+	return *counters;
+}
+
+/*
+ * Description:
+ *	Hand the calling thread's block back for another thread to use. Called
+ *	automatically when a thread that recorded anything exits.
+ */
+void EdgeStatistics::stopRecording(void)
+{
+	if(threadBlock == nullptr)
+	{
+		return;
+	}
+
+	lock_guard<mutex> lock(blocksMutex);
+
+	threadBlock->inUse.store(false, memory_order_relaxed);
+	threadBlock = nullptr;
+}
+
+/*
+ * Description:
+ *	Add up the counters of every thread, per pin. Can be called from any thread at
+ *	any time, recording carries on while it runs.
+ *
+ * Return
+ * 	The counters of every pin that recorded something, by increasing GPIO number
+ */
+EdgeStatistics::Snapshot EdgeStatistics::snapshot(void)
+{
+	Snapshot result;
+	result.timestampNs = monotonicTimeNs();
+
+	lock_guard<mutex> lock(blocksMutex);
+
+	for(unsigned int slot = 0; slot <= OTHER_PIN; ++slot)
+	{
+		PinSnapshot pin;
+		bool recorded = false;
+
+		pin.pin = slot;
+		pin.wakeups = 0;
+		pin.edges = 0;
+		pin.spuriousWakeups = 0;
+		pin.timeouts = 0;
+
+		for(void *block : blocks)
+		{
+			const PinCounters *counters = static_cast<ThreadBlock*>(block)->pins[slot].load(memory_order_acquire);
+
+			if(counters == nullptr)
+			{
+				continue;
+			}
+
+			recorded = true;
+			pin.wakeups += counters->wakeups.load(memory_order_relaxed);
+			pin.edges += counters->edges.load(memory_order_relaxed);
+			pin.spuriousWakeups += counters->spuriousWakeups.load(memory_order_relaxed);
+			pin.timeouts += counters->timeouts.load(memory_order_relaxed);
+			pin.latency.add(counters->latency);
+			pin.callbackDuration.add(counters->callbackDuration);
+		}
+
+		if(recorded)
+		{
+			result.pins.push_back(pin);
+		}
+	}
+
+	return result;
+}
+
+const EdgeStatistics::PinSnapshot *EdgeStatistics::Snapshot::find(const unsigned int PIN) const
+{
+	for(const PinSnapshot &pin : this->pins)
+	{
+		if(pin.pin == PIN)
+		{
+			return &pin;
+		}
+	}
+
+	return nullptr;
+}
+
+void EdgeStatistics::Snapshot::toText(ostream &output) const
+{
+	output << "=== Edge statistics at " << this->timestampNs << " ns ===" << endl;
+
+	for(const PinSnapshot &pin : this->pins)
+	{
+		output << "GPIO " << pin.pin << ": " << pin.edges << " edges, " << pin.wakeups << " wakeups, "
+			   << pin.spuriousWakeups << " spurious, " << pin.timeouts << " timeouts" << endl;
+
+		output << "    latency:  ";
+		pin.latency.toText(output);
+		output << endl << "    callback: ";
+		pin.callbackDuration.toText(output);
+		output << endl;
+	}
+}
+
+void EdgeStatistics::Snapshot::toJson(ostream &output) const
+{
+	output << "{\"timestamp_ns\": " << this->timestampNs << ", \"pins\": [";
+
+	for(size_t index = 0; index < this->pins.size(); ++index)
+	{
+		const PinSnapshot &PIN = this->pins[index];
+
+		output << (index == 0 ? "" : ", ") << "{\"pin\": " << PIN.pin
+			   << ", \"edges\": " << PIN.edges
+			   << ", \"wakeups\": " << PIN.wakeups
+			   << ", \"spurious_wakeups\": " << PIN.spuriousWakeups
+			   << ", \"timeouts\": " << PIN.timeouts
+			   << ", \"latency_ns\": ";
+		PIN.latency.toJson(output);
+		output << ", \"callback_ns\": ";
+		PIN.callbackDuration.toJson(output);
+		output << "}";
+	}
+
+	output << "]}";
+}
+
+/*
+ * Description:
+ *	Write a snapshot to output every INTERVAL_MS from a background thread, until
+ *	stopPeriodicDump(). A JSON dump is one object per line.
+ *
+ * Args:
+ *	output Where to write, e.g. cout or an ofstream. It must outlive the dump.
+ *	INTERVAL_MS The time between dumps
+ *	DUMP_FORMAT TEXT or JSON
+ */
+void EdgeStatistics::startPeriodicDump(ostream &output, const unsigned int INTERVAL_MS, const FORMAT DUMP_FORMAT)
+{
+	stopPeriodicDump();
+
+	lock_guard<mutex> lock(dumpMutex);
+	dumping = true;
+
+	dumpThread = thread([&output, INTERVAL_MS, DUMP_FORMAT]()
+	{
+		unique_lock<mutex> lock(dumpMutex);
+
+		while(!dumpCondition.wait_for(lock, chrono::milliseconds(INTERVAL_MS), []() { return !dumping; }))
+		{
+			const Snapshot SNAPSHOT = snapshot();
+
+			if(DUMP_FORMAT == FORMAT::JSON)
+			{
+				SNAPSHOT.toJson(output);
+				output << endl;
+			}
+			else
+			{
+				SNAPSHOT.toText(output);
+			}
+		}
+	});
+}
+
+void EdgeStatistics::stopPeriodicDump(void)
+{
+	{
+		lock_guard<mutex> lock(dumpMutex);
+		dumping = false;
+	}
+
+	dumpCondition.notify_all();
+
+	if(dumpThread.joinable())
+	{
+		dumpThread.join();
+	}
+}
@@ -0,0 +1,215 @@
+#ifndef H_EDGE_STATISTICS_H_
+#define H_EDGE_STATISTICS_H_
+
+#include <array>
+#include <atomic>
+#include <iostream>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "PinTable.h"
+
+using namespace std;
+
+/*
+ * Log-linear histogram of durations in ns: every power of two is split into
+ * SUB_BUCKETS linear buckets, so any value is recorded with ~12% precision from
+ * 1 ns up to the full uint64_t range, in a fixed 4KB.
+ *
+ * Each histogram has a single writer (see EdgeStatistics), which updates the
+ * buckets with plain relaxed stores. Readers may copy it at any time.
+ */
+class LatencyHistogram
+{
+public:
+	static const unsigned int SUB_BUCKET_BITS = 3;
+	static const unsigned int SUB_BUCKETS = 1U << SUB_BUCKET_BITS;
+	static const unsigned int BUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+	LatencyHistogram();
+
+	inline void record(const uint64_t VALUE_NS)
+	{
+		increment(buckets[getBucket(VALUE_NS)]);
+		increment(count);
+		sum.store(sum.load(memory_order_relaxed) + VALUE_NS, memory_order_relaxed);
+
+		if(VALUE_NS > max.load(memory_order_relaxed))
+		{
+			max.store(VALUE_NS, memory_order_relaxed);
+		}
+	}
+
+	static inline unsigned int getBucket(const uint64_t VALUE)
+	{
+		if(VALUE < SUB_BUCKETS)
+		{
+			return (unsigned int)VALUE;
+		}
+
+		const unsigned int EXPONENT = 63 - __builtin_clzll(VALUE);
+		const unsigned int SUB_BUCKET = (unsigned int)(VALUE >> (EXPONENT - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+
+		return (EXPONENT - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + SUB_BUCKET;
+	}
+
+	static uint64_t getBucketLowerBound(const unsigned int BUCKET);
+
+private:
+	friend class HistogramSnapshot;
+
+	static inline void increment(atomic<uint64_t> &counter)
+	{
+		counter.store(counter.load(memory_order_relaxed) + 1, memory_order_relaxed);
+	}
+
+	atomic<uint64_t> buckets[BUCKETS];
+	atomic<uint64_t> count;
+	atomic<uint64_t> sum;
+	atomic<uint64_t> max;
+};
+
+/* A copy of one or more LatencyHistograms, for reporting */
+class HistogramSnapshot
+{
+public:
+	HistogramSnapshot();
+
+	void add(const LatencyHistogram &histogram);
+
+	uint64_t getCount(void) const { return count; }
+	uint64_t getMax(void) const { return max; }
+	double getMean(void) const { return (count == 0) ? 0 : (double)sum / (double)count; }
+	uint64_t getPercentile(const double FRACTION) const;
+
+	void toText(ostream &output) const;
+	void toJson(ostream &output) const;
+
+private:
+	std::array<uint64_t, LatencyHistogram::BUCKETS> buckets;
+	uint64_t count;
+	uint64_t sum;
+	uint64_t max;
+};
+
+/*
+ * Instrumentation of the edge path (pollEdge() and GpioEventLoop), per pin:
+ *     - wakeups          epoll_wait() reported the pin ready
+ *     - edges            edges dispatched to a callback or ring
+ *     - spurious wakeups wakeups that were not dispatched (the first report of a
+ *                        value file, debounced bounces)
+ *     - timeouts         waits for the pin that ended without an edge
+ *     - latency          wakeup to callback (or ring push) start
+ *     - callback time    time spent in the callback (or pushing)
+ *
+ * Recording is lock free and contention free: every thread records into its own
+ * cache-line aligned block, found through a thread_local pointer, and only the
+ * recording thread writes to it. Blocks of threads that exit are kept (and reused
+ * by later threads) so nothing is lost. snapshot() adds the blocks of every thread up.
+ */
+class EdgeStatistics
+{
+public:
+	static const size_t CACHE_LINE_SIZE = 64;
+
+	/* The slot counting GPIO numbers out of range */
+	static const unsigned int OTHER_PIN = GPIO_COUNT;
+
+	struct alignas(CACHE_LINE_SIZE) PinCounters
+	{
+		atomic<uint64_t> wakeups;
+		atomic<uint64_t> edges;
+		atomic<uint64_t> spuriousWakeups;
+		atomic<uint64_t> timeouts;
+		LatencyHistogram latency;
+		LatencyHistogram callbackDuration;
+
+		PinCounters() : wakeups(0), edges(0), spuriousWakeups(0), timeouts(0) {}
+	};
+
+	struct PinSnapshot
+	{
+		unsigned int pin;
+		uint64_t wakeups;
+		uint64_t edges;
+		uint64_t spuriousWakeups;
+		uint64_t timeouts;
+		HistogramSnapshot latency;
+		HistogramSnapshot callbackDuration;
+	};
+
+	struct Snapshot
+	{
+		uint64_t timestampNs;
+		vector<PinSnapshot> pins; //Only the pins that recorded something
+
+		const PinSnapshot *find(const unsigned int PIN) const;
+		void toText(ostream &output) const;
+		void toJson(ostream &output) const;
+	};
+
+	enum class FORMAT
+	{
+		TEXT = 0,
+		JSON = 1
+	};
+
+	static inline void recordWakeup(const unsigned int PIN) { increment(local(PIN).wakeups); }
+	static inline void recordSpuriousWakeup(const unsigned int PIN) { increment(local(PIN).spuriousWakeups); }
+	static inline void recordTimeout(const unsigned int PIN) { increment(local(PIN).timeouts); }
+
+	static inline void recordEdge(const unsigned int PIN, const uint64_t LATENCY_NS, const uint64_t DURATION_NS)
+	{
+		PinCounters &counters = local(PIN);
+
+		increment(counters.edges);
+		counters.latency.record(LATENCY_NS);
+		counters.callbackDuration.record(DURATION_NS);
+	}
+
+	static Snapshot snapshot(void);
+
+	static void startPeriodicDump(ostream &output, const unsigned int INTERVAL_MS, const FORMAT DUMP_FORMAT = FORMAT::TEXT);
+	static void stopPeriodicDump(void);
+
+	static void stopRecording(void);
+
+private:
+	/* The counters of one thread. A pin's counters are allocated the first time the thread records for it. */
+	struct ThreadBlock
+	{
+		atomic<PinCounters*> pins[GPIO_COUNT + 1];
+		atomic<bool> inUse;
+
+		ThreadBlock();
+	};
+
+	static thread_local ThreadBlock *threadBlock;
+
+	static inline void increment(atomic<uint64_t> &counter)
+	{
+		counter.store(counter.load(memory_order_relaxed) + 1, memory_order_relaxed);
+	}
+
+	static inline PinCounters &local(const unsigned int PIN)
+	{
+		const unsigned int SLOT = (PIN < GPIO_COUNT) ? PIN : OTHER_PIN;
+
+		if(threadBlock != nullptr)
+		{
+			PinCounters *counters = threadBlock->pins[SLOT].load(memory_order_relaxed);
+
+			if(counters != nullptr)
+			{
+				return *counters;
+			}
+		}
+
+		return allocate(SLOT);
+	}
+
+	static PinCounters &allocate(const unsigned int SLOT);
+};
+
+#endif /* H_EDGE_STATISTICS_H_ */
@@ -0,0 +1,159 @@
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#include "EdgeSubscription.h"
+
+/* The subscription whose handler the calling pool worker is running, so deactivate() does not wait for itself */
+static thread_local const EdgeSubscriptionState *handlerSubscription = nullptr;
+
+EdgeSubscriptionState::EdgeSubscriptionState(GpioBase::edgeHandler handler, EdgeWorkerPool *pool) :
+	handler(handler), pool(pool), cancelFileDescriptor(-1), active(true), runningHandlers(0)
+{
+	this->cancelFileDescriptor = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if(this->cancelFileDescriptor == -1)
+	{
+		perror("EdgeSubscription - Failed to create the cancel descriptor: eventfd()");
+		this->active = false;
+	}
+}
+
+/*
+ * Destructor. The last owner may be the watching thread itself (the subscription was
+ * cancelled from its own handler), in which case the thread is left to finish.
+ */
+EdgeSubscriptionState::~EdgeSubscriptionState()
+{
+	if(this->watcher.joinable())
+	{
+		this->watcher.detach();
+	}
+
+	if(this->cancelFileDescriptor != -1)
+	{
+		close(this->cancelFileDescriptor);
+	}
+}
+
+/*
+ * Description:
+ *	Run the handler for an edge on a pool worker, unless the subscription was
+ *	cancelled. deactivate() waits for the handlers started here.
+ */
+void EdgeSubscriptionState::runHandler(const unsigned int PIN, const GpioBase::VALUE LEVEL, const uint64_t TIMESTAMP_NS)
+{
+	{
+		lock_guard<mutex> lock(this->handlersMutex);
+
+		if(!this->active)
+		{
+			return;
+		}
+
+		this->runningHandlers++;
+	}
+
+	const EdgeSubscriptionState *PREVIOUS = handlerSubscription;
+	handlerSubscription = this;
+
+	this->handler(PIN, LEVEL, TIMESTAMP_NS);
+
+	handlerSubscription = PREVIOUS;
+
+	{
+		lock_guard<mutex> lock(this->handlersMutex);
+		this->runningHandlers--;
+	}
+
+	this->handlersDone.notify_all();
+}
+
+/*
+ * Description:
+ *	Stop handing edges to the handler, and wait for the pool workers already in it
+ *	to return. A worker calling this from the handler does not wait for itself.
+ */
+void EdgeSubscriptionState::deactivate(void)
+{
+	unique_lock<mutex> lock(this->handlersMutex);
+
+	this->active = false;
+
+	const unsigned int OWN = (handlerSubscription == this) ? 1 : 0;
+
+	this->handlersDone.wait(lock, [this, OWN]() { return this->runningHandlers <= OWN; });
+}
+
+EdgeSubscription::EdgeSubscription()
+{
+}
+
+EdgeSubscription::EdgeSubscription(const shared_ptr<EdgeSubscriptionState> &state) : state(state)
+{
+}
+
+EdgeSubscription::EdgeSubscription(EdgeSubscription &&other) : state(std::move(other.state))
+{
+}
+
+EdgeSubscription &EdgeSubscription::operator=(EdgeSubscription &&other)
+{
+	if(this != &other)
+	{
+		cancel();
+		this->state = std::move(other.state);
+	}
+
+	return *this;
+}
+
+/*
+ * Destructor
+ */
+EdgeSubscription::~EdgeSubscription()
+{
+	cancel();
+}
+
+/*
+ * Description:
+ *	Stop watching the pin. Wakes the watching thread up through its cancel eventfd
+ *	and waits for it to exit, and waits for the pool workers already running the
+ *	handler, so the handler is not called again, nor still running, once this
+ *	returns. Edges already queued to a worker pool are discarded. Can be called
+ *	from the handler itself, which then only has itself left to finish.
+ */
+void EdgeSubscription::cancel(void)
+{
+	if(this->state == nullptr)
+	{
+		return;
+	}
+
+	this->state->deactivate();
+
+	const uint64_t ONE = 1;
+
+	if(this->state->cancelFileDescriptor != -1 && write(this->state->cancelFileDescriptor, &ONE, sizeof(ONE)) == -1)
+	{
+		perror("EdgeSubscription::cancel - Failed to wake up the watching thread: write()");
+	}
+
+	//From the handler, the thread exits once the handler returns.
+	if(this->state->watcher.joinable() && this->state->watcher.get_id() != this_thread::get_id())
+	{
+		this->state->watcher.join();
+	}
+
+	this->state.reset();
+}
+
+/*
+ * Description:
+ *	Whether the pin is still being watched: false once cancelled, or once the
+ *	watching thread has given up (timeout or error).
+ */
+bool EdgeSubscription::isActive(void) const
+{
+	return this->state != nullptr && this->state->active;
+}
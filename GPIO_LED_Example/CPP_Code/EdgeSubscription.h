@@ -0,0 +1,63 @@
+#ifndef H_EDGE_SUBSCRIPTION_H_
+#define H_EDGE_SUBSCRIPTION_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "GpioBase.h"
+
+class EdgeWorkerPool;
+
+/*
+ * What a subscription shares between its handle, the thread watching the pin and
+ * the worker pool (if any). Whoever lets go of it last frees it.
+ */
+struct EdgeSubscriptionState : public enable_shared_from_this<EdgeSubscriptionState>
+{
+	GpioBase::edgeHandler handler;
+	EdgeWorkerPool *pool;         //Runs the handler, or nullptr to run it on the watching thread
+	int cancelFileDescriptor;     //eventfd in the watching thread's epoll set, written by cancel()
+	atomic<bool> active;          //Cleared by cancel(), edges are no longer handed to the handler
+	thread watcher;
+
+	mutex handlersMutex;          //Guards runningHandlers, and the clearing of active by deactivate()
+	condition_variable handlersDone;
+	unsigned int runningHandlers; //Pool workers in the handler right now
+
+	EdgeSubscriptionState(GpioBase::edgeHandler handler, EdgeWorkerPool *pool);
+	~EdgeSubscriptionState();
+
+	void runHandler(const unsigned int PIN, const GpioBase::VALUE LEVEL, const uint64_t TIMESTAMP_NS);
+	void deactivate(void);
+};
+
+/*
+ * Handle to the edges of a pin, returned by GpioBase::triggerOnEdge(edgeHandler).
+ * The pin is watched on its own thread until cancel() is called, the handle is
+ * destroyed or (if inputWaitTimeMS is set) no edge comes in time.
+ *
+ * The pin must outlive the subscription. Handles can be moved but not copied.
+ */
+class EdgeSubscription
+{
+public:
+	EdgeSubscription();
+	explicit EdgeSubscription(const shared_ptr<EdgeSubscriptionState> &state);
+	~EdgeSubscription();
+
+	EdgeSubscription(const EdgeSubscription &) = delete;
+	EdgeSubscription &operator=(const EdgeSubscription &) = delete;
+	EdgeSubscription(EdgeSubscription &&other);
+	EdgeSubscription &operator=(EdgeSubscription &&other);
+
+	void cancel(void);
+	bool isActive(void) const;
+
+private:
+	shared_ptr<EdgeSubscriptionState> state;
+};
+
+#endif /* H_EDGE_SUBSCRIPTION_H_ */
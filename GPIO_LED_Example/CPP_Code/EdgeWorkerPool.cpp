@@ -0,0 +1,119 @@
+#include "EdgeWorkerPool.h"
+#include "EdgeSubscription.h"
+
+/*
+ * Description:
+ * 	Start the worker threads and allocate the queue.
+ *
+ * Args:
+ * 	threadCount The number of threads running handlers (at least 1)
+ * 	capacity The maximum number of queued edges, rounded up to a power of two
+ */
+EdgeWorkerPool::EdgeWorkerPool(unsigned int threadCount, size_t capacity) : mask(0), head(0), tail(0),
+	droppedCount(0), stopping(false)
+{
+	size_t size = 1;
+
+	while(size < capacity)
+	{
+		size <<= 1;
+	}
+
+	this->jobs.resize(size);
+	this->mask = size - 1;
+
+	if(threadCount == 0)
+	{
+		threadCount = 1;
+	}
+
+	for(unsigned int index = 0; index < threadCount; ++index)
+	{
+		this->workers.emplace_back(&EdgeWorkerPool::work, this);
+	}
+}
+
+/*
+ * Destructor. Edges still queued are run before the workers exit.
+ */
+EdgeWorkerPool::~EdgeWorkerPool()
+{
+	{
+		lock_guard<mutex> lock(this->jobsMutex);
+		this->stopping = true;
+	}
+
+	this->jobsCondition.notify_all();
+
+	for(thread &worker : this->workers)
+	{
+		worker.join();
+	}
+}
+
+/*
+ * Description:
+ * 	Queue an edge for the handler of subscription. Called by the thread watching the pin.
+ *
+ * Return
+ * 	False if the queue was full and the edge was dropped
+ */
+bool EdgeWorkerPool::submit(const shared_ptr<EdgeSubscriptionState> &subscription, const unsigned int PIN,
+							const GpioBase::VALUE LEVEL, const uint64_t TIMESTAMP_NS)
+{
+	{
+		lock_guard<mutex> lock(this->jobsMutex);
+
+		if(this->head - this->tail == this->jobs.size())
+		{
+			this->droppedCount++;
+			return false;
+		}
+
+		Job &job = this->jobs[this->head & this->mask];
+		job.subscription = subscription;
+		job.pin = PIN;
+		job.level = LEVEL;
+		job.timestampNs = TIMESTAMP_NS;
+		this->head++;
+	}
+
+	this->jobsCondition.notify_one();
+	return true;
+}
+
+uint64_t EdgeWorkerPool::getDroppedCount(void) const
+{
+	lock_guard<mutex> lock(this->jobsMutex);
+	return this->droppedCount;
+}
+
+void EdgeWorkerPool::work(void)
+{
+	unique_lock<mutex> lock(this->jobsMutex);
+
+	while(true)
+	{
+		this->jobsCondition.wait(lock, [this]() { return this->stopping || this->head != this->tail; });
+
+		if(this->head == this->tail)
+		{
+			break; //Stopping, and nothing left to run
+		}
+
+		Job &slot = this->jobs[this->tail & this->mask];
+		shared_ptr<EdgeSubscriptionState> subscription = std::move(slot.subscription);
+		const unsigned int PIN = slot.pin;
+		const GpioBase::VALUE LEVEL = slot.level;
+		const uint64_t TIMESTAMP_NS = slot.timestampNs;
+		this->tail++;
+
+		lock.unlock();
+
+		//Edges of a cancelled subscription are discarded, and cancel() waits for the ones being handled
+		subscription->runHandler(PIN, LEVEL, TIMESTAMP_NS);
+
+		subscription.reset();
+		lock.lock();
+	}
+}
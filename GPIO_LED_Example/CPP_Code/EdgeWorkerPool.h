@@ -0,0 +1,63 @@
+#ifndef H_EDGE_WORKER_POOL_H_
+#define H_EDGE_WORKER_POOL_H_
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "GpioBase.h"
+
+struct EdgeSubscriptionState;
+
+/*
+ * A fixed set of threads running the handlers of edge subscriptions, so that the
+ * threads watching the pins only hand edges over and go back to waiting, and slow
+ * handlers of many pins are serviced by a few threads rather than one per pin.
+ *
+ * Edges wait in a bounded queue allocated up front. When it is full the new edge is
+ * dropped and counted, see getDroppedCount(). The pool must outlive the
+ * subscriptions using it.
+ */
+class EdgeWorkerPool
+{
+public:
+	EdgeWorkerPool(unsigned int threadCount, size_t capacity = 1024);
+	~EdgeWorkerPool();
+
+	EdgeWorkerPool(const EdgeWorkerPool &) = delete;
+	EdgeWorkerPool &operator=(const EdgeWorkerPool &) = delete;
+
+	bool submit(const shared_ptr<EdgeSubscriptionState> &subscription, const unsigned int PIN,
+				const GpioBase::VALUE LEVEL, const uint64_t TIMESTAMP_NS);
+
+	size_t getThreadCount(void) const { return workers.size(); }
+	uint64_t getDroppedCount(void) const;
+
+private:
+	struct Job
+	{
+		shared_ptr<EdgeSubscriptionState> subscription;
+		unsigned int pin;
+		GpioBase::VALUE level;
+		uint64_t timestampNs;
+	};
+
+	vector<Job> jobs; //Ring of pending edges
+	size_t mask;
+	size_t head;
+	size_t tail;
+	uint64_t droppedCount;
+	bool stopping;
+
+	mutable mutex jobsMutex;
+	condition_variable jobsCondition;
+	vector<thread> workers;
+
+	void work(void);
+};
+
+#endif /* H_EDGE_WORKER_POOL_H_ */
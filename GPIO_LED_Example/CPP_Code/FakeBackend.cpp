@@ -0,0 +1,217 @@
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#include "FakeBackend.h"
+#include "PinTable.h"
+
+atomic<uint32_t> FakeBackend::registerFile[GPIO_BANKS][FakeBackend::REGISTERS_PER_BANK];
+
+/*
+ * The eventfd of the FakeBackend currently owning each GPIO, plus one so that the
+ * zero-initialized array means "no pin" without depending on static initialization order.
+ */
+static atomic<int> pinEventFileDescriptors[GPIO_COUNT];
+
+/*
+ * Description:
+ * 	Setup the chosen GPIO pin in the in-memory register file.
+ */
+FakeBackend::FakeBackend(unsigned int pin) : gpioPinNumber(pin), bank(MemMap::BANK::GPIO0),
+	mask(0), eventFileDescriptor(-1)
+{
+	if(pin >= GPIO_COUNT)
+	{
+		cout << "ERROR: FakeBackend - GPIO " << pin << " does not exist" << endl;
+		return;
+	}
+
+	this->bank = getPinDescriptor(pin).bank;
+	this->mask = getPinDescriptor(pin).mask;
+
+	this->eventFileDescriptor = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if(this->eventFileDescriptor == -1)
+	{
+		perror("FakeBackend - Failed to create the edge descriptor: eventfd()");
+		return;
+	}
+
+	//Like a sysfs value file, the descriptor reports ready once before any edge happens.
+	const uint64_t ONE = 1;
+	if(write(this->eventFileDescriptor, &ONE, sizeof(ONE)) == -1)
+	{
+		perror("FakeBackend - Failed to signal the edge descriptor: write()");
+	}
+
+	pinEventFileDescriptors[pin] = this->eventFileDescriptor + 1;
+}
+
+/*
+ * Description:
+ *	Updates the direction of the pin through the fake OE register (set bit = input).
+ */
+void FakeBackend::setDirection(const DIRECTION GPIO_DIRECTION) const
+{
+	if(GPIO_DIRECTION == DIRECTION::INPUT)
+	{
+		reg(this->bank, GPIO_OE_OFFSET).fetch_or(this->mask, memory_order_relaxed);
+	}
+	else
+	{
+		reg(this->bank, GPIO_OE_OFFSET).fetch_and(~this->mask, memory_order_relaxed);
+	}
+}
+
+/*
+ * Description:
+ *	Updates which edges are detected, through the fake RISINGDETECT/FALLINGDETECT registers.
+ */
+void FakeBackend::setEdge(const EDGE GPIO_EDGE) const
+{
+	const bool RISING = (GPIO_EDGE == EDGE::RISING || GPIO_EDGE == EDGE::BOTH);
+	const bool FALLING = (GPIO_EDGE == EDGE::FALLING || GPIO_EDGE == EDGE::BOTH);
+
+	if(RISING)
+	{
+		reg(this->bank, GPIO_RISINGDETECT_OFFSET).fetch_or(this->mask, memory_order_relaxed);
+	}
+	else
+	{
+		reg(this->bank, GPIO_RISINGDETECT_OFFSET).fetch_and(~this->mask, memory_order_relaxed);
+	}
+
+	if(FALLING)
+	{
+		reg(this->bank, GPIO_FALLINGDETECT_OFFSET).fetch_or(this->mask, memory_order_relaxed);
+	}
+	else
+	{
+		reg(this->bank, GPIO_FALLINGDETECT_OFFSET).fetch_and(~this->mask, memory_order_relaxed);
+	}
+}
+
+/*
+ * Description:
+ *	Program the fake DEBOUNCENABLE/DEBOUNCINGTIME registers, as RegisterBackend does.
+ *	The fake pads do not bounce, so the setting only shows up in the registers.
+ */
+bool FakeBackend::setDebounce(const uint64_t DEBOUNCE_NS) const
+{
+	if(DEBOUNCE_NS == 0)
+	{
+		reg(this->bank, GPIO_DEBOUNCENABLE_OFFSET).fetch_and(~this->mask, memory_order_relaxed);
+		return true;
+	}
+
+	reg(this->bank, GPIO_DEBOUNCINGTIME_OFFSET).store(GpioBase::getDebouncingTime(DEBOUNCE_NS), memory_order_relaxed);
+	reg(this->bank, GPIO_DEBOUNCENABLE_OFFSET).fetch_or(this->mask, memory_order_relaxed);
+
+	return true;
+}
+
+/*
+ * Description:
+ *	Drive the input of a pin, as the outside world would.
+ *
+ * Args:
+ *	GPIO_PIN_NUMBER The pin to drive
+ *	GPIO_VALUE The new level of the pin
+ *
+ * Return
+ * 	None
+ */
+void FakeBackend::setInput(const unsigned int GPIO_PIN_NUMBER, const VALUE GPIO_VALUE)
+{
+	if(GPIO_PIN_NUMBER < GPIO_COUNT)
+	{
+		driveInput(GPIO_PIN_NUMBER, GPIO_VALUE);
+	}
+}
+
+void FakeBackend::driveInput(const unsigned int GPIO_PIN_NUMBER, const VALUE GPIO_VALUE)
+{
+	const PinDescriptor &PIN = getPinDescriptor(GPIO_PIN_NUMBER);
+
+	const uint32_t PREVIOUS = (GPIO_VALUE == VALUE::HIGH) ?
+		reg(PIN.bank, GPIO_DATAIN_OFFSET).fetch_or(PIN.mask, memory_order_relaxed) :
+		reg(PIN.bank, GPIO_DATAIN_OFFSET).fetch_and(~PIN.mask, memory_order_relaxed);
+
+	const bool WAS_HIGH = (PREVIOUS & PIN.mask) != 0;
+	const bool IS_HIGH = (GPIO_VALUE == VALUE::HIGH);
+
+	if(WAS_HIGH == IS_HIGH)
+	{
+		return;
+	}
+
+	const unsigned int DETECT_OFFSET = IS_HIGH ? GPIO_RISINGDETECT_OFFSET : GPIO_FALLINGDETECT_OFFSET;
+
+	if(!(reg(PIN.bank, DETECT_OFFSET).load(memory_order_relaxed) & PIN.mask))
+	{
+		return;
+	}
+
+	reg(PIN.bank, GPIO_IRQSTATUS_RAW_0_OFFSET).fetch_or(PIN.mask, memory_order_relaxed);
+
+	const int EVENT_FILE_DESCRIPTOR = pinEventFileDescriptors[GPIO_PIN_NUMBER] - 1;
+	if(EVENT_FILE_DESCRIPTOR != -1)
+	{
+		const uint64_t ONE = 1;
+		if(write(EVENT_FILE_DESCRIPTOR, &ONE, sizeof(ONE)) == -1)
+		{
+			perror("FakeBackend - Failed to signal the edge descriptor: write()");
+		}
+	}
+}
+
+uint32_t FakeBackend::readRegister(const MemMap::BANK GPIO_BANK, const unsigned int OFFSET)
+{
+	return reg(GPIO_BANK, OFFSET).load(memory_order_relaxed);
+}
+
+/*
+ * Description:
+ *	Store into a fake register. As on the device, IRQSTATUS_0/1 are write 1 to clear:
+ *	the bits written are cleared from the latched IRQSTATUS_RAW_0/1.
+ */
+void FakeBackend::writeRegister(const MemMap::BANK GPIO_BANK, const unsigned int OFFSET, const uint32_t VALUE)
+{
+	if(OFFSET == GPIO_IRQSTATUS_0_OFFSET || OFFSET == GPIO_IRQSTATUS_1_OFFSET)
+	{
+		const unsigned int RAW_OFFSET = (OFFSET == GPIO_IRQSTATUS_0_OFFSET) ? GPIO_IRQSTATUS_RAW_0_OFFSET : GPIO_IRQSTATUS_RAW_1_OFFSET;
+
+		reg(GPIO_BANK, RAW_OFFSET).fetch_and(~VALUE, memory_order_relaxed);
+		return;
+	}
+
+	reg(GPIO_BANK, OFFSET).store(VALUE, memory_order_relaxed);
+}
+
+/*
+ * Description:
+ *	Clear every register of the fake banks.
+ */
+void FakeBackend::reset(void)
+{
+	for(unsigned int bank = 0; bank < GPIO_BANKS; ++bank)
+	{
+		for(unsigned int index = 0; index < REGISTERS_PER_BANK; ++index)
+		{
+			registerFile[bank][index].store(0, memory_order_relaxed);
+		}
+	}
+}
+
+/*
+ * Destructor
+ */
+FakeBackend::~FakeBackend()
+{
+	if(this->eventFileDescriptor != -1)
+	{
+		int expected = this->eventFileDescriptor + 1;
+		pinEventFileDescriptors[this->gpioPinNumber].compare_exchange_strong(expected, 0);
+
+		close(this->eventFileDescriptor);
+	}
+}
@@ -0,0 +1,88 @@
+#ifndef H_FAKE_BACKEND_H_
+#define H_FAKE_BACKEND_H_
+
+#include <atomic>
+#include <stdint.h>
+
+#include "GpioBase.h"
+#include "MemMap.h"
+
+/*
+ * GPIO backend backed by an in-memory register file shaped like the four GPIO
+ * banks, for running applications and benchmarks without a board. Outputs
+ * update DATAOUT (and DATAIN, as the pad would). Inputs are driven from the
+ * outside with FakeBackend::setInput(), which raises the edges the pin was set up
+ * to detect: the IRQSTATUS_RAW_0 bit is latched and the pin's eventfd is signalled.
+ */
+class FakeBackend
+{
+public:
+	typedef GpioBase::DIRECTION DIRECTION;
+	typedef GpioBase::VALUE VALUE;
+	typedef GpioBase::EDGE EDGE;
+
+	FakeBackend(unsigned int pin);
+	~FakeBackend();
+
+	FakeBackend(const FakeBackend &) = delete;
+	FakeBackend &operator=(const FakeBackend &) = delete;
+
+	inline void setValue(const VALUE GPIO_VALUE) const
+	{
+		if(GPIO_VALUE == VALUE::HIGH)
+		{
+			reg(bank, GPIO_DATAOUT_OFFSET).fetch_or(mask, memory_order_relaxed);
+		}
+		else
+		{
+			reg(bank, GPIO_DATAOUT_OFFSET).fetch_and(~mask, memory_order_relaxed);
+		}
+
+		//An output pad drives its own input
+		if(!(reg(bank, GPIO_OE_OFFSET).load(memory_order_relaxed) & mask))
+		{
+			driveInput(gpioPinNumber, GPIO_VALUE);
+		}
+	}
+
+	inline VALUE getValue(void) const
+	{
+		return (reg(bank, GPIO_DATAIN_OFFSET).load(memory_order_relaxed) & mask) ? VALUE::HIGH : VALUE::LOW;
+	}
+
+	bool readValue(VALUE &value) const
+	{
+		value = getValue();
+		return true;
+	}
+
+	void setDirection(const DIRECTION GPIO_DIRECTION) const;
+	void setEdge(const EDGE GPIO_EDGE) const;
+	bool setDebounce(const uint64_t DEBOUNCE_NS) const;
+
+	int getEdgeFileDescriptor(void) const { return eventFileDescriptor; }
+
+	static void setInput(const unsigned int GPIO_PIN_NUMBER, const VALUE GPIO_VALUE);
+	static uint32_t readRegister(const MemMap::BANK GPIO_BANK, const unsigned int OFFSET);
+	static void writeRegister(const MemMap::BANK GPIO_BANK, const unsigned int OFFSET, const uint32_t VALUE);
+	static void reset(void);
+
+private:
+	static const unsigned int REGISTERS_PER_BANK = GPIO_MAP_SIZE / sizeof(uint32_t);
+
+	static atomic<uint32_t> registerFile[GPIO_BANKS][REGISTERS_PER_BANK];
+
+	static inline atomic<uint32_t> &reg(const MemMap::BANK GPIO_BANK, const unsigned int OFFSET)
+	{
+		return registerFile[(unsigned int)GPIO_BANK][OFFSET / sizeof(uint32_t)];
+	}
+
+	static void driveInput(const unsigned int GPIO_PIN_NUMBER, const VALUE GPIO_VALUE);
+
+	unsigned int gpioPinNumber;
+	MemMap::BANK bank;
+	uint32_t mask;
+	int eventFileDescriptor;
+};
+
+#endif /* H_FAKE_BACKEND_H_ */
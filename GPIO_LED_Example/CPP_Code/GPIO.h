@@ -1,59 +1,89 @@
 #ifndef H_GPIO_H_
 #define H_GPIO_H_
 
-#include <iostream>
-#include <array>
+#include "GpioBase.h"
+#include "EdgeSubscription.h"
+#include "SysfsBackend.h"
+#include "TraceRecorder.h"
 
-using namespace std;
-typedef void (*edgeCallback)(void);
-
-#define GPIO_PINS 95
-
-class GPIO
+/*
+ * A GPIO pin, accessed through the backend chosen at compile time:
+ *     - SysfsBackend    /sys/class/gpio (the default, see the GPIO typedef below)
+ *     - RegisterBackend the bank registers through MemMap (RegisterBackend.h)
+ *     - FakeBackend     an in-memory register file (FakeBackend.h)
+ *
+ * The backend is a member, so setValue() and getValue() are direct (inlinable)
+ * calls into it, without any virtual dispatch. Application code written against
+ * BasicGPIO<BACKEND> runs unchanged on every backend.
+ *
+ * setValue() is recorded by the TraceRecorder while a recording runs.
+ */
+template<typename BACKEND>
+class BasicGPIO : public GpioBase
 {
 public:
-	enum class DIRECTION
+	/*
+	 * Description:
+	 * 	Setup the chosen GPIO pin.
+	 */
+	BasicGPIO(unsigned int pin, DIRECTION direction = DIRECTION::OUTPUT, EDGE edge = EDGE::NONE) : GpioBase(pin), backend(pin)
 	{
-		INPUT  = 0,
-		OUTPUT = 1
-	};
+		setValue(VALUE::LOW);
+		setDirection(direction);
+		setEdge(edge);
+	}
 
-	enum class VALUE
+	inline void setValue(const VALUE GPIO_VALUE) const
 	{
-		LOW  = 0,
-		HIGH = 1
-	};
+		backend.setValue(GPIO_VALUE);
+		TraceRecorder::recordOutput(this->gpioPinNumber, (uint32_t)GPIO_VALUE);
+	}
 
-	enum class EDGE
+	inline VALUE getValue(void) const
 	{
-		NONE    = 0,
-		RISING  = 1,
-		FALLING = 2,
-		BOTH    = 3
-	};
-
-	GPIO(unsigned int pin, DIRECTION = DIRECTION::OUTPUT, EDGE = EDGE::NONE);
-	~GPIO();
+		return backend.getValue();
+	}
 
-	void setValue(const VALUE GPIO_VALUE) const;
-	void setDirection(const DIRECTION GPIO_DIRECTION) const;
-	void setEdge(const EDGE GPIO_EDGE) const;
+	void setDirection(const DIRECTION GPIO_DIRECTION)
+	{
+		backend.setDirection(GPIO_DIRECTION);
+	}
 
-	void triggerOnEdge(edgeCallback callback);
+	void setEdge(const EDGE GPIO_EDGE)
+	{
+		backend.setEdge(GPIO_EDGE);
+		this->gpioEdge = GPIO_EDGE;
 
-	int inputWaitTimeMS; //Amount to wait for an input before returning
+		//The backend may only open its edge descriptor once an edge is requested.
+		setEdgeSource(backend.getEdgeFileDescriptor(), &readBackendValue, &backend);
+	}
 
-private:
+	/*
+	 * Description:
+	 * 	Debounce the pin. The backend's hardware debouncer is programmed when it has one
+	 * 	(it cannot filter longer than ~7.9 ms), and edges closer than DEBOUNCE_NS to
+	 * 	the last accepted edge are dropped before they are dispatched.
+	 *
+	 * Return
+	 * 	True if the hardware debouncer was programmed
+	 */
+	bool setDebounce(const uint64_t DEBOUNCE_NS)
+	{
+		setDebounceTime(DEBOUNCE_NS);
+		return backend.setDebounce(DEBOUNCE_NS);
+	}
 
-	static const string GPIO_PATH;
-	static const std::array<std::pair<unsigned int, std::string>, GPIO_PINS> GPIO_PIN_LOOKUP_TABLE;
+	BACKEND &getBackend(void) { return backend; }
 
-	string gpioPinPath;
-	unsigned int gpioPinNumber;
+private:
+	BACKEND backend;
 
-	const string getPinName(const unsigned int GPIO_PIN_NUMBER);
-	void pollEdge(edgeCallback callback) const;
-	bool writeToFile(const string fileName, const string value) const;
+	static bool readBackendValue(const void *backend, VALUE &value)
+	{
+		return static_cast<const BACKEND*>(backend)->readValue(value);
+	}
 };
 
+typedef BasicGPIO<SysfsBackend> GPIO;
+
 #endif /* H_GPIO_H_ */
@@ -0,0 +1,686 @@
+#include <string.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <thread>
+
+#include "GpioBase.h"
+#include "MemMap.h"
+#include "PinTable.h"
+#include "EdgeEventRing.h"
+#include "Timestamp.h"
+#include "EdgeStatistics.h"
+#include "EdgeSubscription.h"
+#include "EdgeWorkerPool.h"
+#include "EdgeReactor.h"
+#include "TraceRecorder.h"
+
+const string GpioBase::DEFAULT_GPIO_PATH = "/sys/class/gpio/";
+string GpioBase::GPIO_PATH = GpioBase::DEFAULT_GPIO_PATH;
+
+const string GpioBase::DEFAULT_PINMUX_PATH = "/sys/devices/platform/ocp/";
+string GpioBase::PINMUX_PATH = GpioBase::DEFAULT_PINMUX_PATH;
+
+/* The pinmux state that makes a header pin a GPIO (same as: config-pin <pin> gpio) */
+static const char PINMUX_GPIO_STATE[] = "gpio";
+
+/*
+ * Description:
+ * 	Common setup of a GPIO pin. The backend registers its edge descriptor afterwards
+ * 	through setEdgeSource().
+ */
+GpioBase::GpioBase(unsigned int pin) : gpioPinNumber(pin), gpioEdge(EDGE::NONE),
+	edgeFileDescriptor(-1), edgeValueReader(nullptr), edgeBackend(nullptr),
+	debounceTimeNs(0), lastEdgeTimeNs(0), debouncedEdgeCount(0)
+{
+	//Will apply only to GPIOs set as inputs.
+	inputWaitTimeMS = -1; //Wait indefinitely for a file descriptor to be ready
+}
+
+/*
+ * Description:
+ * 	Set where edges of this pin are reported.
+ *
+ * Args:
+ * 	FILE_DESCRIPTOR A descriptor that becomes ready (EPOLLPRI/EPOLLIN) on every edge
+ * 	reader Reads the value of the pin, used to tell rising from falling edges
+ * 	backend Passed to reader
+ */
+void GpioBase::setEdgeSource(const int FILE_DESCRIPTOR, valueReader reader, const void *backend)
+{
+	this->edgeFileDescriptor = FILE_DESCRIPTOR;
+	this->edgeValueReader = reader;
+	this->edgeBackend = backend;
+}
+
+/*
+ * Description:
+ *	Set the software debounce of the pin: an edge detected less than DEBOUNCE_NS
+ *	after the last accepted edge is treated as a bounce and dropped before it
+ *	reaches the callback or ring. 0 turns the filter off.
+ *
+ * Args:
+ *	DEBOUNCE_NS The hold-off time after an accepted edge, in ns
+ *
+ * Return
+ * 	None
+ */
+void GpioBase::setDebounceTime(const uint64_t DEBOUNCE_NS)
+{
+	this->debounceTimeNs = DEBOUNCE_NS;
+	this->lastEdgeTimeNs = 0;
+}
+
+/*
+ * Description:
+ *	Decide whether an edge is a real one or a bounce of the previous edge. Called by
+ *	whoever watches the pin (pollEdge() or GpioEventLoop) before dispatching.
+ *
+ * Args:
+ *	EDGE_TIME_NS When the edge was detected (monotonicTimeNs())
+ *
+ * Return
+ * 	True if the edge should be dispatched
+ */
+bool GpioBase::acceptEdge(const uint64_t EDGE_TIME_NS) const
+{
+	if(this->debounceTimeNs != 0 && this->lastEdgeTimeNs != 0 &&
+	   EDGE_TIME_NS - this->lastEdgeTimeNs < this->debounceTimeNs)
+	{
+		this->debouncedEdgeCount++;
+		return false;
+	}
+
+	this->lastEdgeTimeNs = EDGE_TIME_NS;
+	return true;
+}
+
+/*
+ * Description:
+ *	Convert a debounce time to the value of a bank's DEBOUNCINGTIME register, rounding
+ *	up to the next debounce clock period and saturating at the longest time (~7.9 ms).
+ *
+ * Args:
+ *	DEBOUNCE_NS The debounce time, in ns
+ *
+ * Return
+ * 	The DEBOUNCINGTIME register value
+ */
+uint32_t GpioBase::getDebouncingTime(const uint64_t DEBOUNCE_NS)
+{
+	const uint64_t PERIODS = (DEBOUNCE_NS + GPIO_DEBOUNCE_PERIOD_NS - 1) / GPIO_DEBOUNCE_PERIOD_NS;
+
+	if(PERIODS <= 1)
+	{
+		return 0;
+	}
+
+	return (PERIODS - 1 > GPIO_DEBOUNCINGTIME_MAX) ? GPIO_DEBOUNCINGTIME_MAX : (uint32_t)(PERIODS - 1);
+}
+
+/*
+ * Description:
+ * 	Access the lookup table to match a GPIO pin number with the physical pin number on the BBB.
+ *
+ * Args:
+ * 	PIN_NUMBER the GPIO pin number being used
+ *
+ * Return
+ * 	The physical pin number on the board that maps to the GPIO pin number being used,
+ * 	or nullptr if the GPIO is not broken out on the P8/P9 headers
+ */
+const char *GpioBase::getPinName(const unsigned int GPIO_PIN_NUMBER)
+{
+	if(GPIO_PIN_NUMBER >= GPIO_COUNT)
+	{
+		return nullptr;
+	}
+
+	return getPinDescriptor(GPIO_PIN_NUMBER).headerName;
+}
+
+/*
+ * Description:
+ *	Change the directory that stands in for /sys/class/gpio/. Only affects GPIO
+ *	objects created afterwards.
+ *
+ * Args:
+ *	path The new sysfs GPIO root, e.g. a tmpfs tree used for testing
+ *
+ * Return
+ * 	None
+ */
+void GpioBase::setGpioPath(const string &path)
+{
+	GPIO_PATH = path;
+
+	if(GPIO_PATH.empty() || GPIO_PATH[GPIO_PATH.size() - 1] != '/')
+	{
+		GPIO_PATH += "/";
+	}
+}
+
+const string &GpioBase::getGpioPath(void)
+{
+	return GPIO_PATH;
+}
+
+/*
+ * Description:
+ *	Change the directory holding the pinmux helpers (ocp:<PIN>_pinmux/state). Only
+ *	affects pins configured afterwards.
+ *
+ * Args:
+ *	path The new pinmux root, e.g. a tmpfs tree used for testing
+ *
+ * Return
+ * 	None
+ */
+void GpioBase::setPinmuxPath(const string &path)
+{
+	PINMUX_PATH = path;
+
+	if(PINMUX_PATH.empty() || PINMUX_PATH[PINMUX_PATH.size() - 1] != '/')
+	{
+		PINMUX_PATH += "/";
+	}
+}
+
+const string &GpioBase::getPinmuxPath(void)
+{
+	return PINMUX_PATH;
+}
+
+/*
+ * Description:
+ *	Configure pins as GPIOs and export them, without forking config-pin. Each header
+ *	pin has its pinmux state set to "gpio", then the pin is written to
+ *	/sys/class/gpio/export. Pins that are already muxed as GPIOs, or already exported,
+ *	are left alone, so calling this again is cheap.
+ *
+ * Args:
+ *	gpioPins The GPIO numbers of the pins to configure
+ *
+ * Return
+ * 	True if every pin was configured
+ */
+bool GpioBase::configureAll(const vector<unsigned int> &gpioPins)
+{
+	bool configured = true;
+
+	int gpioDirectoryDescriptor = open(GPIO_PATH.c_str(), O_RDONLY | O_DIRECTORY);
+	int exportFileDescriptor = -1; //Only opened if a pin needs exporting
+
+	for(unsigned int gpioPin : gpioPins)
+	{
+		if(!setPinmuxState(gpioPin))
+		{
+			configured = false;
+		}
+
+		char pinDirectory[16];
+		snprintf(pinDirectory, sizeof(pinDirectory), "gpio%u", gpioPin);
+
+		if(gpioDirectoryDescriptor != -1 && faccessat(gpioDirectoryDescriptor, pinDirectory, F_OK, 0) == 0)
+		{
+			continue; //Already exported
+		}
+
+		if(exportFileDescriptor == -1)
+		{
+			exportFileDescriptor = open((GPIO_PATH + "export").c_str(), O_WRONLY);
+			if(exportFileDescriptor == -1)
+			{
+				perror(("GpioBase::configureAll - Failed to open: " + GPIO_PATH + "export").c_str());
+				configured = false;
+				break;
+			}
+		}
+
+		// same as: echo <gpioPin> > /sys/class/gpio/export
+		char pinNumber[16];
+		const int LENGTH = snprintf(pinNumber, sizeof(pinNumber), "%u", gpioPin);
+
+		if(write(exportFileDescriptor, pinNumber, LENGTH) != LENGTH)
+		{
+			perror(("GpioBase::configureAll - Failed to export GPIO " + to_string(gpioPin)).c_str());
+			configured = false;
+		}
+	}
+
+	if(exportFileDescriptor != -1)
+	{
+		close(exportFileDescriptor);
+	}
+
+	if(gpioDirectoryDescriptor != -1)
+	{
+		close(gpioDirectoryDescriptor);
+	}
+
+	return configured;
+}
+
+/*
+ * Description:
+ *	Set the pinmux state of a header pin to "gpio" through its pinmux helper, e.g.
+ *	/sys/devices/platform/ocp/ocp:P9_23_pinmux/state, unless it already is.
+ *
+ * Args:
+ *	GPIO_PIN_NUMBER The GPIO number of the pin
+ *
+ * Return
+ * 	True if the pin is muxed as a GPIO (or has no pinmux helper, i.e. is not on a header)
+ */
+bool GpioBase::setPinmuxState(const unsigned int GPIO_PIN_NUMBER)
+{
+	const char *pinName = getPinName(GPIO_PIN_NUMBER);
+
+	if(pinName == nullptr)
+	{
+		return true;
+	}
+
+	//"p9.23" => "ocp:P9_23_pinmux/state"
+	char statePath[256];
+	snprintf(statePath, sizeof(statePath), "%socp:P%c_%s_pinmux/state", PINMUX_PATH.c_str(), pinName[1], &pinName[3]);
+
+	int fileDescriptor = open(statePath, O_RDONLY);
+	if(fileDescriptor == -1)
+	{
+		perror((string("GpioBase::setPinmuxState - Failed to open: ") + statePath).c_str());
+		return false;
+	}
+
+	const size_t STATE_LENGTH = sizeof(PINMUX_GPIO_STATE) - 1;
+	char currentState[32];
+	const ssize_t BYTES_READ = pread(fileDescriptor, currentState, sizeof(currentState), 0);
+
+	bool muxed = (BYTES_READ >= (ssize_t)STATE_LENGTH &&
+				  strncmp(currentState, PINMUX_GPIO_STATE, STATE_LENGTH) == 0 &&
+				  (BYTES_READ == (ssize_t)STATE_LENGTH || currentState[STATE_LENGTH] == '\n'));
+
+	close(fileDescriptor);
+
+	if(!muxed)
+	{
+		// same as: echo gpio > state (which is what config-pin <pin> gpio does)
+		fileDescriptor = open(statePath, O_WRONLY | O_TRUNC);
+		muxed = (fileDescriptor != -1 && write(fileDescriptor, PINMUX_GPIO_STATE, STATE_LENGTH) == (ssize_t)STATE_LENGTH);
+
+		if(!muxed)
+		{
+			perror((string("GpioBase::setPinmuxState - Failed to write: ") + statePath).c_str());
+		}
+
+		if(fileDescriptor != -1)
+		{
+			close(fileDescriptor);
+		}
+	}
+
+	return muxed;
+}
+
+/*
+ * Description:
+ *	Work out which edge was just detected. Pins watching a single edge can only
+ *	report that edge, pins watching both edges have their value read back.
+ *
+ * Return
+ * 	RISING or FALLING, or BOTH if the value could not be read
+ */
+GpioBase::EDGE GpioBase::getDetectedEdge(void) const
+{
+	if(this->gpioEdge != EDGE::BOTH)
+	{
+		return this->gpioEdge;
+	}
+
+	VALUE value;
+
+	if(this->edgeValueReader == nullptr || !this->edgeValueReader(this->edgeBackend, value))
+	{
+		return EDGE::BOTH;
+	}
+
+	return (value == VALUE::HIGH) ? EDGE::RISING : EDGE::FALLING;
+}
+
+/*
+ * Description:
+ *	Work out the level of the pin after the edge just detected: read back through the
+ *	backend, or implied by the edge watched if it cannot be read.
+ */
+GpioBase::VALUE GpioBase::getEdgeLevel(void) const
+{
+	VALUE value;
+
+	if(this->edgeValueReader != nullptr && this->edgeValueReader(this->edgeBackend, value))
+	{
+		return value;
+	}
+
+	return (this->gpioEdge == EDGE::FALLING) ? VALUE::LOW : VALUE::HIGH;
+}
+
+/*
+ * Description:
+ *	Call callback on every edge detected, from a thread watching the pin. Blocks until
+ *	no edge comes within inputWaitTimeMS, see triggerOnEdge(edgeHandler) to watch a
+ *	pin without blocking.
+ *
+ * Args:
+ *	callback The function called every time an edge is detected
+ *
+ * Return
+ * 	None
+ */
+void GpioBase::triggerOnEdge(edgeCallback callback)
+{
+	thread edgeTrigger(&GpioBase::pollEdge, this, callback, nullptr, nullptr);
+	edgeTrigger.join();
+}
+
+/*
+ * Description:
+ *	Same as triggerOnEdge(edgeCallback), except that rather than calling a callback
+ *	on the polling thread, every edge is recorded (with its time and direction) into
+ *	the ring. A consumer thread started by the caller drains the ring.
+ *
+ * Args:
+ *	ring The queue the detected edges are pushed into
+ *
+ * Return
+ * 	None
+ */
+void GpioBase::triggerOnEdge(EdgeEventRing &ring)
+{
+	thread edgeTrigger(&GpioBase::pollEdge, this, nullptr, &ring, nullptr);
+	edgeTrigger.join();
+}
+
+/*
+ * Description:
+ *	Watch the pin for edges on a thread of its own and return straight away. handler
+ *	is called with the pin number, the level after the edge and the time the edge was
+ *	detected, so one handler (e.g. a lambda capturing its state) can serve many pins.
+ *
+ * Args:
+ *	handler The function object called every time an edge is detected
+ *	pool The threads running handler, or nullptr to run it on the thread watching the
+ *	     pin. A pool keeps slow handlers from delaying the detection of the next edge.
+ *
+ * Return
+ * 	The subscription: the pin is watched until it is cancelled or destroyed
+ */
+EdgeSubscription GpioBase::triggerOnEdge(edgeHandler handler, EdgeWorkerPool *pool)
+{
+	shared_ptr<EdgeSubscriptionState> subscription = make_shared<EdgeSubscriptionState>(handler, pool);
+
+	if(subscription->active)
+	{
+		subscription->watcher = thread(&GpioBase::pollEdge, this, nullptr, nullptr, subscription);
+	}
+
+	return EdgeSubscription(subscription);
+}
+
+/*
+ * Description:
+ *	Wait for an edge from a coroutine run by an EdgeReactor, without a thread of its
+ *	own: co_await pin.edge(GPIO::EDGE::RISING, 100000000). The pin's configured edge
+ *	decides what wakes the reactor, EDGE_TYPE picks which of those complete the wait.
+ *
+ * Args:
+ *	EDGE_TYPE RISING, FALLING or BOTH
+ *	TIMEOUT_NS How long to wait, EdgeAwaitable::FOREVER (the default) for no limit
+ *
+ * Return
+ * 	The awaitable. co_await gives an EdgeResult, false if it timed out.
+ */
+EdgeAwaitable GpioBase::edge(const EDGE EDGE_TYPE, const uint64_t TIMEOUT_NS) const
+{
+	return EdgeAwaitable(this, EDGE_TYPE, TIMEOUT_NS);
+}
+
+/*
+ * Read urgent data on edge trigger. Each edge is either handed to callback or,
+ * if ring is not NULL, pushed into the ring or, if subscription is not NULL, handed
+ * to its handler (directly or through its worker pool).
+ */
+void GpioBase::pollEdge(edgeCallback callback, EdgeEventRing *ring, shared_ptr<EdgeSubscriptionState> subscription) const
+{
+	//Scheduling, pinning and prefaulting asked for with setRealTimeProfile(), for this thread only
+	ScopedRealTimeProfile realTime(this->realTimeProfile);
+
+	/*
+	 * What is a file descriptor:
+	 * In Unix and related computer operating systems, a file descriptor is an abstract
+	 * indicator (handle) used to access a file or other input/output resource, such as
+	 * a pipe or network socket. File descriptors form part of the POSIX application
+	 * programming interface.
+	 */
+
+	/* ************************************************************************
+	 * Create a new epoll instance to monitor a file descriptor for I/O
+	 * ************************************************************************
+	 * returns  a  file  descriptor referring to the new epoll
+	 * instance.  This file descriptor is used for all the subsequent calls to
+	 * the  epoll  interface.   When  no  longer required, the file descriptor
+	 * returned by epoll_create() should be closed by  using  close(2).   When
+	 * all  file  descriptors referring to an epoll instance have been closed,
+	 * the kernel destroys the instance and releases the associated  resources
+	 * for reuse.
+	 */
+	int epollFileDescriptor = epoll_create(1);
+    if (epollFileDescriptor == -1)
+    {
+	   perror("GpioBase::pollEdge - Failed to create a new epoll instance: epoll_create()");
+	   exit(EXIT_FAILURE);
+    }
+
+    /* ************************************************************************
+     * The edge descriptor was opened by the backend (for sysfs, the "value" file). This file tells us when the button is pressed
+     * ************************************************************************
+     * It was opened with O_NONBLOCK so that reading it never blocks the calling thread.
+     */
+    int fileDescriptor = this->edgeFileDescriptor;
+    if ( fileDescriptor == -1)
+    {
+       perror("GpioBase::pollEdge - The pin has no edge descriptor open");
+       exit(EXIT_FAILURE);
+    }
+
+    /* ************************************************************************
+     * Describe the object linked to the file descriptor
+     * ************************************************************************
+     * EPOLLIN:
+     * 			The associated file is available for read(2) operations.
+     *
+     * EPOLLET:
+     * 			Sets the Edge Triggered behavior for the associated file descriptor.
+     *
+     * EPOLLPRI:
+     * 			There is urgent data available for read(2) operations.
+     */
+
+    //TODO: Look into adding EPOLLONESHOT. Because the epoll_wait function always seems to return 1 time on the first go around,
+    //      adding EPOLLONESHOT, will remove the file descriptor before the button is even actually pressed.
+	struct epoll_event epollEvent;
+    epollEvent.events = EPOLLIN | EPOLLET | EPOLLPRI; // read operation | edge triggered | urgent data
+    epollEvent.data.fd = fileDescriptor;              // Associate the file's file descriptor
+
+    /* ************************************************************************
+     * Add the file descriptor entry to the new epoll instance created
+     * ************************************************************************
+     * EPOLL_CTL_ADD:
+     * 			Register the target file descriptor fileDescriptor onto the epoll instance
+     *        	referred to by the file descriptor epollFileDescriptor, and associate the
+     *        	event event with the internal file linked to fileDescriptor.
+     */
+    if (epoll_ctl(epollFileDescriptor,	// An instance of epoll to be manipulated
+    			  EPOLL_CTL_ADD, 		// Add a file descriptor to the interface
+				  fileDescriptor,		// The target of the operation
+				  &epollEvent)			// Describes which events the caller is interested in and any associated user data
+    		== -1)
+    {
+       perror("GpioBase::pollEdge - Failed to add control interface: epoll_ctl()");
+       close(epollFileDescriptor);
+       exit(EXIT_FAILURE);
+    }
+
+    /* ************************************************************************
+     * A subscription is cancelled by writing to its eventfd, which wakes epoll_wait() up
+     * ************************************************************************/
+    const int CANCEL_FILE_DESCRIPTOR = (subscription != nullptr) ? subscription->cancelFileDescriptor : -1;
+
+    if (CANCEL_FILE_DESCRIPTOR != -1)
+    {
+    	struct epoll_event cancelEvent;
+    	cancelEvent.events = EPOLLIN;
+    	cancelEvent.data.fd = CANCEL_FILE_DESCRIPTOR;
+
+    	if (epoll_ctl(epollFileDescriptor, EPOLL_CTL_ADD, CANCEL_FILE_DESCRIPTOR, &cancelEvent) == -1)
+    	{
+    		perror("GpioBase::pollEdge - Failed to add the cancel descriptor: epoll_ctl()");
+    		subscription->active = false;
+    		close(epollFileDescriptor);
+    		return;
+    	}
+    }
+
+    int epollTriggerCount = 0; //The number of times the epoll_wait() function returns.
+    int epollEventsNum = 0;    //The number of triggered events, one for every file descriptor.
+
+	#ifdef DEBUG
+		const unsigned int MAX_BYTES_TO_READ = 2;
+		char readBuffer[MAX_BYTES_TO_READ];
+		int bytesRead = 0;
+	#endif
+
+	while(true)
+	{
+	    /* ************************************************************************
+	     * Wait indefinitely until a file descriptor is ready for the requested I/O
+	     * ************************************************************************
+		 * int epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout);
+		 *
+		 * The epoll_wait() system call waits for events on the epoll(7) instance
+		 * referred to by the file descriptor epfd. The memory area pointed to by
+		 * events will contain the events that will be available for the caller.
+		 * Up to maxevents are returned by epoll_wait(). The maxevents argument must
+		 * be greater than zero.
+		 */
+		//NOTE: If a timeout value is specified, and epoll_wait returns, the timeout value restarts.
+		//      to make it work so that after it is pressed once this function exits, add a break
+		//      after call to the callback function.
+		epollEventsNum = epoll_wait(epollFileDescriptor, &epollEvent, 1, this->inputWaitTimeMS);
+		const uint64_t WAKEUP_TIME_NS = monotonicTimeNs(); //Taken first so that the edge time is as accurate as possible
+		epollTriggerCount++; //It seems like epoll_wait always returns once, use to to ignore the first trigger.
+
+		if (epollEventsNum == -1)
+		{
+			perror("GpioBase::pollEdge - Failed to wait for a file descriptor to be ready: epoll_wait()");
+			break;
+		}
+		else if(epollEventsNum == 0)
+		{
+			//No file descriptor became read during the requested timeout.
+			EdgeStatistics::recordTimeout(this->gpioPinNumber);
+			cout << "Warning: No file descriptor became available within the time specified (" << this->inputWaitTimeMS << " ms)" << endl;
+			break;
+		}
+		else if(epollEvent.data.fd == CANCEL_FILE_DESCRIPTOR)
+		{
+			//The subscription was cancelled
+			break;
+		}
+		else
+		{
+			//Trigger occurred
+			EdgeStatistics::recordWakeup(this->gpioPinNumber);
+
+			if(epollEvent.data.fd == fileDescriptor && //Check if the trigger belongs to the file descriptor specified above
+			   epollTriggerCount > 1 &&                //Ignore the first trigger.
+			   acceptEdge(WAKEUP_TIME_NS))             //Drop bounces of the last edge.
+			{
+				#ifdef DEBUG
+					bytesRead = read(epollEvent.data.fd, readBuffer,MAX_BYTES_TO_READ);
+
+					if(bytesRead == -1)
+					{
+						perror("GpioBase::pollEdge - Error reading file descriptor. read()");
+					}
+					else
+					{
+						cout << "Reading " << bytesRead << " bytes: ";
+						for(unsigned int i = 0; i < (unsigned int)bytesRead; ++i)
+						{
+							cout << readBuffer[i];
+						}
+						cout << endl;
+					}
+
+					/* ************************************************************************
+					 * Reposition the file offset of the open file descriptor.
+					 * ************************************************************************
+					 * Call to read() reads through the entire file and leaves the read cursor
+					 * at the end of the file. Call seek() to return the read cursor to the start
+					 * of the file.
+					 */
+					lseek(epollEvent.data.fd, 0, SEEK_SET);
+				#endif
+
+				if(TraceRecorder::isRecording())
+				{
+					TraceRecorder::recordEdge(this->gpioPinNumber, (uint32_t)getEdgeLevel(), WAKEUP_TIME_NS);
+				}
+
+				const uint64_t DISPATCH_TIME_NS = monotonicTimeNs();
+
+				if(ring != nullptr)
+				{
+					ring->push({WAKEUP_TIME_NS, this->gpioPinNumber, getDetectedEdge()});
+				}
+				else if(subscription != nullptr)
+				{
+					if(subscription->pool != nullptr)
+					{
+						subscription->pool->submit(subscription, this->gpioPinNumber, getEdgeLevel(), WAKEUP_TIME_NS);
+					}
+					else if(subscription->active)
+					{
+						subscription->handler(this->gpioPinNumber, getEdgeLevel(), WAKEUP_TIME_NS);
+					}
+				}
+				else
+				{
+					callback();
+				}
+
+				EdgeStatistics::recordEdge(this->gpioPinNumber, DISPATCH_TIME_NS - WAKEUP_TIME_NS, monotonicTimeNs() - DISPATCH_TIME_NS);
+			}
+			else
+			{
+				EdgeStatistics::recordSpuriousWakeup(this->gpioPinNumber);
+			}
+		}
+	}
+
+    if (subscription != nullptr)
+    {
+    	subscription->active = false; //Timed out, cancelled or failed: either way no more edges
+    }
+
+    close(epollFileDescriptor);
+}
+
+/*
+ * Destructor
+ */
+GpioBase::~GpioBase()
+{
+}
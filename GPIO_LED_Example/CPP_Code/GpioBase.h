@@ -0,0 +1,120 @@
+#ifndef H_GPIO_BASE_H_
+#define H_GPIO_BASE_H_
+
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "RealTimeProfile.h"
+
+using namespace std;
+typedef void (*edgeCallback)(void);
+
+class EdgeEventRing;
+class EdgeSubscription;
+class EdgeAwaitable;
+class EdgeWorkerPool;
+struct EdgeSubscriptionState;
+
+/*
+ * The part of a GPIO that does not depend on how the pin is accessed: the
+ * DIRECTION/VALUE/EDGE types, configuring pins as GPIOs (pinmux + export), and
+ * waiting for edges on the descriptor the backend provides. See GPIO.h for the
+ * backend-specific front end.
+ */
+class GpioBase
+{
+public:
+	enum class DIRECTION
+	{
+		INPUT  = 0,
+		OUTPUT = 1
+	};
+
+	enum class VALUE
+	{
+		LOW  = 0,
+		HIGH = 1
+	};
+
+	enum class EDGE
+	{
+		NONE    = 0,
+		RISING  = 1,
+		FALLING = 2,
+		BOTH    = 3
+	};
+
+	/* Called for every edge with the GPIO pin number, the level after the edge and the time it was detected */
+	typedef function<void(unsigned int pin, VALUE level, uint64_t timestampNs)> edgeHandler;
+
+	GpioBase(const GpioBase &) = delete;
+	GpioBase &operator=(const GpioBase &) = delete;
+
+	void triggerOnEdge(edgeCallback callback);
+	void triggerOnEdge(EdgeEventRing &ring);
+	EdgeSubscription triggerOnEdge(edgeHandler handler, EdgeWorkerPool *pool = nullptr);
+	EdgeAwaitable edge(const EDGE EDGE_TYPE, const uint64_t TIMEOUT_NS = UINT64_MAX) const;
+
+	unsigned int getPinNumber(void) const { return gpioPinNumber; }
+	int getEdgeFileDescriptor(void) const { return edgeFileDescriptor; }
+	EDGE getEdge(void) const { return gpioEdge; }
+	EDGE getDetectedEdge(void) const;
+
+	void setDebounceTime(const uint64_t DEBOUNCE_NS);
+	uint64_t getDebounceTime(void) const { return debounceTimeNs; }
+	uint64_t getDebouncedEdgeCount(void) const { return debouncedEdgeCount; }
+	bool acceptEdge(const uint64_t EDGE_TIME_NS) const;
+
+	int inputWaitTimeMS; //Amount to wait for an input before returning
+
+	void setRealTimeProfile(const RealTimeProfile &profile) { realTimeProfile = profile; }
+	const RealTimeProfile &getRealTimeProfile(void) const { return realTimeProfile; }
+
+	static void setGpioPath(const string &path);
+	static const string &getGpioPath(void);
+	static void setPinmuxPath(const string &path);
+	static const string &getPinmuxPath(void);
+
+	static bool configureAll(const vector<unsigned int> &gpioPins);
+	static const char *getPinName(const unsigned int GPIO_PIN_NUMBER);
+	static uint32_t getDebouncingTime(const uint64_t DEBOUNCE_NS);
+
+protected:
+	/* Reads the pin's value through the backend, without reporting errors */
+	typedef bool (*valueReader)(const void *backend, VALUE &value);
+
+	GpioBase(unsigned int pin);
+	~GpioBase();
+
+	void setEdgeSource(const int FILE_DESCRIPTOR, valueReader reader, const void *backend);
+
+	unsigned int gpioPinNumber;
+	EDGE gpioEdge;
+
+private:
+
+	static const string DEFAULT_GPIO_PATH;
+	static string GPIO_PATH;
+	static const string DEFAULT_PINMUX_PATH;
+	static string PINMUX_PATH;
+
+	int edgeFileDescriptor; //Becomes ready when an edge is detected, owned by the backend
+	valueReader edgeValueReader;
+	const void *edgeBackend;
+
+	uint64_t debounceTimeNs;             //Edges closer than this to the last accepted edge are bounces
+	mutable uint64_t lastEdgeTimeNs;     //Time of the last accepted edge, only touched by the thread watching the pin
+	mutable uint64_t debouncedEdgeCount; //Edges dropped as bounces
+
+	RealTimeProfile realTimeProfile; //Applied to the thread running pollEdge()
+
+	static bool setPinmuxState(const unsigned int GPIO_PIN_NUMBER);
+	VALUE getEdgeLevel(void) const;
+	void pollEdge(edgeCallback callback, EdgeEventRing *ring, shared_ptr<EdgeSubscriptionState> subscription) const;
+};
+
+#endif /* H_GPIO_BASE_H_ */
@@ -0,0 +1,1546 @@
+/*
+ * Non-interactive GPIO benchmark suite, built with "make bench".
+ *
+ * Measures, for every way of driving a pin:
+ *     - throughput (operations/sec)
+ *     - latency per operation (mean, p50, p99, p999 in ns, over batches of calls)
+ *     - heap allocations per operation
+ * and the edge-to-callback latency of GpioBase::pollEdge(), and the sample rate
+ * and jitter SampleCapture achieves on DATAIN, and the per-step timing error of
+ * WaveformPlayer, the throughput of SoftSpi on a loopback register model, the
+ * edge wakeup latency with and without a RealTimeProfile, a stress test of
+ * many threads driving and configuring pins of one bank, counting lost updates,
+ * the cost and accuracy of EdgeCounter, the accuracy of PulseCapture, and the
+ * cost of recording a trace with TraceRecorder and converting it to VCD,
+ * drops, latency and CPU time of both edge paths under a replayed edge load, and
+ * the lateness and store coalescing of OutputScheduler with thousands of pending
+ * changes.
+ *
+ * Everything runs against stand-ins, so it works on any Linux machine: a fake
+ * /sys/class/gpio tree, a sparse file in place of /dev/mem and the FakeBackend.
+ * The results are written to stdout as JSON so they can be tracked over time.
+ *
+ * Usage: GPIO_BENCH [iterations]
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "GPIO.h"
+#include "FakeBackend.h"
+#include "RegisterBackend.h"
+#include "MemMap.h"
+#include "SampleCapture.h"
+#include "WaveformPlayer.h"
+#include "SoftSpi.h"
+#include "LatencySelfTest.h"
+#include "EdgeWorkerPool.h"
+#include "EdgeReactor.h"
+#include "EdgeStatistics.h"
+#include "EdgeCounter.h"
+#include "PulseCapture.h"
+#include "TraceRecorder.h"
+#include "TraceReplay.h"
+#include "OutputScheduler.h"
+#include "PinTable.h"
+#include "CpuAffinity.h"
+#include "Timestamp.h"
+
+using namespace std;
+
+/* ************************************************************************
+ * Allocation counting: every operator new of the process goes through here.
+ * ************************************************************************/
+static atomic<uint64_t> allocationCount(0);
+
+void *operator new(size_t size)
+{
+	allocationCount.fetch_add(1, memory_order_relaxed);
+
+	void *memory = malloc(size == 0 ? 1 : size);
+	if(memory == nullptr)
+	{
+		throw bad_alloc();
+	}
+
+	return memory;
+}
+
+//GCC matches new expressions against the free() below once it is inlined, but here operator new is malloc()
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+void operator delete(void *memory) noexcept
+{
+	free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept
+{
+	operator delete(memory);
+}
+
+#pragma GCC diagnostic pop
+
+/* ************************************************************************
+ * Stand-ins
+ * ************************************************************************/
+static const string BENCH_ROOT = "/tmp/gpio_bench";
+static const string FAKE_GPIO_PATH = BENCH_ROOT + "/sys/class/gpio/";
+static const string FAKE_PINMUX_PATH = BENCH_ROOT + "/sys/devices/platform/ocp/";
+static const string FAKE_DEV_MEM = BENCH_ROOT + "/mem";
+
+static const unsigned int LED_GPIO = 49;    //P9.23
+static const unsigned int BUTTON_GPIO = 115; //P9.27
+
+static void createFile(const string &path, const string &contents, const off_t SIZE = 0)
+{
+	int fileDescriptor = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+	if(fileDescriptor == -1 ||
+	   write(fileDescriptor, contents.c_str(), contents.size()) != (ssize_t)contents.size() ||
+	   (SIZE > 0 && ftruncate(fileDescriptor, SIZE) != 0))
+	{
+		perror(("GpioBench - Failed to create " + path).c_str());
+		exit(EXIT_FAILURE);
+	}
+
+	close(fileDescriptor);
+}
+
+static void createStandIns(void)
+{
+	system(("rm -rf " + BENCH_ROOT).c_str());
+	system(("mkdir -p " + FAKE_GPIO_PATH + "gpio49 " + FAKE_PINMUX_PATH + "ocp:P9_23_pinmux").c_str());
+
+	createFile(FAKE_GPIO_PATH + "export", "");
+	createFile(FAKE_GPIO_PATH + "gpio49/value", "0");
+	createFile(FAKE_GPIO_PATH + "gpio49/direction", "in");
+	createFile(FAKE_GPIO_PATH + "gpio49/edge", "none");
+	createFile(FAKE_PINMUX_PATH + "ocp:P9_23_pinmux/state", "gpio");
+
+	//Sparse file covering the register windows of every bank
+	createFile(FAKE_DEV_MEM, "", GPIO3_MEM_MAP_ADDR + GPIO_MAP_SIZE);
+
+	GpioBase::setGpioPath(FAKE_GPIO_PATH);
+	GpioBase::setPinmuxPath(FAKE_PINMUX_PATH);
+}
+
+/* ************************************************************************
+ * Results: one JSON object per run, filed under a section of the report
+ * ************************************************************************/
+class JsonRecord
+{
+public:
+	explicit JsonRecord(const string &name) : first(false)
+	{
+		this->text << "{\"name\": \"" << name << "\"";
+	}
+
+	template<typename VALUE>
+	JsonRecord &add(const char *KEY, const VALUE &value)
+	{
+		key(KEY) << value;
+		return *this;
+	}
+
+	JsonRecord &add(const char *KEY, const bool VALUE)
+	{
+		key(KEY) << (VALUE ? "true" : "false");
+		return *this;
+	}
+
+	/* The fields added until close() go into an object named KEY */
+	JsonRecord &open(const char *KEY)
+	{
+		key(KEY) << "{";
+		this->first = true;
+		return *this;
+	}
+
+	JsonRecord &close(void)
+	{
+		this->text << "}";
+		return *this;
+	}
+
+	string str(void) const { return this->text.str() + "}"; }
+
+private:
+	ostringstream text;
+	bool first; //No comma before the first field of an object
+
+	ostream &key(const char *KEY)
+	{
+		this->text << (this->first ? "" : ", ") << "\"" << KEY << "\": ";
+		this->first = false;
+		return this->text;
+	}
+};
+
+/* The sections of the report, in the order they are printed */
+static vector<pair<string, vector<string>>> sections =
+{
+	{"benchmarks", {}}, {"captures", {}}, {"waveforms", {}}, {"transfers", {}}, {"concurrency", {}},
+	{"edge_counters", {}}, {"pulse_capture", {}}, {"trace_recorder", {}}, {"trace_replay", {}},
+	{"output_scheduler", {}}, {"wakeup_latency", {}}
+};
+
+static void addRecord(const string &section, const JsonRecord &record)
+{
+	for(pair<string, vector<string>> &entry : sections)
+	{
+		if(entry.first == section)
+		{
+			entry.second.push_back(record.str());
+			return;
+		}
+	}
+
+	cerr << "ERROR: GpioBench - no section " << section << " in the report" << endl;
+}
+
+/* A mean/percentiles/max object, as reported by LatencySelfTest and TraceReplay */
+template<typename REPORT>
+static void addLatency(JsonRecord &record, const REPORT &report)
+{
+	record.open("ns").add("mean", report.meanNs).add("p50", report.p50Ns).add("p99", report.p99Ns)
+		  .add("p999", report.p999Ns).add("max", report.maxNs).close();
+}
+
+/* ************************************************************************
+ * Measurement
+ * ************************************************************************/
+static uint64_t percentile(const vector<uint64_t> &sorted, const double FRACTION)
+{
+	if(sorted.empty())
+	{
+		return 0;
+	}
+
+	size_t index = (size_t)(FRACTION * (double)(sorted.size() - 1) + 0.5);
+	return sorted[min(index, sorted.size() - 1)];
+}
+
+/*
+ * Description:
+ * 	Add a run of the "benchmarks" section from its latency samples, OPS_PER_SAMPLE
+ * 	calls each.
+ *
+ * Return
+ * 	The median of the samples
+ */
+static uint64_t addResult(const string &name, vector<uint64_t> &samples, const double OPS_PER_SECOND, const double ALLOCATIONS_PER_OP,
+						  const unsigned long OPS_PER_SAMPLE = 1)
+{
+	sort(samples.begin(), samples.end());
+
+	double total = 0;
+	for(uint64_t sample : samples)
+	{
+		total += (double)sample;
+	}
+
+	const uint64_t P50_NS = percentile(samples, 0.50);
+	const uint64_t P99_NS = percentile(samples, 0.99);
+	const uint64_t P999_NS = percentile(samples, 0.999);
+
+	addRecord("benchmarks", JsonRecord(name)
+		.add("iterations", samples.size() * OPS_PER_SAMPLE)
+		.add("ops_per_sec", (uint64_t)OPS_PER_SECOND)
+		.open("ns_per_op").add("mean", samples.empty() ? 0 : total / (double)samples.size())
+			.add("p50", P50_NS).add("p99", P99_NS).add("p999", P999_NS).close()
+		.add("ops_per_sample", OPS_PER_SAMPLE)
+		.add("allocs_per_op", ALLOCATIONS_PER_OP));
+
+	cerr << name << ": " << (unsigned long)OPS_PER_SECOND << " ops/sec, p50 " << P50_NS
+		 << " ns, p99 " << P99_NS << " ns, p999 " << P999_NS << " ns, "
+		 << ALLOCATIONS_PER_OP << " allocations/op" << endl;
+
+	return P50_NS;
+}
+
+/* Calls timed together by measure(), so a clock read (~40 ns) adds ~1 ns to each */
+static const unsigned long MEASURE_BATCH = 32;
+
+/* Median cost of a clock read, taken off the samples of operations that cannot be batched */
+static uint64_t clockReadNs = 0;
+
+/*
+ * Description:
+ * 	Run OPERATION ITERATIONS times back to back for the throughput and allocation
+ * 	count, then again in batches of MEASURE_BATCH calls for the latency distribution.
+ * 	Every sample is the mean time per call of one batch, so the cost of reading the
+ * 	clock does not swamp the fastest operations (at the price of smoothing the tail).
+ *
+ * Return
+ * 	The median time per call, in ns
+ */
+template<typename OPERATION>
+static uint64_t measure(const string &name, const unsigned long ITERATIONS, OPERATION operation)
+{
+	const unsigned long BATCH = min(MEASURE_BATCH, max(ITERATIONS, 1UL));
+	vector<uint64_t> samples(max(ITERATIONS / BATCH, 1UL));
+
+	const uint64_t ALLOCATIONS_BEFORE = allocationCount.load();
+	const uint64_t START = monotonicTimeNs();
+
+	for(unsigned long i = 0; i < ITERATIONS; ++i)
+	{
+		operation(i);
+	}
+
+	const uint64_t ELAPSED = monotonicTimeNs() - START;
+	const uint64_t ALLOCATIONS = allocationCount.load() - ALLOCATIONS_BEFORE;
+
+	for(unsigned long sample = 0; sample < samples.size(); ++sample)
+	{
+		const uint64_t BATCH_START = monotonicTimeNs();
+
+		for(unsigned long i = sample * BATCH; i < (sample + 1) * BATCH; ++i)
+		{
+			operation(i);
+		}
+
+		samples[sample] = (monotonicTimeNs() - BATCH_START + BATCH / 2) / BATCH;
+	}
+
+	return addResult(name, samples, (double)ITERATIONS * 1e9 / (double)(ELAPSED == 0 ? 1 : ELAPSED), (double)ALLOCATIONS / (double)ITERATIONS, BATCH);
+}
+
+/* ************************************************************************
+ * Edge-to-callback latency of pollEdge()
+ * ************************************************************************/
+static atomic<uint64_t> edgeRaisedNs(0);
+static atomic<bool> edgeHandled(false);
+static vector<uint64_t> *edgeLatencies = nullptr;
+
+static void recordEdge(void)
+{
+	edgeLatencies->push_back(monotonicTimeNs() - edgeRaisedNs.load(memory_order_acquire));
+	edgeHandled.store(true, memory_order_release);
+}
+
+static void measureEdgeLatency(const unsigned long EDGES)
+{
+	BasicGPIO<FakeBackend> button(BUTTON_GPIO, GPIO::DIRECTION::INPUT, GPIO::EDGE::RISING);
+	button.inputWaitTimeMS = 200; //pollEdge returns once the edges stop
+
+	vector<uint64_t> latencies;
+	latencies.reserve(EDGES);
+	edgeLatencies = &latencies;
+
+	thread poller([&]()
+	{
+		button.triggerOnEdge(&recordEdge);
+	});
+
+	usleep(50000); //Let the poller reach epoll_wait
+
+	const uint64_t START = monotonicTimeNs();
+
+	for(unsigned long edge = 0; edge < EDGES; ++edge)
+	{
+		edgeHandled.store(false, memory_order_relaxed);
+		FakeBackend::setInput(BUTTON_GPIO, GPIO::VALUE::LOW);
+
+		edgeRaisedNs.store(monotonicTimeNs(), memory_order_release);
+		FakeBackend::setInput(BUTTON_GPIO, GPIO::VALUE::HIGH);
+
+		while(!edgeHandled.load(memory_order_acquire))
+		{
+			this_thread::yield();
+		}
+	}
+
+	const uint64_t ELAPSED = monotonicTimeNs() - START;
+
+	poller.join();
+	edgeLatencies = nullptr;
+
+	addResult("pollEdge_edge_to_callback", latencies, (double)EDGES * 1e9 / (double)ELAPSED, 0);
+}
+
+/* ************************************************************************
+ * Edge-to-handler latency of a non-blocking subscription, with and without a worker pool
+ * ************************************************************************/
+static void measureSubscriptionLatency(const string &name, const unsigned long EDGES, EdgeWorkerPool *pool)
+{
+	BasicGPIO<FakeBackend> button(BUTTON_GPIO, GPIO::DIRECTION::INPUT, GPIO::EDGE::RISING);
+
+	vector<uint64_t> latencies;
+	latencies.reserve(EDGES);
+
+	EdgeSubscription subscription = button.triggerOnEdge([&latencies](unsigned int, GPIO::VALUE, uint64_t)
+	{
+		latencies.push_back(monotonicTimeNs() - edgeRaisedNs.load(memory_order_acquire));
+		edgeHandled.store(true, memory_order_release);
+	}, pool);
+
+	usleep(50000); //Let the watching thread reach epoll_wait
+
+	const uint64_t START = monotonicTimeNs();
+
+	for(unsigned long edge = 0; edge < EDGES; ++edge)
+	{
+		edgeHandled.store(false, memory_order_relaxed);
+		FakeBackend::setInput(BUTTON_GPIO, GPIO::VALUE::LOW);
+
+		edgeRaisedNs.store(monotonicTimeNs(), memory_order_release);
+		FakeBackend::setInput(BUTTON_GPIO, GPIO::VALUE::HIGH);
+
+		while(!edgeHandled.load(memory_order_acquire))
+		{
+			this_thread::yield();
+		}
+	}
+
+	const uint64_t ELAPSED = monotonicTimeNs() - START;
+
+	subscription.cancel();
+
+	addResult(name, latencies, (double)EDGES * 1e9 / (double)ELAPSED, 0);
+}
+
+/*
+ * Starting a subscription and cancelling it: cancel() returns as soon as the watching
+ * thread has seen its eventfd, rather than after inputWaitTimeMS.
+ */
+static void measureSubscriptionCancel(const unsigned long ITERATIONS)
+{
+	BasicGPIO<FakeBackend> button(BUTTON_GPIO, GPIO::DIRECTION::INPUT, GPIO::EDGE::RISING);
+
+	measure("subscription_start_cancel", ITERATIONS, [&](unsigned long)
+	{
+		EdgeSubscription subscription = button.triggerOnEdge([](unsigned int, GPIO::VALUE, uint64_t) {});
+		subscription.cancel();
+	});
+}
+
+/* ************************************************************************
+ * Edge-to-resume latency of a coroutine awaiting pin.edge() on an EdgeReactor
+ * ************************************************************************/
+static EdgeTask awaitEdges(BasicGPIO<FakeBackend> &button, const unsigned long EDGES, vector<uint64_t> &latencies,
+						   uint64_t &allocations)
+{
+	for(unsigned long edge = 0; edge < EDGES; ++edge)
+	{
+		if(edge == 1)
+		{
+			allocations = allocationCount.load(); //The first wait adds the pin to the reactor
+		}
+
+		if(!co_await button.edge(GPIO::EDGE::RISING, 1000000000ULL))
+		{
+			break;
+		}
+
+		latencies.push_back(monotonicTimeNs() - edgeRaisedNs.load(memory_order_acquire));
+		edgeHandled.store(true, memory_order_release);
+	}
+
+	allocations = allocationCount.load() - allocations;
+}
+
+static void measureReactorLatency(const unsigned long EDGES)
+{
+	BasicGPIO<FakeBackend> button(BUTTON_GPIO, GPIO::DIRECTION::INPUT, GPIO::EDGE::RISING);
+
+	vector<uint64_t> latencies;
+	latencies.reserve(EDGES);
+	uint64_t allocations = 0;
+
+	EdgeReactor reactor;
+	reactor.spawn(awaitEdges(button, EDGES, latencies, allocations));
+
+	thread loop([&]()
+	{
+		reactor.run();
+	});
+
+	usleep(50000); //Let the task reach its first co_await
+
+	const uint64_t START = monotonicTimeNs();
+
+	for(unsigned long edge = 0; edge < EDGES; ++edge)
+	{
+		edgeHandled.store(false, memory_order_relaxed);
+		FakeBackend::setInput(BUTTON_GPIO, GPIO::VALUE::LOW);
+
+		edgeRaisedNs.store(monotonicTimeNs(), memory_order_release);
+		FakeBackend::setInput(BUTTON_GPIO, GPIO::VALUE::HIGH);
+
+		while(!edgeHandled.load(memory_order_acquire))
+		{
+			this_thread::yield();
+		}
+	}
+
+	const uint64_t ELAPSED = monotonicTimeNs() - START;
+
+	loop.join();
+
+	addResult("coroutine_edge_to_resume", latencies, (double)EDGES * 1e9 / (double)ELAPSED,
+			  (double)allocations / (double)(EDGES > 1 ? EDGES - 1 : 1));
+}
+
+/* ************************************************************************
+ * DATAIN sampling rate and jitter of SampleCapture
+ * ************************************************************************/
+static void measureCapture(MemMap &memmap, const uint64_t SAMPLE_RATE_HZ, const uint64_t DURATION_NS)
+{
+	SampleCapture capture(memmap, {LED_GPIO, BUTTON_GPIO}, 65536);
+
+	//A second mapping of the stand-in toggles the sampled inputs, as the outside world would
+	MemMap inputs(FAKE_DEV_MEM);
+	atomic<bool> toggling(true);
+
+	thread toggler([&]()
+	{
+		for(uint32_t count = 0; toggling.load(memory_order_relaxed); ++count)
+		{
+			inputs.write(MemMap::BANK::GPIO1, GPIO_DATAIN_OFFSET, (count & 1) ? (1 << 17) : 0);
+			usleep(100);
+		}
+	});
+
+	capture.run(SAMPLE_RATE_HZ, DURATION_NS);
+
+	toggling.store(false, memory_order_relaxed);
+	toggler.join();
+
+	const SampleCapture::Statistics &STATISTICS = capture.getStatistics();
+	const string NAME = "capture_" + to_string(SAMPLE_RATE_HZ) + "Hz";
+
+	addRecord("captures", JsonRecord(NAME)
+		.add("target_rate_hz", (uint64_t)STATISTICS.targetRateHz)
+		.add("achieved_rate_hz", (uint64_t)STATISTICS.achievedRateHz)
+		.add("samples", STATISTICS.sampleCount)
+		.add("missed_samples", STATISTICS.missedSampleCount)
+		.add("transitions", STATISTICS.transitionCount)
+		.open("jitter_ns").add("mean", STATISTICS.meanJitterNs).add("max", STATISTICS.maxJitterNs).close());
+
+	cerr << NAME << ": " << (uint64_t)STATISTICS.achievedRateHz << " samples/sec, jitter mean "
+		 << STATISTICS.meanJitterNs << " ns, max " << STATISTICS.maxJitterNs << " ns, "
+		 << STATISTICS.missedSampleCount << " missed, " << STATISTICS.transitionCount << " transitions" << endl;
+}
+
+/* ************************************************************************
+ * Per-step timing error of WaveformPlayer
+ * ************************************************************************/
+/*
+ * Description:
+ * 	The WS2812 bit stream of LEDS pixels on LED_GPIO: a 0 bit is 400 ns high then
+ * 	850 ns low, a 1 bit 800 ns high then 450 ns low.
+ */
+static vector<WaveformStep> buildWs2812Waveform(const size_t LEDS)
+{
+	const PinDescriptor &PIN = getPinDescriptor(LED_GPIO);
+	vector<WaveformStep> steps;
+	uint32_t lowNs = 0;
+
+	for(size_t bit = 0; bit < LEDS * 24; ++bit)
+	{
+		const bool ONE = ((bit * 2654435761U) >> 7) & 1; //Arbitrary pixel data
+		const uint32_t HIGH_NS = ONE ? 800 : 400;
+
+		steps.push_back({lowNs, PIN.bank, PIN.mask, 0});
+		steps.push_back({HIGH_NS, PIN.bank, 0, PIN.mask});
+
+		lowNs = 1250 - HIGH_NS;
+	}
+
+	return steps;
+}
+
+static void addWaveformResult(const string &name, const WaveformPlayer &player)
+{
+	vector<int32_t> errors = player.getStepErrors();
+	sort(errors.begin(), errors.end());
+
+	auto errorPercentile = [&](const double FRACTION) -> int32_t
+	{
+		return errors.empty() ? 0 : errors[(size_t)(FRACTION * (double)(errors.size() - 1) + 0.5)];
+	};
+
+	const WaveformPlayer::Statistics &STATISTICS = player.getStatistics();
+
+	addRecord("waveforms", JsonRecord(name)
+		.add("steps", STATISTICS.stepCount)
+		.add("buffers", STATISTICS.bufferCount)
+		.add("underruns", STATISTICS.underrunCount)
+		.add("lead_ns", player.getLeadNs())
+		.open("error_ns").add("mean", STATISTICS.meanErrorNs).add("min", STATISTICS.minErrorNs)
+			.add("p50", errorPercentile(0.50)).add("p99", errorPercentile(0.99)).add("p999", errorPercentile(0.999))
+			.add("max", STATISTICS.maxErrorNs).close());
+
+	cerr << name << ": " << STATISTICS.stepCount << " steps, lead " << player.getLeadNs()
+		 << " ns, error mean " << STATISTICS.meanErrorNs << " ns, p50 " << errorPercentile(0.50)
+		 << " ns, p99 " << errorPercentile(0.99) << " ns, max " << STATISTICS.maxErrorNs << " ns, "
+		 << STATISTICS.underrunCount << " underruns" << endl;
+}
+
+static void measureWaveform(MemMap &memmap)
+{
+	const vector<WaveformStep> STEPS = buildWs2812Waveform(300);
+	const size_t BUFFER_STEPS = 1024;
+
+	{
+		WaveformPlayer player(memmap, BUFFER_STEPS, STEPS.size());
+		player.play(STEPS.data(), STEPS.size());
+		addWaveformResult("waveform_ws2812_play", player);
+	}
+
+	{
+		WaveformPlayer player(memmap, BUFFER_STEPS, STEPS.size());
+
+		thread producer([&]()
+		{
+			for(size_t first = 0; first < STEPS.size(); first += BUFFER_STEPS)
+			{
+				player.submit(&STEPS[first], min(BUFFER_STEPS, STEPS.size() - first));
+			}
+
+			player.finish();
+		});
+
+		player.run();
+		producer.join();
+
+		addWaveformResult("waveform_ws2812_stream", player);
+	}
+}
+
+/* ************************************************************************
+ * SoftSpi throughput, MOSI looped back to MISO
+ * ************************************************************************/
+
+/*
+ * Register model of the GPIO banks with the SET/CLEARDATAOUT semantics of the
+ * hardware, where DATAIN follows DATAOUT and one pin is wired to another.
+ */
+class LoopbackRegisters
+{
+public:
+	LoopbackRegisters(const unsigned int FROM_GPIO, const unsigned int TO_GPIO) :
+		from(getPinDescriptor(FROM_GPIO)), to(getPinDescriptor(TO_GPIO))
+	{
+		for(unsigned int bank = 0; bank < GPIO_BANKS; ++bank)
+		{
+			fill(registers[bank], registers[bank] + REGISTERS_PER_BANK, 0);
+		}
+	}
+
+	inline void write(const MemMap::BANK GPIO_BANK, const unsigned int OFFSET, const uint32_t VALUE)
+	{
+		uint32_t *bank = registers[(unsigned int)GPIO_BANK];
+
+		switch(OFFSET)
+		{
+			case GPIO_SETDATAOUT_OFFSET:   bank[GPIO_DATAOUT_OFFSET / 4] |= VALUE; break;
+			case GPIO_CLEARDATAOUT_OFFSET: bank[GPIO_DATAOUT_OFFSET / 4] &= ~VALUE; break;
+			default:                       bank[OFFSET / 4] = VALUE; break;
+		}
+
+		bank[GPIO_DATAIN_OFFSET / 4] = bank[GPIO_DATAOUT_OFFSET / 4];
+
+		uint32_t &input = registers[(unsigned int)to.bank][GPIO_DATAIN_OFFSET / 4];
+		input = (registers[(unsigned int)from.bank][GPIO_DATAOUT_OFFSET / 4] & from.mask) ? (input | to.mask) : (input & ~to.mask);
+	}
+
+	inline uint32_t read(const MemMap::BANK GPIO_BANK, const unsigned int OFFSET) const
+	{
+		return registers[(unsigned int)GPIO_BANK][OFFSET / 4];
+	}
+
+private:
+	static const unsigned int REGISTERS_PER_BANK = GPIO_MAP_SIZE / sizeof(uint32_t);
+
+	PinDescriptor from;
+	PinDescriptor to;
+	uint32_t registers[GPIO_BANKS][REGISTERS_PER_BANK];
+};
+
+static void measureSpi(const uint32_t CLOCK_HZ, const uint64_t BYTES)
+{
+	//SPI0 pins: SCLK P9.22, D0 (MISO) P9.21, D1 (MOSI) P9.18, CS0 P9.17
+	const unsigned int SCK = "p9.22"_pin, MISO = "p9.21"_pin, MOSI = "p9.18"_pin, CS = "p9.17"_pin;
+	const size_t BLOCK = 256;
+
+	unique_ptr<LoopbackRegisters> registers(new LoopbackRegisters(MOSI, MISO));
+	SoftSpi<LoopbackRegisters> spi(*registers, SCK, MOSI, MISO, CS, SoftSpi<LoopbackRegisters>::MODE::MODE0, CLOCK_HZ);
+
+	uint8_t tx[BLOCK];
+	uint8_t rx[BLOCK];
+
+	for(size_t index = 0; index < BLOCK; ++index)
+	{
+		tx[index] = (uint8_t)(index * 37 + 11);
+	}
+
+	for(unsigned int mode = 0; mode < 4; ++mode)
+	{
+		spi.setMode((SoftSpi<LoopbackRegisters>::MODE)mode);
+
+		uint64_t mismatches = 0;
+		const uint64_t BLOCKS = (BYTES + BLOCK - 1) / BLOCK;
+		const uint64_t ALLOCATIONS_BEFORE = allocationCount.load();
+		const uint64_t START = monotonicTimeNs();
+
+		for(uint64_t block = 0; block < BLOCKS; ++block)
+		{
+			spi.transfer(tx, rx, BLOCK);
+
+			for(size_t index = 0; index < BLOCK; ++index)
+			{
+				mismatches += (rx[index] != tx[index]) ? 1 : 0;
+			}
+		}
+
+		const uint64_t ELAPSED = monotonicTimeNs() - START;
+		const uint64_t ALLOCATIONS = allocationCount.load() - ALLOCATIONS_BEFORE;
+
+		const string NAME = "spi_mode" + to_string(mode) + "_" + (CLOCK_HZ == 0 ? string("unclocked") : to_string(CLOCK_HZ) + "Hz");
+		const uint64_t BYTES_PER_SECOND = (uint64_t)((double)(BLOCKS * BLOCK) * 1e9 / (double)ELAPSED);
+
+		//mismatches: received bytes that differ from the ones sent
+		addRecord("transfers", JsonRecord(NAME)
+			.add("bytes", BLOCKS * BLOCK)
+			.add("bytes_per_sec", BYTES_PER_SECOND)
+			.add("mismatches", mismatches)
+			.add("allocs_per_transfer", (double)ALLOCATIONS / (double)BLOCKS));
+
+		cerr << NAME << ": " << BYTES_PER_SECOND << " bytes/sec, " << mismatches << " mismatched bytes" << endl;
+	}
+}
+
+/* ************************************************************************
+ * Many threads driving and configuring pins of the same bank
+ * ************************************************************************/
+struct ConcurrencyResult
+{
+	string name;
+	unsigned int threads;
+	uint64_t operations;
+	double opsPerSecond;
+	uint64_t lostUpdates; //Bits of a thread's own pins found not as it last set them
+};
+
+/*
+ * Runs OPERATION(thread, i) for ITERATIONS on each of THREADS threads started together,
+ * each on its own CPU when there are enough. OPERATION returns the number of lost
+ * updates it saw, FINAL_CHECK the number left in the registers once every thread is done.
+ * Every OPERATION yields before reading its pin back, so the other threads run in
+ * between and a bit they overwrite shows up even on a single CPU.
+ */
+template<typename OPERATION, typename FINAL_CHECK>
+static ConcurrencyResult measureConcurrent(const string &name, const unsigned int THREADS, const unsigned long ITERATIONS,
+							  OPERATION operation, FINAL_CHECK finalCheck)
+{
+	atomic<bool> go(false);
+	atomic<uint64_t> lostUpdates(0);
+	vector<thread> workers;
+
+	const unsigned int CPUS = thread::hardware_concurrency();
+
+	for(unsigned int index = 0; index < THREADS; ++index)
+	{
+		workers.emplace_back([&, index]()
+		{
+			ScopedCpuAffinity affinity((CPUS > 1) ? (int)(index % CPUS) : -1);
+			uint64_t lost = 0;
+
+			while(!go.load())
+			{
+				this_thread::yield();
+			}
+
+			for(unsigned long i = 0; i < ITERATIONS; ++i)
+			{
+				lost += operation(index, i);
+			}
+
+			lostUpdates += lost;
+		});
+	}
+
+	const uint64_t START = monotonicTimeNs();
+	go = true;
+
+	for(thread &worker : workers)
+	{
+		worker.join();
+	}
+
+	const uint64_t ELAPSED = monotonicTimeNs() - START;
+
+	ConcurrencyResult result = {name, THREADS, THREADS * (uint64_t)ITERATIONS,
+								(double)(THREADS * ITERATIONS) * 1e9 / (double)ELAPSED, lostUpdates + finalCheck()};
+
+	cerr << name << ": " << THREADS << " threads, " << (uint64_t)result.opsPerSecond << " ops/sec, "
+		 << result.lostUpdates << " lost updates" << endl;
+
+	return result;
+}
+
+static void measureConcurrentOutput(MemMap &memmap, const unsigned int THREADS, const unsigned long ITERATIONS)
+{
+	//Each thread owns one pin of GPIO1, from GPIO1_12 up
+	const unsigned int FIRST_BIT = 12;
+	const uint32_t ALL_PINS = ((1U << THREADS) - 1) << FIRST_BIT;
+	const uint32_t FINAL_PINS = (ITERATIONS & 1) ? 0 : ALL_PINS; //Bits left set by the last (odd) iteration
+	vector<ConcurrencyResult> runs;
+
+	{
+		vector<unique_ptr<BasicGPIO<FakeBackend>>> pins;
+
+		for(unsigned int index = 0; index < THREADS; ++index)
+		{
+			pins.emplace_back(new BasicGPIO<FakeBackend>(32 + FIRST_BIT + index, GPIO::DIRECTION::OUTPUT));
+		}
+
+		//setValue() and setDirection() from every thread at once. This only checks the fake backend's own atomic register model
+		runs.push_back(measureConcurrent("concurrent_fake_setValue_setDirection", THREADS, ITERATIONS, [&](unsigned int index, unsigned long i)
+		{
+			const uint32_t MASK = 1U << (FIRST_BIT + index);
+			const bool ODD = (i & 1) != 0;
+
+			pins[index]->setValue(ODD ? GPIO::VALUE::HIGH : GPIO::VALUE::LOW);
+			pins[index]->setDirection(ODD ? GPIO::DIRECTION::INPUT : GPIO::DIRECTION::OUTPUT);
+
+			this_thread::yield();
+
+			uint64_t lost = ((FakeBackend::readRegister(MemMap::BANK::GPIO1, GPIO_DATAOUT_OFFSET) & MASK) != 0) != ODD;
+			lost += ((FakeBackend::readRegister(MemMap::BANK::GPIO1, GPIO_OE_OFFSET) & MASK) != 0) != ODD;
+			return lost;
+		},
+		[&]()
+		{
+			const uint32_t OUTPUT_ENABLE = FakeBackend::readRegister(MemMap::BANK::GPIO1, GPIO_OE_OFFSET) & ALL_PINS;
+			const uint32_t DATA_OUT = FakeBackend::readRegister(MemMap::BANK::GPIO1, GPIO_DATAOUT_OFFSET) & ALL_PINS;
+			return (uint64_t)(__builtin_popcount(OUTPUT_ENABLE ^ FINAL_PINS) + __builtin_popcount(DATA_OUT ^ FINAL_PINS));
+		}));
+	}
+
+	//Direction and debouncer of every thread's pin through MemMap transactions: compare-and-swap on the shadow
+	auto transactionCheck = [&]()
+	{
+		const uint32_t OUTPUT_ENABLE = memmap.read(MemMap::BANK::GPIO1, GPIO_OE_OFFSET) & ALL_PINS;
+		const uint32_t DEBOUNCE = memmap.read(MemMap::BANK::GPIO1, GPIO_DEBOUNCENABLE_OFFSET) & ALL_PINS;
+		return (uint64_t)(__builtin_popcount(OUTPUT_ENABLE ^ FINAL_PINS) + __builtin_popcount(DEBOUNCE ^ FINAL_PINS));
+	};
+
+	runs.push_back(measureConcurrent("concurrent_memmap_transaction", THREADS, ITERATIONS, [&](unsigned int index, unsigned long i)
+	{
+		const uint32_t MASK = 1U << (FIRST_BIT + index);
+		const bool ODD = (i & 1) != 0;
+		MemMap::Transaction transaction(memmap);
+
+		if(ODD)
+		{
+			transaction.setInput(MemMap::BANK::GPIO1, MASK).setBits(MemMap::BANK::GPIO1, GPIO_DEBOUNCENABLE_OFFSET, MASK);
+		}
+		else
+		{
+			transaction.setOutput(MemMap::BANK::GPIO1, MASK).clearBits(MemMap::BANK::GPIO1, GPIO_DEBOUNCENABLE_OFFSET, MASK);
+		}
+
+		transaction.commit();
+
+		this_thread::yield();
+
+		uint64_t lost = ((memmap.getShadow(MemMap::BANK::GPIO1, GPIO_OE_OFFSET) & MASK) != 0) != ODD;
+		lost += ((memmap.getShadow(MemMap::BANK::GPIO1, GPIO_DEBOUNCENABLE_OFFSET) & MASK) != 0) != ODD;
+		return lost;
+	}, transactionCheck));
+
+	//The production path: RegisterBackend pins on the same MemMap, setDirection() and setDebounce() from every thread
+	{
+		vector<unique_ptr<BasicGPIO<RegisterBackend>>> pins;
+
+		for(unsigned int index = 0; index < THREADS; ++index)
+		{
+			pins.emplace_back(new BasicGPIO<RegisterBackend>(32 + FIRST_BIT + index, GPIO::DIRECTION::OUTPUT));
+		}
+
+		runs.push_back(measureConcurrent("concurrent_register_setDirection_setDebounce", THREADS, ITERATIONS, [&](unsigned int index, unsigned long i)
+		{
+			const uint32_t MASK = 1U << (FIRST_BIT + index);
+			const bool ODD = (i & 1) != 0;
+
+			pins[index]->setDirection(ODD ? GPIO::DIRECTION::INPUT : GPIO::DIRECTION::OUTPUT);
+			pins[index]->setDebounce(ODD ? 31000 : 0);
+
+			this_thread::yield();
+
+			uint64_t lost = ((memmap.getShadow(MemMap::BANK::GPIO1, GPIO_OE_OFFSET) & MASK) != 0) != ODD;
+			lost += ((memmap.getShadow(MemMap::BANK::GPIO1, GPIO_DEBOUNCENABLE_OFFSET) & MASK) != 0) != ODD;
+			return lost;
+		}, transactionCheck));
+	}
+
+	/*
+	 * The same with a plain read-modify-write on the device, as the control: updates are lost between the
+	 * read and the write. The thread yields there, so the race shows up even on a single CPU. If the control
+	 * loses nothing, the runs above cannot show that the compare-and-swap is needed.
+	 */
+	runs.push_back(measureConcurrent("concurrent_memmap_rmw", THREADS, ITERATIONS, [&](unsigned int index, unsigned long i)
+	{
+		const uint32_t MASK = 1U << (FIRST_BIT + index);
+		const bool ODD = (i & 1) != 0;
+		const uint32_t OUTPUT_ENABLE = memmap.read(MemMap::BANK::GPIO1, GPIO_OE_OFFSET);
+		const uint32_t DEBOUNCE = memmap.read(MemMap::BANK::GPIO1, GPIO_DEBOUNCENABLE_OFFSET);
+
+		this_thread::yield();
+
+		memmap.write(MemMap::BANK::GPIO1, GPIO_OE_OFFSET, ODD ? (OUTPUT_ENABLE | MASK) : (OUTPUT_ENABLE & ~MASK));
+		memmap.write(MemMap::BANK::GPIO1, GPIO_DEBOUNCENABLE_OFFSET, ODD ? (DEBOUNCE | MASK) : (DEBOUNCE & ~MASK));
+
+		this_thread::yield();
+
+		uint64_t lost = ((memmap.read(MemMap::BANK::GPIO1, GPIO_OE_OFFSET) & MASK) != 0) != ODD;
+		lost += ((memmap.read(MemMap::BANK::GPIO1, GPIO_DEBOUNCENABLE_OFFSET) & MASK) != 0) != ODD;
+		return lost;
+	}, transactionCheck));
+
+	//If the plain read-modify-write control lost nothing either, 0 lost updates proves nothing
+	const bool INCONCLUSIVE = (runs.back().lostUpdates == 0);
+
+	if(INCONCLUSIVE)
+	{
+		cerr << "concurrent_memmap_rmw lost no updates: the concurrency runs are inconclusive" << endl;
+	}
+
+	for(const ConcurrencyResult &RESULT : runs)
+	{
+		addRecord("concurrency", JsonRecord(RESULT.name)
+			.add("threads", RESULT.threads)
+			.add("operations", RESULT.operations)
+			.add("ops_per_sec", (uint64_t)RESULT.opsPerSecond)
+			.add("lost_updates", RESULT.lostUpdates)
+			.add("inconclusive", INCONCLUSIVE));
+	}
+
+	memmap.refreshShadow();
+}
+
+/* ************************************************************************
+ * Edge counting from the latched IRQ status bits
+ * ************************************************************************/
+
+/* The FakeBackend register file seen through the read()/write() of MemMap, so FakeBackend::setInput() edges latch */
+class FakeRegisters
+{
+public:
+	inline void write(const MemMap::BANK GPIO_BANK, const unsigned int OFFSET, const uint32_t VALUE)
+	{
+		FakeBackend::writeRegister(GPIO_BANK, OFFSET, VALUE);
+	}
+
+	inline uint32_t read(const MemMap::BANK GPIO_BANK, const unsigned int OFFSET) const
+	{
+		return FakeBackend::readRegister(GPIO_BANK, OFFSET);
+	}
+};
+
+struct CounterResult
+{
+	string name;
+	unsigned int pins;
+	uint64_t edges;          //Edges raised on every pin
+	uint64_t counted;        //Edges counted, over every pin
+	uint64_t harvests;
+	uint64_t missedHarvests;
+	double frequencyHz;      //Measured on the first pin over the last window
+	double expectedHz;       //0 for runs that do not measure a frequency
+};
+
+static void addCounterResult(const CounterResult &RESULT)
+{
+	JsonRecord record(RESULT.name);
+	record.add("pins", RESULT.pins).add("edges_per_pin", RESULT.edges).add("counted", RESULT.counted)
+		  .add("harvests", RESULT.harvests).add("missed_harvests", RESULT.missedHarvests);
+
+	if(RESULT.expectedHz != 0)
+	{
+		record.add("frequency_hz", RESULT.frequencyHz).add("expected_hz", RESULT.expectedHz);
+	}
+
+	addRecord("edge_counters", record);
+
+	cerr << RESULT.name << ": " << RESULT.counted << " of " << RESULT.edges * RESULT.pins << " edges counted";
+
+	if(RESULT.expectedHz != 0)
+	{
+		cerr << ", " << RESULT.frequencyHz << " Hz (expected " << RESULT.expectedHz << " Hz)";
+	}
+
+	cerr << endl;
+}
+
+static void measureEdgeCounter(const unsigned long ITERATIONS)
+{
+	FakeRegisters registers;
+
+	//GPIO1_20 to GPIO1_27, all harvested with a single read of the bank
+	vector<unsigned int> pins;
+	for(unsigned int bit = 20; bit < 28; ++bit)
+	{
+		pins.push_back(32 + bit);
+	}
+
+	{
+		EdgeCounter<FakeRegisters> counter(registers, pins, GpioBase::EDGE::RISING);
+		vector<uint64_t> samples(ITERATIONS);
+		uint64_t total = 0;
+
+		//One rising edge on every pin between two harvests, only the harvest is timed
+		for(unsigned long i = 0; i < ITERATIONS; ++i)
+		{
+			for(unsigned int pin : pins)
+			{
+				FakeBackend::setInput(pin, GPIO::VALUE::HIGH);
+				FakeBackend::setInput(pin, GPIO::VALUE::LOW);
+			}
+
+			const uint64_t START = monotonicTimeNs();
+			counter.harvest();
+			const uint64_t ELAPSED = monotonicTimeNs() - START;
+
+			samples[i] = ELAPSED - min(ELAPSED, clockReadNs);
+			total += samples[i];
+		}
+
+		addResult("edge_counter_harvest_8_pins", samples, (double)ITERATIONS * 1e9 / (double)(total == 0 ? 1 : total), 0);
+
+		uint64_t counted = 0;
+		for(unsigned int pin : pins)
+		{
+			counted += counter.getCount(pin);
+		}
+
+		addCounterResult({"edge_counter_harvest_8_pins", (unsigned int)pins.size(), ITERATIONS, counted,
+						  counter.getHarvestCount(), 0, 0, 0});
+	}
+
+	{
+		//A 1 kHz square wave on one pin for 500 ms, harvested every 100 us by the counter's thread
+		const uint64_t PERIOD_NS = 1000000;
+		const uint64_t EDGES = 500;
+
+		EdgeCounter<FakeRegisters> counter(registers, {pins[0]}, GpioBase::EDGE::RISING, 100000000);
+		counter.start(100000);
+
+		uint64_t deadline = monotonicTimeNs();
+		for(uint64_t edge = 0; edge < EDGES; ++edge)
+		{
+			FakeBackend::setInput(pins[0], GPIO::VALUE::HIGH);
+			deadline += PERIOD_NS / 2;
+			sleepUntilNs(deadline);
+
+			FakeBackend::setInput(pins[0], GPIO::VALUE::LOW);
+			deadline += PERIOD_NS / 2;
+			sleepUntilNs(deadline);
+		}
+
+		counter.stop();
+
+		addCounterResult({"edge_counter_thread_1kHz", 1, EDGES, counter.getCount(pins[0]), counter.getHarvestCount(),
+						  counter.getMissedHarvestCount(), counter.getFrequencyHz(pins[0]), 1e9 / (double)PERIOD_NS});
+	}
+}
+
+/* ************************************************************************
+ * High time, low time and period of a pulse train through PulseCapture
+ * ************************************************************************/
+static void addSummary(JsonRecord &record, const char *KEY, const PulseCapture::Summary &SUMMARY)
+{
+	record.open(KEY).add("samples", SUMMARY.samples).add("min", SUMMARY.min).add("mean", SUMMARY.mean)
+		  .add("p50", SUMMARY.p50).add("p90", SUMMARY.p90).add("p99", SUMMARY.p99).add("max", SUMMARY.max).close();
+}
+
+static void measurePulseCapture(const uint64_t HIGH_NS, const uint64_t LOW_NS, const unsigned int PULSES)
+{
+	BasicGPIO<FakeBackend> echo(117, GPIO::DIRECTION::INPUT, GPIO::EDGE::BOTH);
+	FakeBackend::setInput(117, GPIO::VALUE::LOW);
+
+	PulseCapture capture(echo, 256);
+	usleep(50000); //Let the watching thread reach epoll_wait
+
+	uint64_t deadline = monotonicTimeNs();
+
+	for(unsigned int pulse = 0; pulse < PULSES; ++pulse)
+	{
+		FakeBackend::setInput(117, GPIO::VALUE::HIGH);
+		deadline += HIGH_NS;
+		sleepUntilNs(deadline);
+
+		FakeBackend::setInput(117, GPIO::VALUE::LOW);
+		deadline += LOW_NS;
+		sleepUntilNs(deadline);
+	}
+
+	measure("pulse_getLatest", 200000, [&](unsigned long)
+	{
+		PulseMeasurement latest;
+		capture.getLatest(latest);
+	});
+
+	capture.stop();
+
+	const string NAME = "pulse_" + to_string(HIGH_NS / 1000) + "us_high_" + to_string(LOW_NS / 1000) + "us_low";
+	const PulseCapture::Statistics STATISTICS = capture.getStatistics();
+
+	JsonRecord record(NAME);
+	record.add("expected_high_ns", HIGH_NS).add("expected_low_ns", LOW_NS)
+		  .add("edges", STATISTICS.edges).add("missed_edges", STATISTICS.missedEdges);
+
+	addSummary(record, "high_ns", STATISTICS.high);
+	addSummary(record, "low_ns", STATISTICS.low);
+	addSummary(record, "period_ns", STATISTICS.period);
+
+	addRecord("pulse_capture", record);
+
+	cerr << NAME << ": high p50 " << STATISTICS.high.p50 << " ns, low p50 " << STATISTICS.low.p50
+		 << " ns, period p50 " << STATISTICS.period.p50 << " ns, " << STATISTICS.missedEdges
+		 << " missed edges of " << STATISTICS.edges << endl;
+}
+
+/* ************************************************************************
+ * Recording a trace of outputs, register writes and edges, and exporting it
+ * ************************************************************************/
+static void measureTraceRecorder(MemMap &memmap, const unsigned long ITERATIONS, const unsigned long EDGES)
+{
+	const string TRACE_FILE = BENCH_ROOT + "/trace.bin";
+	const string VCD_FILE = BENCH_ROOT + "/trace.vcd";
+	const size_t CAPACITY = 1 << 16;
+
+	if(!TraceRecorder::start(TRACE_FILE, CAPACITY))
+	{
+		return;
+	}
+
+	{
+		BasicGPIO<FakeBackend> led(LED_GPIO, GPIO::DIRECTION::OUTPUT);
+
+		measure("fake_setValue_traced", ITERATIONS, [&](unsigned long i)
+		{
+			led.setValue((i & 1) ? GPIO::VALUE::HIGH : GPIO::VALUE::LOW);
+		});
+	}
+
+	measure("memmap_registerWrite_traced", ITERATIONS, [&](unsigned long i)
+	{
+		memmap.registerWrite(GPIO1_MEM_MAP_ADDR, (i & 1) ? GPIO_SETDATAOUT_OFFSET : GPIO_CLEARDATAOUT_OFFSET, (1 << 17));
+	});
+
+	//A button driving an LED: every edge and every write ends up in the trace
+	{
+		BasicGPIO<FakeBackend> led(LED_GPIO, GPIO::DIRECTION::OUTPUT);
+		BasicGPIO<FakeBackend> button(BUTTON_GPIO, GPIO::DIRECTION::INPUT, GPIO::EDGE::BOTH);
+		FakeBackend::setInput(BUTTON_GPIO, GPIO::VALUE::LOW);
+
+		EdgeSubscription subscription = button.triggerOnEdge([&led](unsigned int, GPIO::VALUE level, uint64_t)
+		{
+			led.setValue(level);
+			edgeHandled.store(true, memory_order_release);
+		});
+
+		usleep(50000); //Let the watching thread reach epoll_wait
+
+		for(unsigned long edge = 0; edge < EDGES; ++edge)
+		{
+			edgeHandled.store(false, memory_order_relaxed);
+			FakeBackend::setInput(BUTTON_GPIO, (edge & 1) ? GPIO::VALUE::LOW : GPIO::VALUE::HIGH);
+
+			while(!edgeHandled.load(memory_order_acquire))
+			{
+				this_thread::yield();
+			}
+		}
+
+		subscription.cancel();
+	}
+
+	const uint64_t RECORDS = TraceRecorder::stop(); //Records appended, including the overwritten ones
+	uint64_t exported;                              //Records converted to VCD
+	uint64_t vcdBytes = 0;
+
+	const uint64_t START = monotonicTimeNs();
+	{
+		ofstream vcdFile(VCD_FILE);
+		exported = TraceRecorder::exportVcd(TRACE_FILE, vcdFile);
+	}
+	const uint64_t EXPORT_NS = monotonicTimeNs() - START;
+
+	struct stat vcdStatus;
+	if(stat(VCD_FILE.c_str(), &vcdStatus) == 0)
+	{
+		vcdBytes = vcdStatus.st_size;
+	}
+
+	addRecord("trace_recorder", JsonRecord("trace_file_64k_records")
+		.add("records", RECORDS)
+		.add("capacity", (uint64_t)CAPACITY)
+		.add("exported", exported)
+		.add("export_ns", EXPORT_NS)
+		.add("vcd_bytes", vcdBytes));
+
+	cerr << "trace_file_64k_records: " << RECORDS << " records, " << exported << " exported to VCD in "
+		 << EXPORT_NS / 1000000 << " ms (" << vcdBytes << " bytes)" << endl;
+}
+
+/* ************************************************************************
+ * Edge bursts replayed into both edge paths, from a synthetic and a recorded trace
+ * ************************************************************************/
+static void addReplay(const string &name, const TraceReplay::Report &report)
+{
+	JsonRecord record(name);
+	record.add("edges", report.edges).add("delivered", report.delivered).add("dropped", report.dropped)
+		  .add("skipped", report.skipped).add("injected_per_sec", (uint64_t)report.injectedRateHz)
+		  .add("max_injection_late_ns", report.maxInjectionLateNs).add("cpu_ns_per_edge", report.cpuNsPerEdge);
+	addLatency(record, report);
+	addRecord("trace_replay", record);
+
+	TraceReplay::print(name.c_str(), report);
+}
+
+static void measureTraceReplay(const uint64_t DURATION_NS)
+{
+	//Eight inputs of bank 3, GPIO3_14 - GPIO3_21
+	const vector<unsigned int> PINS = {110, 111, 112, 113, 114, 115, 116, 117};
+
+	for(const double RATE_HZ : {10000.0, 50000.0})
+	{
+		const vector<EdgeEvent> EDGES = TraceReplay::synthesize(PINS, RATE_HZ, DURATION_NS);
+		const string RATE = to_string((unsigned int)(RATE_HZ / 1000)) + "kHz";
+
+		addReplay("replay_poll_edge_" + RATE, TraceReplay::run(EDGES, TraceReplay::PATH::POLL_EDGE));
+		addReplay("replay_event_loop_" + RATE, TraceReplay::run(EDGES, TraceReplay::PATH::EVENT_LOOP));
+	}
+
+	//Record the edges of a replay, then replay the recording twice as fast
+	const string TRACE_FILE = BENCH_ROOT + "/replay.bin";
+
+	if(TraceRecorder::start(TRACE_FILE, 1 << 16))
+	{
+		addReplay("replay_poll_edge_5kHz_recorded", TraceReplay::run(TraceReplay::synthesize(PINS, 5000.0, DURATION_NS, 2), TraceReplay::PATH::POLL_EDGE));
+		TraceRecorder::stop();
+
+		addReplay("replay_poll_edge_recording_2x", TraceReplay::run(TraceReplay::load(TRACE_FILE), TraceReplay::PATH::POLL_EDGE, 2.0));
+	}
+}
+
+/* ************************************************************************
+ * Thousands of scheduled output changes through OutputScheduler
+ * ************************************************************************/
+/*
+ * Wait until every change of the scheduler fired, at most until TIMEOUT_NS.
+ */
+static void waitForScheduler(const OutputScheduler &scheduler, const uint64_t TIMEOUT_NS)
+{
+	while(scheduler.getPendingCount() != 0 && monotonicTimeNs() < TIMEOUT_NS)
+	{
+		usleep(10000);
+	}
+}
+
+/*
+ * Description:
+ * 	Add a run of the "output_scheduler" section. SCHEDULE_NS is the mean cost of
+ * 	schedule() or schedulePeriodic(), with the wheel filling up.
+ */
+static void addSchedulerResult(const string &name, const OutputScheduler &scheduler, const double SCHEDULE_NS)
+{
+	const OutputScheduler::Statistics STATISTICS = scheduler.getStatistics();
+	const HistogramSnapshot LATENESS = scheduler.getLateness();
+
+	addRecord("output_scheduler", JsonRecord(name)
+		.add("tick_ns", scheduler.getTickNs())
+		.add("scheduled", STATISTICS.scheduled)
+		.add("fired", STATISTICS.fired)
+		.add("stores", STATISTICS.stores)
+		.add("changes_per_store", (double)STATISTICS.fired / (double)(STATISTICS.stores == 0 ? 1 : STATISTICS.stores))
+		.add("wakeups", STATISTICS.wakeups)
+		.add("schedule_ns", SCHEDULE_NS)
+		.open("lateness_ns").add("mean", LATENESS.getMean()).add("p50", LATENESS.getPercentile(0.5))
+			.add("p99", LATENESS.getPercentile(0.99)).add("p999", LATENESS.getPercentile(0.999)).add("max", LATENESS.getMax()).close());
+
+	cerr << name << ": " << STATISTICS.fired << " changes in " << STATISTICS.stores << " stores, "
+		 << STATISTICS.wakeups << " wakeups, lateness p50 " << LATENESS.getPercentile(0.5) << " ns, p99 "
+		 << LATENESS.getPercentile(0.99) << " ns, max " << LATENESS.getMax() << " ns" << endl;
+}
+
+static void measureOutputScheduler(MemMap &memmap, const unsigned int CHANGES)
+{
+	//Every GPIO of banks 1 to 3
+	const unsigned int FIRST_PIN = 32;
+	const unsigned int PINS = 96;
+
+	{
+		OutputScheduler scheduler(memmap, 100000, 4096);
+
+		measure("scheduler_schedule_cancel", 100000, [&](unsigned long i)
+		{
+			scheduler.cancel(scheduler.schedule(FIRST_PIN + (unsigned int)(i % PINS), GpioBase::VALUE::HIGH, monotonicTimeNs() + 10000000000ULL));
+		});
+	}
+
+	//One-shot changes at random deadlines over 200 ms, all pending before the first one is due
+	for(const uint64_t TICK_NS : {10000ULL, 100000ULL})
+	{
+		OutputScheduler scheduler(memmap, TICK_NS, CHANGES);
+		scheduler.start();
+
+		mt19937_64 random(1);
+		const uint64_t FIRST_NS = monotonicTimeNs() + 50000000;
+		uniform_int_distribution<uint64_t> deadlines(FIRST_NS, FIRST_NS + 200000000);
+
+		const uint64_t START = monotonicTimeNs();
+
+		for(unsigned int change = 0; change < CHANGES; ++change)
+		{
+			scheduler.schedule(FIRST_PIN + (unsigned int)(random() % PINS), (change & 1) ? GpioBase::VALUE::HIGH : GpioBase::VALUE::LOW, deadlines(random));
+		}
+
+		const double SCHEDULE_NS = (double)(monotonicTimeNs() - START) / (double)CHANGES;
+
+		waitForScheduler(scheduler, FIRST_NS + 1000000000);
+		scheduler.stop();
+
+		addSchedulerResult("scheduler_oneshot_" + to_string(CHANGES) + "_tick_" + to_string(TICK_NS / 1000) + "us", scheduler, SCHEDULE_NS);
+	}
+
+	//A 1 kHz pulse train on every pin, in phase: each edge of the 96 pins is written in one store per bank
+	{
+		OutputScheduler scheduler(memmap, 100000, PINS);
+		scheduler.start();
+
+		const uint64_t FIRST_NS = monotonicTimeNs() + 10000000;
+		const uint64_t START = monotonicTimeNs();
+
+		for(unsigned int pin = 0; pin < PINS; ++pin)
+		{
+			scheduler.schedulePeriodic(FIRST_PIN + pin, FIRST_NS, 1000000, 250000, 200);
+		}
+
+		const double SCHEDULE_NS = (double)(monotonicTimeNs() - START) / (double)PINS;
+
+		waitForScheduler(scheduler, FIRST_NS + 2000000000);
+		scheduler.stop();
+
+		addSchedulerResult("scheduler_periodic_96_pins_1kHz", scheduler, SCHEDULE_NS);
+	}
+}
+
+/* ************************************************************************
+ * Wakeup latency of the edge thread, with and without the real-time profile
+ * ************************************************************************/
+static void measureWakeupLatency(const unsigned int EDGES)
+{
+	const pair<string, LatencySelfTest::Report> WAKEUPS[] =
+	{
+		make_pair("wakeup_default", LatencySelfTest::run(RealTimeProfile(), EDGES)),
+		make_pair("wakeup_realtime", LatencySelfTest::run(RealTimeProfile::lowLatency(), EDGES))
+	};
+
+	for(const pair<string, LatencySelfTest::Report> &WAKEUP : WAKEUPS)
+	{
+		JsonRecord record(WAKEUP.first);
+		record.add("edges", WAKEUP.second.edges).add("received", WAKEUP.second.received)
+			  .add("coalesced", WAKEUP.second.coalesced).add("sched_fifo", WAKEUP.second.realTime);
+		addLatency(record, WAKEUP.second);
+		addRecord("wakeup_latency", record);
+
+		LatencySelfTest::print(WAKEUP.first.c_str(), WAKEUP.second);
+	}
+}
+
+static void printJson(void)
+{
+	cout << "{" << endl;
+
+	for(const pair<string, vector<string>> &SECTION : sections)
+	{
+		cout << "  \"" << SECTION.first << "\": [" << endl;
+
+		for(size_t index = 0; index < SECTION.second.size(); ++index)
+		{
+			cout << "    " << SECTION.second[index] << (index + 1 < SECTION.second.size() ? "," : "") << endl;
+		}
+
+		cout << "  ]," << endl;
+	}
+
+	//Counters and histograms of every edge dispatched by the runs above
+	cout << "  \"edge_statistics\": ";
+	EdgeStatistics::snapshot().toJson(cout);
+	cout << endl << "}" << endl;
+}
+
+int main(int argc, char *argv[])
+{
+	const unsigned long ITERATIONS = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 200000;
+	const unsigned long EDGES = min(ITERATIONS, 5000UL);
+
+	//Anything printed while measuring (warnings, progress) goes to stderr, stdout only gets the JSON
+	streambuf *jsonOutput = cout.rdbuf(cerr.rdbuf());
+
+	createStandIns();
+
+	MemMap memmap(FAKE_DEV_MEM);
+	if(!memmap.isMapped())
+	{
+		return EXIT_FAILURE;
+	}
+	RegisterBackend::useMemMap(memmap);
+
+	//Cost of the clock read measure() amortises over MEASURE_BATCH calls: an empty operation is optimised away, so time a clock read
+	clockReadNs = measure("clock_overhead", ITERATIONS, [](unsigned long)
+	{
+		monotonicTimeNs();
+	});
+
+	{
+		GPIO led(LED_GPIO, GPIO::DIRECTION::OUTPUT);
+
+		measure("sysfs_setValue", ITERATIONS, [&](unsigned long i)
+		{
+			led.setValue((i & 1) ? GPIO::VALUE::HIGH : GPIO::VALUE::LOW);
+		});
+
+		measure("sysfs_getValue", ITERATIONS, [&](unsigned long)
+		{
+			led.getValue();
+		});
+	}
+
+	measure("memmap_registerWrite", ITERATIONS, [&](unsigned long i)
+	{
+		memmap.registerWrite(GPIO1_MEM_MAP_ADDR, (i & 1) ? GPIO_SETDATAOUT_OFFSET : GPIO_CLEARDATAOUT_OFFSET, (1 << 17));
+	});
+
+	measure("memmap_write", ITERATIONS, [&](unsigned long i)
+	{
+		memmap.write(MemMap::BANK::GPIO1, (i & 1) ? GPIO_SETDATAOUT_OFFSET : GPIO_CLEARDATAOUT_OFFSET, (1 << 17));
+	});
+
+	measure("memmap_readInputs", ITERATIONS, [&](unsigned long)
+	{
+		uint32_t dataIn[GPIO_BANKS];
+		memmap.readInputs(dataIn);
+	});
+
+	{
+		MemMap::Snapshot previous = memmap.snapshot();
+
+		measure("memmap_snapshot_diff", ITERATIONS, [&](unsigned long)
+		{
+			const MemMap::Snapshot CURRENT = memmap.snapshot();
+
+			if(!MemMap::diff(previous, CURRENT).isEmpty())
+			{
+				previous = CURRENT;
+			}
+		});
+	}
+
+	//Configure 8 pins of a bank as debounced outputs: one read-modify-write per pin and register, against one transaction
+	measure("memmap_configure_rmw", ITERATIONS, [&](unsigned long i)
+	{
+		for(unsigned int bit = 12; bit < 20; ++bit)
+		{
+			const uint32_t MASK = (i & 1) ? (1U << bit) : 0;
+			memmap.write(MemMap::BANK::GPIO1, GPIO_OE_OFFSET, memmap.read(MemMap::BANK::GPIO1, GPIO_OE_OFFSET) & ~(1U << bit));
+			memmap.write(MemMap::BANK::GPIO1, GPIO_DEBOUNCENABLE_OFFSET,
+						 (memmap.read(MemMap::BANK::GPIO1, GPIO_DEBOUNCENABLE_OFFSET) & ~(1U << bit)) | MASK);
+		}
+	});
+
+	measure("memmap_configure_transaction", ITERATIONS, [&](unsigned long i)
+	{
+		MemMap::Transaction transaction(memmap);
+
+		transaction.setOutput(MemMap::BANK::GPIO1, 0x000FF000);
+		if(i & 1)
+		{
+			transaction.setBits(MemMap::BANK::GPIO1, GPIO_DEBOUNCENABLE_OFFSET, 0x000FF000);
+		}
+		else
+		{
+			transaction.clearBits(MemMap::BANK::GPIO1, GPIO_DEBOUNCENABLE_OFFSET, 0x000FF000);
+		}
+
+		transaction.commit();
+	});
+
+	{
+		BasicGPIO<RegisterBackend> led(LED_GPIO, GPIO::DIRECTION::OUTPUT);
+
+		measure("register_setValue", ITERATIONS, [&](unsigned long i)
+		{
+			led.setValue((i & 1) ? GPIO::VALUE::HIGH : GPIO::VALUE::LOW);
+		});
+	}
+
+	{
+		BasicGPIO<FakeBackend> led(LED_GPIO, GPIO::DIRECTION::OUTPUT);
+
+		measure("fake_setValue", ITERATIONS, [&](unsigned long i)
+		{
+			led.setValue((i & 1) ? GPIO::VALUE::HIGH : GPIO::VALUE::LOW);
+		});
+	}
+
+	measureEdgeLatency(EDGES);
+
+	measureSubscriptionLatency("subscription_edge_to_handler", EDGES, nullptr);
+	{
+		EdgeWorkerPool pool(2);
+		measureSubscriptionLatency("subscription_pool_edge_to_handler", EDGES, &pool);
+	}
+	measureSubscriptionCancel(200);
+	measureReactorLatency(EDGES);
+
+	measureCapture(memmap, 1000000, 200000000);
+	measureCapture(memmap, 10000000, 200000000);
+
+	measureWaveform(memmap);
+
+	measureSpi(0, 1 << 20);
+	measureSpi(1000000, 1 << 14);
+
+	measureConcurrentOutput(memmap, 4, ITERATIONS);
+
+	measureEdgeCounter(ITERATIONS / 10);
+
+	measurePulseCapture(300000, 700000, 300);
+
+	measureTraceRecorder(memmap, ITERATIONS, EDGES / 5);
+
+	measureTraceReplay(500000000);
+
+	measureOutputScheduler(memmap, 4096);
+
+	measureWakeupLatency(EDGES / 5);
+
+	cout.rdbuf(jsonOutput);
+	printJson();
+
+	system(("rm -rf " + BENCH_ROOT).c_str());
+
+	return 0;
+}
@@ -0,0 +1,403 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#include "GpioEventLoop.h"
+#include "Timestamp.h"
+#include "EdgeStatistics.h"
+
+/*
+ * Description:
+ * 	Create the epoll set shared by every pin, and the eventfd used to wake the loop
+ * 	up when pins are added or removed.
+ *
+ * Args:
+ * 	maxEvents The maximum number of ready pins handled per call to epoll_wait()
+ */
+GpioEventLoop::GpioEventLoop(unsigned int maxEvents) : epollFileDescriptor(-1),
+	wakeupFileDescriptor(-1), maxEvents(maxEvents == 0 ? 1 : maxEvents), pinCount(0), stopRequested(false),
+	queuedChanges(0), appliedChanges(0)
+{
+	this->readyEvents.resize(this->maxEvents);
+
+	this->epollFileDescriptor = epoll_create1(EPOLL_CLOEXEC);
+	if(this->epollFileDescriptor == -1)
+	{
+		perror("GpioEventLoop - Failed to create a new epoll instance: epoll_create1()");
+		exit(EXIT_FAILURE);
+	}
+
+	this->wakeupFileDescriptor = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if(this->wakeupFileDescriptor == -1)
+	{
+		perror("GpioEventLoop - Failed to create the wakeup descriptor: eventfd()");
+		exit(EXIT_FAILURE);
+	}
+
+	struct epoll_event wakeupEvent;
+	wakeupEvent.events = EPOLLIN;
+	wakeupEvent.data.u64 = WAKEUP_SLOT;
+
+	if(epoll_ctl(this->epollFileDescriptor, EPOLL_CTL_ADD, this->wakeupFileDescriptor, &wakeupEvent) == -1)
+	{
+		perror("GpioEventLoop - Failed to add the wakeup descriptor: epoll_ctl()");
+		exit(EXIT_FAILURE);
+	}
+}
+
+/*
+ * Description:
+ * 	Queue a pin to be watched by the loop. Can be called from any thread.
+ *
+ * Args:
+ * 	pin The GPIO input to watch. It must outlive its registration.
+ * 	callback The function called every time an edge is detected on the pin
+ *
+ * Return
+ * 	False if the pin has no edge descriptor open
+ */
+bool GpioEventLoop::addPin(GpioBase &pin, edgeCallback callback)
+{
+	return queuePin(pin, callback, nullptr);
+}
+
+/*
+ * Description:
+ * 	Queue a pin to be watched by the loop, recording its edges into a ring rather than
+ * 	calling a callback. Can be called from any thread.
+ *
+ * Args:
+ * 	pin The GPIO input to watch. It must outlive its registration.
+ * 	ring The queue the edges of the pin are pushed into. It must outlive the registration.
+ *
+ * Return
+ * 	False if the pin has no edge descriptor open
+ */
+bool GpioEventLoop::addPin(GpioBase &pin, EdgeEventRing &ring)
+{
+	return queuePin(pin, nullptr, &ring);
+}
+
+bool GpioEventLoop::queuePin(GpioBase &pin, edgeCallback callback, EdgeEventRing *ring)
+{
+	if(pin.getEdgeFileDescriptor() == -1)
+	{
+		cout << "ERROR: GpioEventLoop - GPIO " << pin.getPinNumber() << " has no edge descriptor open" << endl;
+		return false;
+	}
+
+	{
+		lock_guard<mutex> lock(this->pendingMutex);
+		this->pendingChanges.push_back({&pin, callback, ring, true});
+		this->queuedChanges++;
+	}
+
+	wakeup();
+	return true;
+}
+
+/*
+ * Description:
+ * 	Stop watching a pin. Can be called from any thread, including from within a callback.
+ *
+ * 	When it returns, the loop no longer uses the pin, its callback or its ring, so they
+ * 	may be destroyed. Called from another thread while run() is executing, it blocks
+ * 	until the loop thread has applied the removal. Called from a callback, the removal
+ * 	is applied straight away (the callback running it still completes). When no loop
+ * 	is running, the removal is queued and applied before the next run() waits for edges.
+ *
+ * Args:
+ * 	pin The GPIO input previously passed to addPin()
+ */
+void GpioEventLoop::removePin(const GpioBase &pin)
+{
+	unique_lock<mutex> lock(this->pendingMutex);
+
+	//An add still queued for the pin would otherwise be applied after it is gone
+	for(size_t index = this->pendingChanges.size(); index-- > 0;)
+	{
+		if(this->pendingChanges[index].add && this->pendingChanges[index].pin == &pin)
+		{
+			this->pendingChanges.erase(this->pendingChanges.begin() + index);
+		}
+	}
+
+	this->pendingChanges.push_back({const_cast<GpioBase*>(&pin), nullptr, nullptr, false});
+	const uint64_t TICKET = ++this->queuedChanges;
+
+	if(this->loopThread == std::thread::id())
+	{
+		return;
+	}
+
+	if(this->loopThread == this_thread::get_id())
+	{
+		lock.unlock();
+		applyPendingChanges();
+		return;
+	}
+
+	lock.unlock();
+	wakeup();
+	lock.lock();
+
+	this->changesApplied.wait(lock, [this, TICKET]
+	{
+		return this->appliedChanges >= TICKET || this->loopThread == std::thread::id();
+	});
+}
+
+/*
+ * Description:
+ * 	Wait for edges on the registered pins and dispatch them to their callbacks until
+ * 	stop() is called.
+ *
+ * Args:
+ * 	timeoutMS Return if nothing happens for this long (-1 waits indefinitely)
+ */
+void GpioEventLoop::run(int timeoutMS)
+{
+	ScopedRealTimeProfile realTime(this->realTimeProfile);
+
+	{
+		lock_guard<mutex> lock(this->pendingMutex);
+		this->loopThread = this_thread::get_id();
+	}
+
+	applyPendingChanges();
+
+	while(!this->stopRequested)
+	{
+		int epollEventsNum = epoll_wait(this->epollFileDescriptor, this->readyEvents.data(), (int)this->maxEvents, timeoutMS);
+		const uint64_t WAKEUP_TIME_NS = monotonicTimeNs();
+
+		if(epollEventsNum == -1)
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+
+			perror("GpioEventLoop::run - Failed to wait for a file descriptor to be ready: epoll_wait()");
+			break;
+		}
+		else if(epollEventsNum == 0)
+		{
+			//No file descriptor became ready during the requested timeout.
+			for(const Registration &registration : this->registrations)
+			{
+				if(registration.active)
+				{
+					EdgeStatistics::recordTimeout(registration.pin->getPinNumber());
+				}
+			}
+
+			break;
+		}
+
+		for(int index = 0; index < epollEventsNum; ++index)
+		{
+			dispatch(this->readyEvents[index], WAKEUP_TIME_NS);
+		}
+	}
+
+	this->stopRequested = false;
+
+	{
+		lock_guard<mutex> lock(this->pendingMutex);
+		this->loopThread = std::thread::id();
+	}
+
+	//Removals still queued are applied by the next run(), before it touches any pin.
+	this->changesApplied.notify_all();
+}
+
+/*
+ * Description:
+ * 	Make run() return after the current batch of events. Can be called from any thread.
+ * 	If the loop is not running yet, the next run() returns straight away.
+ */
+void GpioEventLoop::stop(void)
+{
+	this->stopRequested = true;
+	wakeup();
+}
+
+void GpioEventLoop::wakeup(void)
+{
+	const uint64_t ONE = 1;
+
+	if(write(this->wakeupFileDescriptor, &ONE, sizeof(ONE)) == -1)
+	{
+		perror("GpioEventLoop - Failed to wake up the loop: write()");
+	}
+}
+
+void GpioEventLoop::dispatch(const struct epoll_event &event, const uint64_t WAKEUP_TIME_NS)
+{
+	const uint32_t SLOT = (uint32_t)event.data.u64;
+	const uint32_t GENERATION = (uint32_t)(event.data.u64 >> 32);
+
+	if(SLOT == WAKEUP_SLOT)
+	{
+		uint64_t wakeups;
+		while(read(this->wakeupFileDescriptor, &wakeups, sizeof(wakeups)) > 0)
+		{
+		}
+
+		applyPendingChanges();
+		return;
+	}
+
+	if(SLOT >= this->registrations.size())
+	{
+		return;
+	}
+
+	Registration &registration = this->registrations[SLOT];
+
+	//The pin may have been removed (and the slot reused) earlier in this batch.
+	if(!registration.active || registration.generation != GENERATION)
+	{
+		return;
+	}
+
+	const unsigned int PIN_NUMBER = registration.pin->getPinNumber();
+
+	EdgeStatistics::recordWakeup(PIN_NUMBER);
+
+	//Ignore the first trigger, epoll_wait always reports a value file as ready once.
+	if(!registration.primed)
+	{
+		registration.primed = true;
+		EdgeStatistics::recordSpuriousWakeup(PIN_NUMBER);
+		return;
+	}
+
+	if(!registration.pin->acceptEdge(WAKEUP_TIME_NS))
+	{
+		EdgeStatistics::recordSpuriousWakeup(PIN_NUMBER);
+		return;
+	}
+
+	const uint64_t DISPATCH_TIME_NS = monotonicTimeNs();
+
+	if(registration.ring != nullptr)
+	{
+		registration.ring->push({WAKEUP_TIME_NS, PIN_NUMBER, registration.pin->getDetectedEdge()});
+	}
+	else
+	{
+		registration.callback();
+	}
+
+	EdgeStatistics::recordEdge(PIN_NUMBER, DISPATCH_TIME_NS - WAKEUP_TIME_NS, monotonicTimeNs() - DISPATCH_TIME_NS);
+}
+
+void GpioEventLoop::applyPendingChanges(void)
+{
+	std::vector<PendingChange> changes;
+	uint64_t queued;
+
+	{
+		lock_guard<mutex> lock(this->pendingMutex);
+		changes.swap(this->pendingChanges);
+		queued = this->queuedChanges;
+	}
+
+	for(const PendingChange &change : changes)
+	{
+		if(change.add)
+		{
+			registerPin(change);
+		}
+		else
+		{
+			unregisterPin(*change.pin);
+		}
+	}
+
+	{
+		lock_guard<mutex> lock(this->pendingMutex);
+		this->appliedChanges = queued;
+	}
+
+	this->changesApplied.notify_all();
+}
+
+void GpioEventLoop::registerPin(const PendingChange &change)
+{
+	GpioBase &pin = *change.pin;
+	uint32_t slot;
+
+	if(this->freeSlots.empty())
+	{
+		slot = (uint32_t)this->registrations.size();
+		this->registrations.push_back({nullptr, nullptr, nullptr, -1, 0, false, false});
+	}
+	else
+	{
+		slot = this->freeSlots.back();
+		this->freeSlots.pop_back();
+	}
+
+	Registration &registration = this->registrations[slot];
+	registration.pin = &pin;
+	registration.callback = change.callback;
+	registration.ring = change.ring;
+	registration.edgeFileDescriptor = pin.getEdgeFileDescriptor();
+	registration.generation++;
+	registration.active = true;
+	registration.primed = false;
+
+	struct epoll_event epollEvent;
+	epollEvent.events = EPOLLIN | EPOLLET | EPOLLPRI; // read operation | edge triggered | urgent data
+	epollEvent.data.u64 = ((uint64_t)registration.generation << 32) | slot;
+
+	if(epoll_ctl(this->epollFileDescriptor, EPOLL_CTL_ADD, registration.edgeFileDescriptor, &epollEvent) == -1)
+	{
+		perror("GpioEventLoop - Failed to add the GPIO edge descriptor: epoll_ctl()");
+		registration.active = false;
+		this->freeSlots.push_back(slot);
+		return;
+	}
+
+	this->pinCount++;
+}
+
+void GpioEventLoop::unregisterPin(const GpioBase &pin)
+{
+	for(uint32_t slot = 0; slot < this->registrations.size(); ++slot)
+	{
+		Registration &registration = this->registrations[slot];
+
+		if(registration.active && registration.pin == &pin)
+		{
+			//The pin itself may already be gone if no loop was running when it was removed.
+			epoll_ctl(this->epollFileDescriptor, EPOLL_CTL_DEL, registration.edgeFileDescriptor, NULL);
+
+			registration.active = false;
+			this->freeSlots.push_back(slot);
+			this->pinCount--;
+			return;
+		}
+	}
+}
+
+/*
+ * Destructor
+ */
+GpioEventLoop::~GpioEventLoop()
+{
+	if(this->wakeupFileDescriptor != -1)
+	{
+		close(this->wakeupFileDescriptor);
+	}
+
+	if(this->epollFileDescriptor != -1)
+	{
+		close(this->epollFileDescriptor);
+	}
+}
@@ -0,0 +1,101 @@
+#ifndef H_GPIO_EVENT_LOOP_H_
+#define H_GPIO_EVENT_LOOP_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+#include <sys/epoll.h>
+
+#include "GpioBase.h"
+#include "EdgeEventRing.h"
+
+/*
+ * Watches the edges of many GPIO inputs from a single thread. The edge descriptor
+ * of every pin (whatever its backend) is registered on one epoll set, and each call to epoll_wait() drains up to
+ * maxEvents ready pins before dispatching them to their handlers.
+ *
+ * Instead of a callback, a pin can be given an EdgeEventRing. Its edges are then
+ * recorded with the time epoll_wait() returned and left for a consumer thread to
+ * drain, keeping slow handlers off the loop thread. Only the loop thread pushes,
+ * so several pins may share one ring.
+ *
+ * Pins can be added or removed from any thread while run() is executing. The
+ * change is queued and the loop is woken up through an eventfd, so the handler
+ * table is only ever touched by the thread running the loop. removePin() only
+ * returns once the loop has let go of the pin, so the pin, its callback and its
+ * ring may be destroyed as soon as it does.
+ */
+class GpioEventLoop
+{
+public:
+	static const unsigned int DEFAULT_MAX_EVENTS = 16;
+
+	GpioEventLoop(unsigned int maxEvents = DEFAULT_MAX_EVENTS);
+	~GpioEventLoop();
+
+	GpioEventLoop(const GpioEventLoop &) = delete;
+	GpioEventLoop &operator=(const GpioEventLoop &) = delete;
+
+	bool addPin(GpioBase &pin, edgeCallback callback);
+	bool addPin(GpioBase &pin, EdgeEventRing &ring);
+	void removePin(const GpioBase &pin);
+
+	void run(int timeoutMS = -1);
+	void stop(void);
+
+	unsigned int getPinCount(void) const { return pinCount; }
+
+	void setRealTimeProfile(const RealTimeProfile &profile) { realTimeProfile = profile; }
+
+private:
+	struct Registration
+	{
+		const GpioBase *pin;
+		edgeCallback callback;
+		EdgeEventRing *ring;  //When set, edges are pushed here instead of calling callback
+		int edgeFileDescriptor;
+		uint32_t generation; //Incremented whenever the slot is reused, so stale events are ignored
+		bool active;
+		bool primed;         //The first (spurious) event reported for a value file is ignored
+	};
+
+	struct PendingChange
+	{
+		GpioBase *pin;
+		edgeCallback callback;
+		EdgeEventRing *ring;
+		bool add;
+	};
+
+	static const uint32_t WAKEUP_SLOT = 0xFFFFFFFF;
+
+	int epollFileDescriptor;
+	int wakeupFileDescriptor;
+	unsigned int maxEvents;
+	std::atomic<unsigned int> pinCount;
+	std::atomic<bool> stopRequested; //Set by stop(), cleared when run() returns
+	RealTimeProfile realTimeProfile; //Applied to the thread calling run() while it runs
+
+	std::vector<struct epoll_event> readyEvents;
+	std::vector<Registration> registrations;
+	std::vector<uint32_t> freeSlots;
+
+	std::mutex pendingMutex;
+	std::condition_variable changesApplied;
+	std::vector<PendingChange> pendingChanges;
+	uint64_t queuedChanges;   //Changes ever queued, guarded by pendingMutex
+	uint64_t appliedChanges;  //How many of them the loop has applied, guarded by pendingMutex
+	std::thread::id loopThread; //The thread inside run(), guarded by pendingMutex
+
+	bool queuePin(GpioBase &pin, edgeCallback callback, EdgeEventRing *ring);
+	void wakeup(void);
+	void applyPendingChanges(void);
+	void registerPin(const PendingChange &change);
+	void unregisterPin(const GpioBase &pin);
+	void dispatch(const struct epoll_event &event, const uint64_t WAKEUP_TIME_NS);
+};
+
+#endif /* H_GPIO_EVENT_LOOP_H_ */
@@ -0,0 +1,135 @@
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include <time.h>
+#include <unistd.h>
+
+#include "LatencySelfTest.h"
+#include "GPIO.h"
+#include "FakeBackend.h"
+#include "EdgeEventRing.h"
+#include "Timestamp.h"
+
+/* An input of the FakeBackend nothing else uses: GPIO3_31 is not on a header */
+static const unsigned int SELF_TEST_GPIO = 127;
+
+static void addNs(struct timespec &time, const uint64_t NS)
+{
+	const uint64_t TOTAL_NS = (uint64_t)time.tv_nsec + NS;
+
+	time.tv_sec += TOTAL_NS / 1000000000ULL;
+	time.tv_nsec = TOTAL_NS % 1000000000ULL;
+}
+
+/*
+ * Description:
+ *	Raise EDGES rising edges INTERVAL_NS apart and measure how long the polling
+ *	thread, running with profile, takes to wake up for each.
+ *
+ * Args:
+ *	profile The RealTimeProfile of the polling thread
+ *	EDGES The number of edges to raise
+ *	INTERVAL_NS The time between edges
+ *
+ * Return
+ * 	The latency distribution
+ */
+LatencySelfTest::Report LatencySelfTest::run(const RealTimeProfile &profile, const unsigned int EDGES, const uint64_t INTERVAL_NS)
+{
+	Report report = {EDGES, 0, 0, 0, 0, 0, 0, 0, false};
+
+	BasicGPIO<FakeBackend> input(SELF_TEST_GPIO, GpioBase::DIRECTION::INPUT, GpioBase::EDGE::RISING);
+	input.setRealTimeProfile(profile);
+	input.inputWaitTimeMS = (int)(INTERVAL_NS / 1000000) + 100; //pollEdge() returns once the edges stop
+
+	EdgeEventRing ring(EDGES);
+	vector<uint64_t> raisedNs(EDGES, 0);
+
+	thread poller([&]()
+	{
+		input.triggerOnEdge(ring);
+	});
+
+	//Give the poller time to start waiting, then raise the edges on an absolute schedule
+	struct timespec next;
+	clock_gettime(CLOCK_MONOTONIC, &next);
+	addNs(next, 20000000ULL);
+
+	for(unsigned int edge = 0; edge < EDGES; ++edge)
+	{
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, nullptr);
+
+		FakeBackend::setInput(SELF_TEST_GPIO, GpioBase::VALUE::LOW);
+		raisedNs[edge] = monotonicTimeNs();
+		FakeBackend::setInput(SELF_TEST_GPIO, GpioBase::VALUE::HIGH);
+
+		addNs(next, INTERVAL_NS);
+	}
+
+	poller.join();
+
+	vector<EdgeEvent> events(EDGES);
+	const size_t RECEIVED = ring.drain(events.data(), EDGES);
+
+	/*
+	 * Edges raised before the poller got to read the eventfd are reported by a single
+	 * wakeup. Each wakeup is matched to the oldest edge it reports, the others count
+	 * as coalesced.
+	 */
+	vector<uint64_t> latencies;
+	latencies.reserve(RECEIVED);
+
+	size_t edge = 0;
+
+	for(size_t index = 0; index < RECEIVED && edge < EDGES; ++index)
+	{
+		const uint64_t WAKEUP_NS = events[index].timestampNs;
+
+		if(raisedNs[edge] > WAKEUP_NS)
+		{
+			continue;
+		}
+
+		latencies.push_back(WAKEUP_NS - raisedNs[edge]);
+
+		for(++edge; edge < EDGES && raisedNs[edge] <= WAKEUP_NS; ++edge)
+		{
+			report.coalesced++;
+		}
+	}
+
+	sort(latencies.begin(), latencies.end());
+
+	report.received = RECEIVED;
+
+	if(!latencies.empty())
+	{
+		double total = 0;
+		for(uint64_t latency : latencies)
+		{
+			total += (double)latency;
+		}
+
+		report.meanNs = total / (double)latencies.size();
+		report.p50Ns = latencies[(latencies.size() - 1) / 2];
+		report.p99Ns = latencies[(size_t)((latencies.size() - 1) * 0.99)];
+		report.p999Ns = latencies[(size_t)((latencies.size() - 1) * 0.999)];
+		report.maxNs = latencies.back();
+	}
+
+	//Find out whether the profile's scheduling could actually be applied
+	if(profile.priority > 0)
+	{
+		ScopedRealTimeProfile probe(RealTimeProfile{profile.priority, -1, false, 0});
+		report.realTime = probe.isRealTime();
+	}
+
+	return report;
+}
+
+void LatencySelfTest::print(const char *name, const Report &report)
+{
+	cout << name << ": " << report.received << "/" << report.edges << " edges (" << report.coalesced << " coalesced), wakeup latency mean "
+		 << report.meanNs << " ns, p50 " << report.p50Ns << " ns, p99 " << report.p99Ns << " ns, p999 "
+		 << report.p999Ns << " ns, max " << report.maxNs << " ns" << (report.realTime ? " (SCHED_FIFO)" : "") << endl;
+}
@@ -0,0 +1,38 @@
+#ifndef H_LATENCY_SELF_TEST_H_
+#define H_LATENCY_SELF_TEST_H_
+
+#include <stdint.h>
+
+#include "RealTimeProfile.h"
+
+/*
+ * Measures how long the edge-polling thread takes to wake up, without hardware.
+ * A timer thread raises edges on a FakeBackend input at a fixed interval (the
+ * FakeBackend signals the pin's eventfd), and pollEdge() records every edge into
+ * an EdgeEventRing with the time epoll_wait() returned. The wakeup latency of an
+ * edge is that time minus the time the timer thread raised it.
+ *
+ * Running it once with the default RealTimeProfile and once with
+ * RealTimeProfile::lowLatency() shows what the profile buys on the machine.
+ */
+class LatencySelfTest
+{
+public:
+	struct Report
+	{
+		unsigned int edges;    //Edges raised
+		unsigned int received; //Wakeups recorded into the ring
+		unsigned int coalesced; //Edges raised before the poller woke up for the previous one
+		double meanNs;
+		uint64_t p50Ns;
+		uint64_t p99Ns;
+		uint64_t p999Ns;
+		uint64_t maxNs;
+		bool realTime;         //Whether SCHED_FIFO could be applied
+	};
+
+	static Report run(const RealTimeProfile &profile, const unsigned int EDGES = 2000, const uint64_t INTERVAL_NS = 500000);
+	static void print(const char *name, const Report &report);
+};
+
+#endif /* H_LATENCY_SELF_TEST_H_ */
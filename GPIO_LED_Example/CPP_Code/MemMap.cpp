@@ -1,28 +1,83 @@
+#include <iomanip>
 #include <string.h>
 #include <stdio.h>
-#include <pthread.h>
-#include <sys/epoll.h>
 #include <fcntl.h>
 #include <unistd.h>
-#include <thread>
-#include <fstream>
 #include <sys/mman.h>
 
 #include "MemMap.h"
+#include "TraceRecorder.h"
+
+const string MemMap::DEFAULT_DEVICE_PATH = "/dev/mem";
+
+/* Base address of each GPIO bank, indexed by MemMap::BANK */
+const std::array<ulong, GPIO_BANKS> MemMap::BANK_ADDRESSES = {{
+	GPIO0_MEM_MAP_ADDR,
+	GPIO1_MEM_MAP_ADDR,
+	GPIO2_MEM_MAP_ADDR,
+	GPIO3_MEM_MAP_ADDR
+}};
+
+const std::array<unsigned int, GPIO_SHADOWED_REGISTERS> MemMap::SHADOWED_OFFSETS = {{
+	GPIO_DATAOUT_OFFSET,
+	GPIO_OE_OFFSET,
+	GPIO_DEBOUNCINGTIME_OFFSET,
+	GPIO_DEBOUNCENABLE_OFFSET,
+	GPIO_LEVELDETECT0_OFFSET,
+	GPIO_LEVELDETECT1_OFFSET,
+	GPIO_RISINGDETECT_OFFSET,
+	GPIO_FALLINGDETECT_OFFSET
+}};
+
+const std::array<MemMap::SnapshotRegister, GPIO_SNAPSHOT_REGISTERS> MemMap::SNAPSHOT_REGISTERS = {{
+	{&BankSnapshot::revision,       GPIO_REVISION_OFFSET,        "REVISION"},
+	{&BankSnapshot::sysConfig,      GPIO_SYSCONFIG_OFFSET,       "SYSCONFIG"},
+	{&BankSnapshot::eoi,            GPIO_EOI_OFFSET,             "EOI"},
+	{&BankSnapshot::irqStatusRaw0,  GPIO_IRQSTATUS_RAW_0_OFFSET, "IRQSTATUS_RAW_0"},
+	{&BankSnapshot::irqStatusRaw1,  GPIO_IRQSTATUS_RAW_1_OFFSET, "IRQSTATUS_RAW_1"},
+	{&BankSnapshot::irqStatus0,     GPIO_IRQSTATUS_0_OFFSET,     "IRQSTATUS_0"},
+	{&BankSnapshot::irqStatus1,     GPIO_IRQSTATUS_1_OFFSET,     "IRQSTATUS_1"},
+	{&BankSnapshot::irqStatusSet0,  GPIO_IRQSTATUS_SET_0_OFFSET, "IRQSTATUS_SET_0"},
+	{&BankSnapshot::irqStatusSet1,  GPIO_IRQSTATUS_SET_1_OFFSET, "IRQSTATUS_SET_1"},
+	{&BankSnapshot::irqStatusClr0,  GPIO_IRQSTATUS_CLR_0_OFFSET, "IRQSTATUS_CLR_0"},
+	{&BankSnapshot::irqStatusClr1,  GPIO_IRQSTATUS_CLR_1_OFFSET, "IRQSTATUS_CLR_1"},
+	{&BankSnapshot::irqWaken0,      GPIO_IRQWAKEN_0_OFFSET,      "IRQWAKEN_0"},
+	{&BankSnapshot::irqWaken1,      GPIO_IRQWAKEN_1_OFFSET,      "IRQWAKEN_1"},
+	{&BankSnapshot::sysStatus,      GPIO_SYSSTATUS_OFFSET,       "SYSSTATUS"},
+	{&BankSnapshot::ctrl,           GPIO_CTRL_OFFSET,            "CTRL"},
+	{&BankSnapshot::outputEnable,   GPIO_OE_OFFSET,              "OE"},
+	{&BankSnapshot::dataIn,         GPIO_DATAIN_OFFSET,          "DATAIN"},
+	{&BankSnapshot::dataOut,        GPIO_DATAOUT_OFFSET,         "DATAOUT"},
+	{&BankSnapshot::levelDetect0,   GPIO_LEVELDETECT0_OFFSET,    "LEVELDETECT0"},
+	{&BankSnapshot::levelDetect1,   GPIO_LEVELDETECT1_OFFSET,    "LEVELDETECT1"},
+	{&BankSnapshot::risingDetect,   GPIO_RISINGDETECT_OFFSET,    "RISINGDETECT"},
+	{&BankSnapshot::fallingDetect,  GPIO_FALLINGDETECT_OFFSET,   "FALLINGDETECT"},
+	{&BankSnapshot::debounceEnable, GPIO_DEBOUNCENABLE_OFFSET,   "DEBOUNCENABLE"},
+	{&BankSnapshot::debouncingTime, GPIO_DEBOUNCINGTIME_OFFSET,  "DEBOUNCINGTIME"},
+	{&BankSnapshot::clearDataOut,   GPIO_CLEARDATAOUT_OFFSET,    "CLEARDATAOUT"},
+	{&BankSnapshot::setDataOut,     GPIO_SETDATAOUT_OFFSET,      "SETDATAOUT"}
+}};
 
 /*
  * Description:
+ * 	Creates an empty (unmapped) handle.
  */
-MemMap::MemMap()
+MemMap::RegisterMapping::RegisterMapping() : registerBase(nullptr)
 {
 }
 
-void MemMap::memSetup(ulong* &pinconf, const ulong REGISTER)
+/*
+ * Description:
+ * 	Maps the 4KB register window that starts at REGISTER.
+ *
+ * Args:
+ * 	FILE_DESCRIPTOR An open descriptor of the memory device (/dev/mem or a stand-in file)
+ * 	REGISTER The physical base address of the GPIO bank
+ */
+MemMap::RegisterMapping::RegisterMapping(const int FILE_DESCRIPTOR, const ulong REGISTER) : registerBase(nullptr)
 {
-	int fd = open("/dev/mem", O_RDWR | O_SYNC);
-
 	/* ************************************************************************
-		* "Map the memory" at the physical location GPIO1_MEM_MAP_ADDR.
+		* "Map the memory" at the physical location REGISTER.
 		* ************************************************************************
 		* Creates a new mapping in the virtual address space of the calling process.
 		* This will then return the address of the new mapping.
@@ -68,70 +123,449 @@ void MemMap::memSetup(ulong* &pinconf, const ulong REGISTER)
 		*			 contents of the file mapping.
 		*
 		*		NOTE: Specifies where the memory map starts, so in this case it will start at
-		*			  GPIO1_MEM_MAP_ADDR + GPIO_MAP_SIZE.
+		*			  REGISTER.
 		*
 		* ADDITIONAL NOTES:
-		* The pointer is of type ulong because this type evalutes to 32 bits on the BBB, and
-		* registers are of size 32 bits.
+		* The pointer is of type uint32_t because registers are of size 32 bits (ulong is only
+		* 32 bits on the BBB itself, not on the 64 bit hosts used for benchmarking).
 		*/
-	pinconf = (ulong*)mmap(NULL, //*addr
+	void *mapping = mmap(NULL, //*addr
 		GPIO_MAP_SIZE, //length
 		PROT_READ | PROT_WRITE, //prot
 		MAP_SHARED, //flags
-		fd, //file descriptor
+		FILE_DESCRIPTOR, //file descriptor
 		REGISTER); //offset
+
+	if(mapping == MAP_FAILED)
+	{
+		perror("MemMap::RegisterMapping - Failed to map the GPIO registers: mmap()");
+		return;
+	}
+
+	registerBase = (volatile uint32_t*)mapping;
 }
 
-void MemMap::registerWrite(const ulong REGISTER, const unsigned int OFFSET, const unsigned int VALUE)
+MemMap::RegisterMapping::RegisterMapping(RegisterMapping &&other) : registerBase(other.registerBase)
+{
+	other.registerBase = nullptr;
+}
+
+MemMap::RegisterMapping &MemMap::RegisterMapping::operator=(RegisterMapping &&other)
+{
+	if(this != &other)
+	{
+		unmap();
+		registerBase = other.registerBase;
+		other.registerBase = nullptr;
+	}
+
+	return *this;
+}
+
+void MemMap::RegisterMapping::unmap()
+{
+	if(registerBase != nullptr)
+	{
+		munmap((void*)registerBase, GPIO_MAP_SIZE);
+		registerBase = nullptr;
+	}
+}
+
+MemMap::RegisterMapping::~RegisterMapping()
+{
+	unmap();
+}
+
+/*
+ * Description:
+ * 	Opens the memory device and maps the registers of GPIO0 - GPIO3 once. The
+ * 	mappings stay alive for the lifetime of the object.
+ *
+ * Args:
+ * 	devicePath The memory device to map. Defaults to /dev/mem, but can point at a
+ * 	           (sparse) file that stands in for it when running without hardware.
+ */
+MemMap::MemMap(const string &devicePath) : devicePath(devicePath)
+{
+	for(unsigned int bank = 0; bank < GPIO_BANKS; ++bank)
+	{
+		bankRegisters[bank] = nullptr;
+
+		for(unsigned int index = 0; index < GPIO_SHADOWED_REGISTERS; ++index)
+		{
+			shadow[bank][index].store(0);
+		}
+	}
+
+	int fileDescriptor = open(devicePath.c_str(), O_RDWR | O_SYNC);
+	if(fileDescriptor == -1)
+	{
+		perror(("MemMap - Failed to open the memory device: " + devicePath).c_str());
+		return;
+	}
+
+	for(unsigned int bank = 0; bank < GPIO_BANKS; ++bank)
+	{
+		bankMappings[bank] = RegisterMapping(fileDescriptor, BANK_ADDRESSES[bank]);
+		bankRegisters[bank] = bankMappings[bank].registers();
+	}
+
+	//The mappings remain valid after the file descriptor is closed.
+	close(fileDescriptor);
+
+	refreshShadow();
+}
+
+/*
+ * Description:
+ * 	Read the shadowed registers of every bank back from the device. Done once when
+ * 	the banks are mapped, and needed again only if something other than this MemMap
+ * 	(another process, the kernel) changed them.
+ */
+void MemMap::refreshShadow(void)
+{
+	for(unsigned int bank = 0; bank < GPIO_BANKS; ++bank)
+	{
+		if(bankRegisters[bank] == nullptr)
+		{
+			continue;
+		}
+
+		for(unsigned int index = 0; index < GPIO_SHADOWED_REGISTERS; ++index)
+		{
+			shadow[bank][index].store(bankRegisters[bank][SHADOWED_OFFSETS[index] / sizeof(uint32_t)]);
+		}
+	}
+}
+
+/*
+ * Description:
+ * 	The last known value of a shadowed register, without reading the device.
+ *
+ * Args:
+ * 	GPIO_BANK The bank of the register
+ * 	OFFSET One of the shadowed GPIO_*_OFFSET byte offsets
+ *
+ * Return
+ * 	The shadow copy, 0 if the register is not shadowed
+ */
+uint32_t MemMap::getShadow(const BANK GPIO_BANK, const unsigned int OFFSET) const
+{
+	const int INDEX = getShadowIndex(OFFSET);
+
+	return (INDEX < 0) ? 0 : shadow[(unsigned int)GPIO_BANK][INDEX].load();
+}
+
+/*
+ * Description:
+ * 	Store the shadow of a register into the device, after its shadow was changed.
+ * 	Threads changing the same register can reach this in any order, so a thread that
+ * 	stored an older value could overwrite a newer one: the shadow is checked again
+ * 	after the store, and stored again if it moved on. Whichever store comes last is
+ * 	followed by a check that finds the device and the shadow equal.
+ *
+ * Return
+ * 	The number of device stores made
+ */
+unsigned int MemMap::publish(const unsigned int BANK_INDEX, const unsigned int SHADOW_INDEX)
+{
+	volatile uint32_t *registers = bankRegisters[BANK_INDEX];
+	const unsigned int REGISTER_INDEX = SHADOWED_OFFSETS[SHADOW_INDEX] / sizeof(uint32_t);
+
+	unsigned int stores = 0;
+	uint32_t value;
+
+	do
+	{
+		value = shadow[BANK_INDEX][SHADOW_INDEX].load();
+		registers[REGISTER_INDEX] = value;
+		stores++;
+	}
+	while(shadow[BANK_INDEX][SHADOW_INDEX].load() != value);
+
+	return stores;
+}
+
+/*
+ * Description:
+ * 	Find a register in the shadow.
+ *
+ * Return
+ * 	The index of OFFSET in SHADOWED_OFFSETS, or -1 if the register is not shadowed
+ */
+int MemMap::getShadowIndex(const unsigned int OFFSET)
+{
+	for(unsigned int index = 0; index < GPIO_SHADOWED_REGISTERS; ++index)
+	{
+		if(SHADOWED_OFFSETS[index] == OFFSET)
+		{
+			return (int)index;
+		}
+	}
+
+	return -1;
+}
+
+/*
+ * Description:
+ * 	Check if every GPIO bank was mapped successfully.
+ */
+bool MemMap::isMapped() const
 {
-	ulong* pinconf = NULL;
+	for(unsigned int bank = 0; bank < GPIO_BANKS; ++bank)
+	{
+		if(!bankMappings[bank].isMapped())
+		{
+			return false;
+		}
+	}
 
-	memSetup(pinconf, REGISTER);
+	return true;
+}
 
-	if (pinconf == NULL)
+/*
+ * Description:
+ * 	Find the GPIO bank that starts at the physical address REGISTER.
+ *
+ * Args:
+ * 	REGISTER The physical base address of a GPIO bank (GPIOx_MEM_MAP_ADDR)
+ * 	bank Updated with the matching bank
+ *
+ * Return
+ * 	True if REGISTER is the base address of a GPIO bank
+ */
+bool MemMap::getBank(const ulong REGISTER, BANK &bank)
+{
+	for(unsigned int index = 0; index < GPIO_BANKS; ++index)
+	{
+		if(BANK_ADDRESSES[index] == REGISTER)
+		{
+			bank = (BANK)index;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * Description:
+ * 	Write VALUE into the register at OFFSET of the bank that starts at REGISTER, making
+ * 	the pins in VALUE outputs first. Which pins are outputs is known from the shadow of
+ * 	OE, so OE is only stored when a pin actually changes direction: a plain
+ * 	SETDATAOUT/CLEARDATAOUT write is a single store.
+ * 	The write is recorded by the TraceRecorder while a recording runs.
+ *
+ * 	VALUE replaces the whole register. For a shadowed configuration register (OE,
+ * 	the detect and the debounce registers) the shadow is swapped atomically and
+ * 	published like a commit(), so the device still ends up holding the latest shadow
+ * 	value. But bits that another thread commits to the same register in the meantime
+ * 	are replaced too: threads changing some pins of a register concurrently should
+ * 	use a Transaction.
+ */
+void MemMap::registerWrite(const ulong REGISTER, const unsigned int OFFSET, const unsigned int VALUE)
+{
+	BANK bank;
+
+	if(!getBank(REGISTER, bank) || bankRegisters[(unsigned int)bank] == nullptr)
 	{
 		cout << "ERROR: pinconf not initialized" << endl;
 		return;
 	}
 
+	volatile uint32_t *pinconf = bankRegisters[(unsigned int)bank];
+
+	TraceRecorder::recordRegisterWrite((unsigned int)bank, OFFSET, VALUE);
+
 	/*
-	 Because pinconf1 is of type ulong, everytime a read/write is performed, reading/writing
+	 Because pinconf is of type uint32_t, everytime a read/write is performed, reading/writing
 	 is done for 32 bits. The offset address of the various registers is in bytes, therefore
-	 divide by the size of ulong (which is 32 bits or 4 bytes). E.g:
+	 divide by the size of uint32_t (which is 32 bits or 4 bytes). E.g:
 		GPIO_SYSCONFIG_OFFSET = 0x10 bytes = 16 bytes (note this is the offset from the base address)
 		=> 16 bytes/4 bytes = 4.
 
-		HENCE when we do pinconf1[4], we'll be accessing the address: BASE ADDRESS + (4 * 4 bytes) = BASE ADDRESS + 16 bytes
+		HENCE when we do pinconf[4], we'll be accessing the address: BASE ADDRESS + (4 * 4 bytes) = BASE ADDRESS + 16 bytes
 
-		pinconf1 now points to the address GPIO1_MEM_MAP_ADDR, => BASE ADDRESS (above) is GPIO1_MEM_MAP_ADDR
+		pinconf now points to the address REGISTER, => BASE ADDRESS (above) is REGISTER
 	*/
-	const unsigned int U_LONG_SIZE = sizeof(ulong);
+	const unsigned int U_INT32_SIZE = sizeof(uint32_t);
+
+	const unsigned int BYTE_OFFSET = OFFSET / U_INT32_SIZE;
 
-	const unsigned int GPIO_OE_BYTE_OFFSET = GPIO_OE_OFFSET / U_LONG_SIZE;
-	const unsigned int BYTE_OFFSET = OFFSET / U_LONG_SIZE;
+	//Set the bits specified by VALUE as outputs, nothing to store if they already are
+	if(shadow[(unsigned int)bank][getShadowIndex(GPIO_OE_OFFSET)].load() & VALUE)
+	{
+		Transaction(*this).setOutput(bank, VALUE).commit();
+	}
+
+	const int SHADOW_INDEX = getShadowIndex(OFFSET);
+	if(SHADOW_INDEX >= 0 && OFFSET != GPIO_DATAOUT_OFFSET)
+	{
+		//A shadowed configuration register: other threads may be committing to it, so
+		//swap the shadow in one atomic step and let publish() order the device stores.
+		//Always stored, write() may have changed the device behind the shadow.
+		shadow[(unsigned int)bank][SHADOW_INDEX].exchange(VALUE);
+		publish((unsigned int)bank, SHADOW_INDEX);
+		return;
+	}
 
-	pinconf[GPIO_OE_BYTE_OFFSET] &= (0xFFFFFFFF ^ VALUE); //Set the bit specified by VALUE as an output (all other bits are inputs)
 	pinconf[BYTE_OFFSET] = VALUE; //Write the value specified by VALUE into REGISTER at BYTE_OFFSET
+
+	if(SHADOW_INDEX >= 0)
+	{
+		shadow[(unsigned int)bank][SHADOW_INDEX].store(VALUE);
+	}
 }
 
-void MemMap::registerRead(void)
+/*
+ * Description:
+ * 	Read the register at OFFSET of the bank that starts at REGISTER, the counterpart
+ * 	of registerWrite().
+ *
+ * Return
+ * 	The value of the register, 0 if the bank is not mapped
+ */
+uint32_t MemMap::registerRead(const ulong REGISTER, const unsigned int OFFSET) const
 {
+	BANK bank;
+
+	if(!getBank(REGISTER, bank) || bankRegisters[(unsigned int)bank] == nullptr)
+	{
+		cout << "ERROR: pinconf not initialized" << endl;
+		return 0;
+	}
+
+	volatile uint32_t *pinconf = bankRegisters[(unsigned int)bank];
+
 	/*
-	 Because pinconf1 is of type ulong, everytime a read/write is performed, reading/writing
+	 Because pinconf is of type uint32_t, everytime a read/write is performed, reading/writing
 	 is done for 32 bits. The offset address of the various registers is in bytes, therefore
-	 divide by the size of ulong (which is 32 bits or 4 bytes). E.g:
+	 divide by the size of uint32_t (which is 32 bits or 4 bytes). E.g:
 		GPIO_SYSCONFIG_OFFSET = 0x10 bytes = 16 bytes (note this is the offset from the base address)
 		=> 16 bytes/4 bytes = 4.
 
-		HENCE when we do pinconf1[4], we'll be accessing the address: BASE ADDRESS + (4 * 4 bytes) = BASE ADDRESS + 16 bytes
+		HENCE when we do pinconf[4], we'll be accessing the address: BASE ADDRESS + (4 * 4 bytes) = BASE ADDRESS + 16 bytes
 
-		pinconf1 now points to the address GPIO1_MEM_MAP_ADDR, => BASE ADDRESS (above) is GPIO1_MEM_MAP_ADDR
+		pinconf now points to the address REGISTER, => BASE ADDRESS (above) is REGISTER
 	*/
-	//const unsigned int U_LONG_SIZE = sizeof(ulong);
+	const unsigned int U_INT32_SIZE = sizeof(uint32_t);
+
+	const unsigned int BYTE_OFFSET = OFFSET / U_INT32_SIZE;
+
+	return pinconf[BYTE_OFFSET];
+}
+
+/*
+ * Description:
+ * 	Read the level of every pin of every bank: four loads in place of up to 128
+ * 	sysfs value reads. Bit n of dataIn[bank] is GPIO<bank>_<n>.
+ *
+ * Args:
+ * 	dataIn Receives the DATAIN register of each bank, 0 for banks that are not mapped
+ */
+void MemMap::readInputs(uint32_t dataIn[GPIO_BANKS]) const
+{
+	for(unsigned int bank = 0; bank < GPIO_BANKS; ++bank)
+	{
+		dataIn[bank] = (bankRegisters[bank] != nullptr) ? bankRegisters[bank][GPIO_DATAIN_OFFSET / sizeof(uint32_t)] : 0;
+	}
+}
+
+/*
+ * Description:
+ * 	Read every register of every mapped bank once. Reading has no side effect on
+ * 	the GPIO module: the interrupt status registers are only cleared by writes.
+ *
+ * Return
+ * 	The registers, banks that are not mapped are all zeros
+ */
+MemMap::Snapshot MemMap::snapshot(void) const
+{
+	Snapshot result = {};
+
+	for(unsigned int bank = 0; bank < GPIO_BANKS; ++bank)
+	{
+		volatile uint32_t *registers = bankRegisters[bank];
 
-	//const unsigned int GPIO_OE_BYTE_OFFSET = GPIO_OE_OFFSET / U_LONG_SIZE;
+		if(registers == nullptr)
+		{
+			continue;
+		}
 
-	//cout << "GPIO_OE_BYTE_OFFSET: " << std::hex << pinconf[GPIO_OE_BYTE_OFFSET] << endl;
+		for(const SnapshotRegister &REGISTER : SNAPSHOT_REGISTERS)
+		{
+			result.banks[bank].*REGISTER.field = registers[REGISTER.offset / sizeof(uint32_t)];
+		}
+	}
+
+	return result;
+}
+
+/*
+ * Description:
+ * 	Which bits changed from one snapshot to another.
+ *
+ * Return
+ * 	A snapshot holding A ^ B register by register: set bits are the ones that differ,
+ * 	see Snapshot::isEmpty()
+ */
+MemMap::Snapshot MemMap::diff(const Snapshot &A, const Snapshot &B)
+{
+	Snapshot result;
+
+	for(unsigned int bank = 0; bank < GPIO_BANKS; ++bank)
+	{
+		for(const SnapshotRegister &REGISTER : SNAPSHOT_REGISTERS)
+		{
+			result.banks[bank].*REGISTER.field = A.banks[bank].*REGISTER.field ^ B.banks[bank].*REGISTER.field;
+		}
+	}
+
+	return result;
+}
+
+/*
+ * Description:
+ * 	Whether every register is zero, e.g. a diff() of two identical snapshots.
+ */
+bool MemMap::Snapshot::isEmpty(void) const
+{
+	for(unsigned int bank = 0; bank < GPIO_BANKS; ++bank)
+	{
+		for(const SnapshotRegister &REGISTER : SNAPSHOT_REGISTERS)
+		{
+			if(banks[bank].*REGISTER.field != 0)
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Description:
+ * 	Print the registers that are not zero, one per line: "GPIO1 DATAOUT 0x00020000".
+ */
+void MemMap::Snapshot::print(ostream &output) const
+{
+	const char FILL = output.fill('0');
+
+	for(unsigned int bank = 0; bank < GPIO_BANKS; ++bank)
+	{
+		for(const SnapshotRegister &REGISTER : SNAPSHOT_REGISTERS)
+		{
+			const uint32_t VALUE = banks[bank].*REGISTER.field;
+
+			if(VALUE != 0)
+			{
+				output << "GPIO" << bank << " " << REGISTER.name << " 0x" << hex << setw(8) << VALUE << dec << endl;
+			}
+		}
+	}
+
+	output.fill(FILL);
 }
 
 /*
@@ -140,3 +574,157 @@ void MemMap::registerRead(void)
 MemMap::~MemMap()
 {
 }
+
+/* ************************************************************************
+ * MemMap::Transaction
+ * ************************************************************************/
+MemMap::Transaction::Transaction(MemMap &memmap) : memmap(memmap), touchedBanks(0)
+{
+	memset(this->values, 0, sizeof(this->values));
+	memset(this->touched, 0, sizeof(this->touched));
+}
+
+/*
+ * Description:
+ * 	Stage bits of a shadowed register to 1 (setBits), to 0 (clearBits), or the whole
+ * 	register (assign). Later changes to the same bits replace earlier ones.
+ *
+ * Args:
+ * 	GPIO_BANK The bank of the register
+ * 	OFFSET One of the shadowed GPIO_*_OFFSET byte offsets
+ * 	MASK The bits to change
+ *
+ * Return
+ * 	The transaction, so changes can be chained
+ */
+MemMap::Transaction &MemMap::Transaction::setBits(const BANK GPIO_BANK, const unsigned int OFFSET, const uint32_t MASK)
+{
+	stage(GPIO_BANK, OFFSET, MASK, 0xFFFFFFFF);
+	return *this;
+}
+
+MemMap::Transaction &MemMap::Transaction::clearBits(const BANK GPIO_BANK, const unsigned int OFFSET, const uint32_t MASK)
+{
+	stage(GPIO_BANK, OFFSET, MASK, 0);
+	return *this;
+}
+
+MemMap::Transaction &MemMap::Transaction::assign(const BANK GPIO_BANK, const unsigned int OFFSET, const uint32_t VALUE)
+{
+	stage(GPIO_BANK, OFFSET, 0xFFFFFFFF, VALUE);
+	return *this;
+}
+
+bool MemMap::Transaction::stage(const BANK GPIO_BANK, const unsigned int OFFSET, const uint32_t MASK, const uint32_t VALUE)
+{
+	const int INDEX = getShadowIndex(OFFSET);
+
+	if(INDEX < 0 || (unsigned int)GPIO_BANK >= GPIO_BANKS)
+	{
+		cout << "ERROR: MemMap::Transaction - register 0x" << hex << OFFSET << dec << " is not shadowed" << endl;
+		return false;
+	}
+
+	uint32_t &value = this->values[(unsigned int)GPIO_BANK][INDEX];
+
+	value = (value & ~MASK) | (VALUE & MASK);
+	this->touched[(unsigned int)GPIO_BANK][INDEX] |= MASK;
+	this->touchedBanks |= 1U << (unsigned int)GPIO_BANK;
+
+	return true;
+}
+
+/*
+ * Description:
+ * 	Store the staged changes: every register whose value changes is stored once,
+ * 	registers left as they were are not stored at all. The transaction is empty
+ * 	afterwards and can be reused.
+ *
+ * Return
+ * 	The number of device stores made
+ */
+unsigned int MemMap::Transaction::commit(void)
+{
+	unsigned int stores = 0;
+
+	for(unsigned int bank = 0; bank < GPIO_BANKS; ++bank)
+	{
+		volatile uint32_t *registers = this->memmap.bankRegisters[bank];
+
+		if(registers == nullptr || !(this->touchedBanks & (1U << bank)))
+		{
+			continue;
+		}
+
+		for(unsigned int index = 0; index < GPIO_SHADOWED_REGISTERS; ++index)
+		{
+			const uint32_t TOUCHED = this->touched[bank][index];
+
+			if(TOUCHED == 0)
+			{
+				continue;
+			}
+
+			atomic<uint32_t> &shadowed = this->memmap.shadow[bank][index];
+			const uint32_t STAGED = this->values[bank][index] & TOUCHED;
+
+			if(MemMap::SHADOWED_OFFSETS[index] == GPIO_DATAOUT_OFFSET)
+			{
+				//SETDATAOUT/CLEARDATAOUT only change the bits written, no other thread's bits can be lost
+				const uint32_t LOW = ~this->values[bank][index] & TOUCHED;
+
+				if(STAGED != 0)
+				{
+					registers[GPIO_SETDATAOUT_OFFSET / sizeof(uint32_t)] = STAGED;
+					shadowed.fetch_or(STAGED);
+					stores++;
+				}
+
+				if(LOW != 0)
+				{
+					registers[GPIO_CLEARDATAOUT_OFFSET / sizeof(uint32_t)] = LOW;
+					shadowed.fetch_and(~LOW);
+					stores++;
+				}
+
+				continue;
+			}
+
+			//Only this transaction's bits change, whatever other threads committed in the meantime
+			uint32_t previous = shadowed.load();
+			uint32_t value;
+
+			do
+			{
+				value = (previous & ~TOUCHED) | STAGED;
+			}
+			while(value != previous && !shadowed.compare_exchange_weak(previous, value));
+
+			if(value != previous)
+			{
+				stores += this->memmap.publish(bank, index);
+			}
+		}
+	}
+
+	discard();
+	return stores;
+}
+
+/*
+ * Description:
+ * 	Drop every staged change.
+ */
+void MemMap::Transaction::discard(void)
+{
+	for(unsigned int bank = 0; bank < GPIO_BANKS; ++bank)
+	{
+		if(this->touchedBanks & (1U << bank))
+		{
+			memset(this->values[bank], 0, sizeof(this->values[bank]));
+			memset(this->touched[bank], 0, sizeof(this->touched[bank]));
+		}
+	}
+
+	this->touchedBanks = 0;
+}
@@ -2,6 +2,12 @@
 #define H_MEM_MAP_H_
 
 #include <iostream>
+#include <array>
+#include <atomic>
+#include <string>
+#include <type_traits>
+#include <stdint.h>
+#include <sys/types.h>
 
 /* Memmory map addresses for GPIO: See TRM */
 #define GPIO0_MEM_MAP_ADDR 0x44E07000
@@ -9,6 +15,9 @@
 #define GPIO2_MEM_MAP_ADDR 0x481AC000
 #define GPIO3_MEM_MAP_ADDR 0x481AE000
 
+/* The number of GPIO banks (GPIO0 - GPIO3) */
+#define GPIO_BANKS 4
+
 /* The lenght of each GPIO section is 4KB: See TRM*/
 #define GPIO_MAP_SIZE 4096UL
 
@@ -40,20 +49,265 @@
 #define GPIO_CLEARDATAOUT_OFFSET    0x190
 #define GPIO_SETDATAOUT_OFFSET      0x194
 
+/* The debouncing time of a bank is (GPIO_DEBOUNCINGTIME + 1) periods of the 32kHz debounce clock (31 us): See TRM */
+#define GPIO_DEBOUNCE_PERIOD_NS     31000ULL
+#define GPIO_DEBOUNCINGTIME_MAX     0xFFU
+
+/* The configuration registers MemMap keeps a shadow copy of, see MemMap::Transaction */
+#define GPIO_SHADOWED_REGISTERS     8
+
+/* Every register listed above, see MemMap::Snapshot */
+#define GPIO_SNAPSHOT_REGISTERS     26
+
 using namespace std;
 
 
 class MemMap
 {
 public:
-	MemMap();
+	enum class BANK
+	{
+		GPIO0 = 0,
+		GPIO1 = 1,
+		GPIO2 = 2,
+		GPIO3 = 3
+	};
+
+	/*
+	 * Owns the mapping of a single 4KB GPIO register window. The window is
+	 * unmapped when the handle goes out of scope.
+	 */
+	class RegisterMapping
+	{
+	public:
+		RegisterMapping();
+		RegisterMapping(const int FILE_DESCRIPTOR, const ulong REGISTER);
+		RegisterMapping(RegisterMapping &&other);
+		RegisterMapping &operator=(RegisterMapping &&other);
+		~RegisterMapping();
+
+		RegisterMapping(const RegisterMapping &) = delete;
+		RegisterMapping &operator=(const RegisterMapping &) = delete;
+
+		volatile uint32_t *registers() const { return registerBase; }
+		bool isMapped() const { return registerBase != nullptr; }
+
+	private:
+		volatile uint32_t *registerBase;
+
+		void unmap();
+	};
+
+	/*
+	 * Changes to the shadowed registers (OE, DATAOUT, the detect and the debounce
+	 * registers) of any bank, staged bit by bit and committed at once. commit() works
+	 * out each register's new value from the shadow copy, without reading the device,
+	 * and stores only the registers that change. Configuring many pins costs one store
+	 * per register touched instead of a read-modify-write per pin.
+	 *
+	 * Output levels are committed through SETDATAOUT/CLEARDATAOUT, and are always
+	 * stored: setValue() and write() change DATAOUT without going through the shadow.
+	 *
+	 * Changes not committed are dropped with the transaction. A transaction belongs to
+	 * one thread, but any number of threads can commit their own transactions at the
+	 * same time: each register's shadow is updated with a compare-and-swap, so
+	 * concurrent changes to different bits of a register are never lost, and the
+	 * device always ends up holding the latest shadow value (see publish()).
+	 */
+	class Transaction
+	{
+	public:
+		explicit Transaction(MemMap &memmap);
+
+		Transaction &setBits(const BANK GPIO_BANK, const unsigned int OFFSET, const uint32_t MASK);
+		Transaction &clearBits(const BANK GPIO_BANK, const unsigned int OFFSET, const uint32_t MASK);
+		Transaction &assign(const BANK GPIO_BANK, const unsigned int OFFSET, const uint32_t VALUE);
+
+		/* OE: a cleared bit makes the pin an output */
+		Transaction &setOutput(const BANK GPIO_BANK, const uint32_t MASK) { return clearBits(GPIO_BANK, GPIO_OE_OFFSET, MASK); }
+		Transaction &setInput(const BANK GPIO_BANK, const uint32_t MASK) { return setBits(GPIO_BANK, GPIO_OE_OFFSET, MASK); }
+
+		/* DATAOUT */
+		Transaction &setHigh(const BANK GPIO_BANK, const uint32_t MASK) { return setBits(GPIO_BANK, GPIO_DATAOUT_OFFSET, MASK); }
+		Transaction &setLow(const BANK GPIO_BANK, const uint32_t MASK) { return clearBits(GPIO_BANK, GPIO_DATAOUT_OFFSET, MASK); }
+
+		unsigned int commit(void);
+		void discard(void);
+
+	private:
+		MemMap &memmap;
+		uint32_t values[GPIO_BANKS][GPIO_SHADOWED_REGISTERS];  //The staged bits
+		uint32_t touched[GPIO_BANKS][GPIO_SHADOWED_REGISTERS]; //Which bits were staged
+		unsigned int touchedBanks;                             //Bit n set if bank n has staged bits
+
+		bool stage(const BANK GPIO_BANK, const unsigned int OFFSET, const uint32_t MASK, const uint32_t VALUE);
+	};
+
+	/* Every register of one bank, as read by MemMap::snapshot() */
+	struct BankSnapshot
+	{
+		uint32_t revision;
+		uint32_t sysConfig;
+		uint32_t eoi;
+		uint32_t irqStatusRaw0;
+		uint32_t irqStatusRaw1;
+		uint32_t irqStatus0;
+		uint32_t irqStatus1;
+		uint32_t irqStatusSet0; //Reads back the enabled interrupts of line 0
+		uint32_t irqStatusSet1;
+		uint32_t irqStatusClr0; //Same as irqStatusSet0
+		uint32_t irqStatusClr1;
+		uint32_t irqWaken0;
+		uint32_t irqWaken1;
+		uint32_t sysStatus;
+		uint32_t ctrl;
+		uint32_t outputEnable;
+		uint32_t dataIn;
+		uint32_t dataOut;
+		uint32_t levelDetect0;
+		uint32_t levelDetect1;
+		uint32_t risingDetect;
+		uint32_t fallingDetect;
+		uint32_t debounceEnable;
+		uint32_t debouncingTime;
+		uint32_t clearDataOut;  //Reads back DATAOUT
+		uint32_t setDataOut;    //Reads back DATAOUT
+	};
+
+	/*
+	 * Every register of every bank at one point in time. Plain data: it can be copied,
+	 * compared, kept in a ring or written to a file as it is. Banks that are not
+	 * mapped read as all zeros.
+	 */
+	struct Snapshot
+	{
+		BankSnapshot banks[GPIO_BANKS];
+
+		bool isEmpty(void) const;
+		void print(ostream &output) const;
+	};
+
+	/* A register of the snapshot: where it is kept, where it is read from and its name in the TRM */
+	struct SnapshotRegister
+	{
+		uint32_t BankSnapshot::*field;
+		unsigned int offset;
+		const char *name;
+	};
+
+	static const std::array<SnapshotRegister, GPIO_SNAPSHOT_REGISTERS> SNAPSHOT_REGISTERS;
+
+	/* The shadowed registers, in the order a transaction stores them (levels before directions, time before enable) */
+	static const std::array<unsigned int, GPIO_SHADOWED_REGISTERS> SHADOWED_OFFSETS;
+
+	static const string DEFAULT_DEVICE_PATH;
+	static const std::array<ulong, GPIO_BANKS> BANK_ADDRESSES;
+
+	MemMap(const string &devicePath = DEFAULT_DEVICE_PATH);
 	~MemMap();
 
+	MemMap(const MemMap &) = delete;
+	MemMap &operator=(const MemMap &) = delete;
+
+	/*
+	 * Hot path: a single volatile store into an already mapped bank. OFFSET is
+	 * one of the GPIO_*_OFFSET byte offsets above. Stores into SETDATAOUT and
+	 * CLEARDATAOUT only change the pins written, so any number of threads can drive
+	 * pins of the same bank this way without a lock. Configuration registers should
+	 * go through a Transaction instead.
+	 */
+	inline void write(const BANK GPIO_BANK, const unsigned int OFFSET, const uint32_t VALUE)
+	{
+		bankRegisters[(unsigned int)GPIO_BANK][OFFSET / sizeof(uint32_t)] = VALUE;
+	}
+
+	/*
+	 * A single volatile load from an already mapped bank.
+	 */
+	inline uint32_t read(const BANK GPIO_BANK, const unsigned int OFFSET) const
+	{
+		return bankRegisters[(unsigned int)GPIO_BANK][OFFSET / sizeof(uint32_t)];
+	}
+
+	/* Reads of the registers used most, one volatile load each */
+	inline uint32_t readDataIn(const BANK GPIO_BANK) const { return read(GPIO_BANK, GPIO_DATAIN_OFFSET); }
+	inline uint32_t readDataOut(const BANK GPIO_BANK) const { return read(GPIO_BANK, GPIO_DATAOUT_OFFSET); }
+	inline uint32_t readOutputEnable(const BANK GPIO_BANK) const { return read(GPIO_BANK, GPIO_OE_OFFSET); }
+	inline uint32_t readIrqStatusRaw(const BANK GPIO_BANK) const { return read(GPIO_BANK, GPIO_IRQSTATUS_RAW_0_OFFSET); }
+	inline uint32_t readIrqStatus(const BANK GPIO_BANK) const { return read(GPIO_BANK, GPIO_IRQSTATUS_0_OFFSET); }
+
+	void readInputs(uint32_t dataIn[GPIO_BANKS]) const;
+	Snapshot snapshot(void) const;
+	static Snapshot diff(const Snapshot &A, const Snapshot &B);
+
 	void registerWrite(const ulong REGISTER, const unsigned int OFFSET, const unsigned int VALUE);
-	void registerRead(void);
+	uint32_t registerRead(const ulong REGISTER, const unsigned int OFFSET) const;
+
+	bool isMapped() const;
+	const string &getDevicePath() const { return devicePath; }
+
+	uint32_t getShadow(const BANK GPIO_BANK, const unsigned int OFFSET) const;
+	void refreshShadow(void);
+
+	static bool getBank(const ulong REGISTER, BANK &bank);
+	static int getShadowIndex(const unsigned int OFFSET);
 
 private:
-	void memSetup(ulong* &pinconf, const ulong REGISTER);
+	string devicePath;
+	atomic<uint32_t> shadow[GPIO_BANKS][GPIO_SHADOWED_REGISTERS]; //Last known value of the shadowed registers
+	std::array<RegisterMapping, GPIO_BANKS> bankMappings;
+	volatile uint32_t *bankRegisters[GPIO_BANKS]; //Cached copy of each mapping's base for the hot path
+
+	unsigned int publish(const unsigned int BANK_INDEX, const unsigned int SHADOW_INDEX);
 };
 
+/*
+ * The bit-banged buses and EdgeCounter are templates over the register file their
+ * pins live in: MemMap on the board, or any class with the same read()/write() (e.g.
+ * a model of the banks for benchmarking). The two helpers below are how they touch
+ * configuration registers, so on the board those changes go through MemMap's shadow.
+ */
+
+/*
+ * Description:
+ * 	Clear then set bits of a register. On MemMap this is a Transaction, so it does not
+ * 	lose (or get undone by) changes other threads commit to the same register. Other
+ * 	register files get a read-modify-write.
+ *
+ * Args:
+ * 	CLEAR The bits set to 0
+ * 	SET The bits set to 1, applied after CLEAR
+ */
+template<typename REGISTERS>
+inline void updateBits(REGISTERS &registers, const MemMap::BANK GPIO_BANK, const unsigned int OFFSET, const uint32_t CLEAR,
+					   const uint32_t SET)
+{
+	if constexpr(is_same<REGISTERS, MemMap>::value)
+	{
+		MemMap::Transaction(registers).clearBits(GPIO_BANK, OFFSET, CLEAR).setBits(GPIO_BANK, OFFSET, SET).commit();
+	}
+	else
+	{
+		registers.write(GPIO_BANK, OFFSET, (registers.read(GPIO_BANK, OFFSET) & ~CLEAR) | SET);
+	}
+}
+
+/*
+ * Description:
+ * 	Read a configuration register: the shadow on MemMap (what updateBits() last
+ * 	committed), the register itself on other register files.
+ */
+template<typename REGISTERS>
+inline uint32_t readBits(const REGISTERS &registers, const MemMap::BANK GPIO_BANK, const unsigned int OFFSET)
+{
+	if constexpr(is_same<REGISTERS, MemMap>::value)
+	{
+		return registers.getShadow(GPIO_BANK, OFFSET);
+	}
+	else
+	{
+		return registers.read(GPIO_BANK, OFFSET);
+	}
+}
+
 #endif /* H_MEM_MAP_H_ */
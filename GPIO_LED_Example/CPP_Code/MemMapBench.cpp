@@ -0,0 +1,126 @@
+/*
+ * This program measures how many GPIO register writes per second MemMap can
+ * perform. It compares the old approach (open + mmap of the bank on every write)
+ * against the persistent bank mappings.
+ *
+ * It runs against a sparse file that stands in for /dev/mem, so no hardware is
+ * needed. Pass a different device path as the first argument to run it on the BBB.
+ */
+
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "MemMap.h"
+
+using namespace std;
+
+static const string STAND_IN_PATH = "/tmp/memmap_bench_dev_mem";
+
+/*
+ * Description:
+ * 	Create a sparse file large enough to cover the register windows of all GPIO banks.
+ */
+static bool createStandIn(const string &path)
+{
+	int fileDescriptor = open(path.c_str(), O_RDWR | O_CREAT, 0600);
+	if(fileDescriptor == -1)
+	{
+		perror(("MemMapBench - Failed to create " + path).c_str());
+		return false;
+	}
+
+	bool sized = ftruncate(fileDescriptor, GPIO3_MEM_MAP_ADDR + GPIO_MAP_SIZE) == 0;
+	if(!sized)
+	{
+		perror("MemMapBench - Failed to size the stand-in file: ftruncate()");
+	}
+
+	close(fileDescriptor);
+	return sized;
+}
+
+/*
+ * Description:
+ * 	The register write as it was done before the bank mappings were kept: open the
+ * 	device and map the bank on every call. Unlike the old code this releases the
+ * 	mapping and descriptor, otherwise the benchmark runs out of descriptors.
+ */
+static void legacyRegisterWrite(const string &path, const ulong REGISTER, const unsigned int OFFSET, const unsigned int VALUE)
+{
+	int fileDescriptor = open(path.c_str(), O_RDWR | O_SYNC);
+	void *mapping = mmap(NULL, GPIO_MAP_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, REGISTER);
+
+	if(mapping != MAP_FAILED)
+	{
+		volatile uint32_t *pinconf = (volatile uint32_t*)mapping;
+		pinconf[GPIO_OE_OFFSET / sizeof(uint32_t)] = pinconf[GPIO_OE_OFFSET / sizeof(uint32_t)] & (0xFFFFFFFF ^ VALUE);
+		pinconf[OFFSET / sizeof(uint32_t)] = VALUE;
+		munmap(mapping, GPIO_MAP_SIZE);
+	}
+
+	close(fileDescriptor);
+}
+
+template<typename WRITE>
+static void report(const string &name, const unsigned long ITERATIONS, WRITE write)
+{
+	auto start = chrono::steady_clock::now();
+
+	for(unsigned long i = 0; i < ITERATIONS; ++i)
+	{
+		write(i);
+	}
+
+	chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+	cout << name << ": " << (unsigned long)(ITERATIONS / elapsed.count()) << " writes/sec ("
+		 << (elapsed.count() * 1e9 / ITERATIONS) << " ns/write)" << endl;
+}
+
+int main(int argc, char *argv[])
+{
+	string devicePath = STAND_IN_PATH;
+
+	if(argc > 1)
+	{
+		devicePath = argv[1];
+	}
+	else if(!createStandIn(devicePath))
+	{
+		return EXIT_FAILURE;
+	}
+
+	MemMap memmap(devicePath);
+	if(!memmap.isMapped())
+	{
+		return EXIT_FAILURE;
+	}
+
+	const uint32_t LED_BIT = (1 << 17);
+
+	report("mmap per write (before)", 20000, [&](unsigned long i)
+	{
+		legacyRegisterWrite(devicePath, GPIO1_MEM_MAP_ADDR, (i & 1) ? GPIO_CLEARDATAOUT_OFFSET : GPIO_SETDATAOUT_OFFSET, LED_BIT);
+	});
+
+	report("MemMap::registerWrite (after)", 10000000, [&](unsigned long i)
+	{
+		memmap.registerWrite(GPIO1_MEM_MAP_ADDR, (i & 1) ? GPIO_CLEARDATAOUT_OFFSET : GPIO_SETDATAOUT_OFFSET, LED_BIT);
+	});
+
+	report("MemMap::write (after)", 10000000, [&](unsigned long i)
+	{
+		memmap.write(MemMap::BANK::GPIO1, (i & 1) ? GPIO_CLEARDATAOUT_OFFSET : GPIO_SETDATAOUT_OFFSET, LED_BIT);
+	});
+
+	if(argc <= 1)
+	{
+		unlink(devicePath.c_str());
+	}
+
+	return 0;
+}
@@ -0,0 +1,684 @@
+#include <algorithm>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+
+#include "OutputScheduler.h"
+#include "PinTable.h"
+#include "CpuAffinity.h"
+#include "Timestamp.h"
+
+/* armedTick when the timerfd is not set */
+static const uint64_t DISARMED = UINT64_MAX;
+
+/*
+ * Get the index of the first set bit of BITS at or after FROM, wrapping around
+ * after bit 63, as a distance from FROM. BITS must not be 0.
+ */
+static inline unsigned int getNextSetBit(const uint64_t BITS, const unsigned int FROM)
+{
+	const uint64_t ROTATED = (FROM == 0) ? BITS : ((BITS >> FROM) | (BITS << (64 - FROM)));
+
+	return (unsigned int)__builtin_ctzll(ROTATED);
+}
+
+/*
+ * Description:
+ * 	Allocate every timer up front and create the timerfd. The scheduler counts its
+ * 	ticks from now.
+ *
+ * Args:
+ * 	memmap The mapped GPIO banks the changes are written to
+ * 	tickNs The resolution of the wheel: changes due in the same tick are written together
+ * 	capacity The number of changes (or pulse trains) that can be pending at once
+ * 	latenessLogEvents The number of fired changes whose lateness is kept, see getLatenessLog()
+ */
+OutputScheduler::OutputScheduler(MemMap &memmap, uint64_t tickNs, size_t capacity, size_t latenessLogEvents) : memmap(memmap),
+	tickNs(tickNs == 0 ? 1 : tickNs), originNs(monotonicTimeNs()), timerFileDescriptor(-1), freeList(NONE), currentTick(0),
+	armedTick(DISARMED), pendingCount(0), running(false), scheduledCount(0), rejectedCount(0), cancelledCount(0), firedCount(0),
+	storeCount(0), wakeupCount(0), latenessLogEvents(latenessLogEvents)
+{
+	//The thread blocks reading the timerfd, so it is not non-blocking
+	this->timerFileDescriptor = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+	if(this->timerFileDescriptor == -1)
+	{
+		perror("OutputScheduler - Failed to create the timer: timerfd_create()");
+		exit(EXIT_FAILURE);
+	}
+
+	this->timers.resize(capacity);
+	this->due.reserve(capacity);
+	this->latenessLog.reserve(latenessLogEvents);
+
+	for(size_t index = capacity; index > 0; --index)
+	{
+		Timer &timer = this->timers[index - 1];
+		timer.generation = 1;
+		timer.list = NONE;
+		timer.previous = NONE;
+		timer.next = this->freeList;
+		this->freeList = (int32_t)(index - 1);
+	}
+
+	fill(this->heads, this->heads + LEVELS * SLOTS, NONE);
+	fill(this->occupied, this->occupied + LEVELS, 0);
+}
+
+OutputScheduler::~OutputScheduler()
+{
+	stop();
+
+	if(this->timerFileDescriptor != -1)
+	{
+		close(this->timerFileDescriptor);
+	}
+}
+
+/*
+ * Description:
+ *	Start the thread that writes the changes. Changes can be scheduled before, the
+ *	ones already due are written as soon as it runs.
+ *
+ * Args:
+ *	CPU The core to run the thread on, or -1 to let it run anywhere
+ *
+ * Return
+ * 	False if the thread is already running
+ */
+bool OutputScheduler::start(const int CPU)
+{
+	if(this->running.exchange(true))
+	{
+		return false;
+	}
+
+	this->worker = thread(&OutputScheduler::run, this, CPU);
+
+	lock_guard<mutex> lock(this->wheelMutex);
+	updateTimer();
+
+	return true;
+}
+
+/*
+ * Description:
+ *	Stop the thread and wait for it. The pending changes are kept, and written
+ *	(late) if start() is called again.
+ */
+void OutputScheduler::stop(void)
+{
+	{
+		lock_guard<mutex> lock(this->wheelMutex);
+
+		if(!this->running.exchange(false))
+		{
+			return;
+		}
+
+		//A deadline in the past wakes the thread up right away
+		armTimer(1);
+	}
+
+	if(this->worker.joinable())
+	{
+		this->worker.join();
+	}
+
+	lock_guard<mutex> lock(this->wheelMutex);
+	armTimer(0);
+	this->armedTick = DISARMED;
+}
+
+/*
+ * Description:
+ *	Change a pin once, at an absolute time.
+ *
+ * Args:
+ *	GPIO_PIN The GPIO number of the pin
+ *	GPIO_VALUE The value to write
+ *	DEADLINE_NS When to write it, CLOCK_MONOTONIC (see monotonicTimeNs()). A
+ *	            deadline already passed is written at the next tick.
+ *
+ * Return
+ * 	A handle for cancel(), or INVALID_HANDLE if the change could not be scheduled
+ */
+uint64_t OutputScheduler::schedule(const unsigned int GPIO_PIN, const GpioBase::VALUE GPIO_VALUE, const uint64_t DEADLINE_NS)
+{
+	return add(GPIO_PIN, GPIO_VALUE, DEADLINE_NS, 0, 0, 0);
+}
+
+/*
+ * Description:
+ *	Drive a pulse train on a pin: HIGH at FIRST_DEADLINE_NS and at every period
+ *	after it, LOW HIGH_NS after each of those. Every period is taken from the
+ *	previous deadline, not from when the change was written, so the train does not
+ *	drift with the lateness of the thread.
+ *
+ * Args:
+ *	GPIO_PIN The GPIO number of the pin
+ *	FIRST_DEADLINE_NS When the first pulse starts, CLOCK_MONOTONIC
+ *	PERIOD_NS The time between the starts of two pulses
+ *	HIGH_NS The width of every pulse, greater than 0 and less than PERIOD_NS
+ *	COUNT The number of pulses, or 0 to run until cancel() is called
+ *
+ * Return
+ * 	A handle for cancel(), or INVALID_HANDLE if the train could not be scheduled
+ */
+uint64_t OutputScheduler::schedulePeriodic(const unsigned int GPIO_PIN, const uint64_t FIRST_DEADLINE_NS, const uint64_t PERIOD_NS,
+										   const uint64_t HIGH_NS, const uint64_t COUNT)
+{
+	if(HIGH_NS == 0 || HIGH_NS >= PERIOD_NS)
+	{
+		cout << "ERROR: OutputScheduler::schedulePeriodic - The pulse width " << HIGH_NS << "ns must be between 0 and the period "
+			 << PERIOD_NS << "ns" << endl;
+		return INVALID_HANDLE;
+	}
+
+	return add(GPIO_PIN, GpioBase::VALUE::HIGH, FIRST_DEADLINE_NS, PERIOD_NS, HIGH_NS, COUNT);
+}
+
+/*
+ * Description:
+ *	Remove a pending change, or stop a pulse train. The pin is left as it is.
+ *
+ * Args:
+ *	HANDLE What schedule() or schedulePeriodic() returned
+ *
+ * Return
+ * 	False if the change already fired, or the handle is not valid
+ */
+bool OutputScheduler::cancel(const uint64_t HANDLE)
+{
+	const uint64_t INDEX = (HANDLE & 0xFFFFFFFFULL) - 1;
+	const uint32_t GENERATION = (uint32_t)(HANDLE >> 32);
+
+	lock_guard<mutex> lock(this->wheelMutex);
+
+	if(HANDLE == INVALID_HANDLE || INDEX >= this->timers.size())
+	{
+		return false;
+	}
+
+	Timer &timer = this->timers[INDEX];
+
+	if(timer.list == NONE || timer.generation != GENERATION)
+	{
+		return false;
+	}
+
+	unlink((int32_t)INDEX);
+	release((int32_t)INDEX);
+	this->cancelledCount.fetch_add(1, memory_order_relaxed);
+
+	//The timerfd is left as it is: waking up for nothing is cheaper than a system call per cancel
+	return true;
+}
+
+OutputScheduler::Statistics OutputScheduler::getStatistics(void) const
+{
+	Statistics statistics;
+
+	statistics.scheduled = this->scheduledCount.load(memory_order_relaxed);
+	statistics.rejected = this->rejectedCount.load(memory_order_relaxed);
+	statistics.cancelled = this->cancelledCount.load(memory_order_relaxed);
+	statistics.fired = this->firedCount.load(memory_order_relaxed);
+	statistics.stores = this->storeCount.load(memory_order_relaxed);
+	statistics.wakeups = this->wakeupCount.load(memory_order_relaxed);
+
+	return statistics;
+}
+
+/*
+ * Description:
+ *	Get the distribution of the lateness of the fired changes: the time from the
+ *	deadline of a change to the end of the store that wrote it.
+ *
+ * Return
+ * 	A copy of the lateness histogram, in ns
+ */
+HistogramSnapshot OutputScheduler::getLateness(void) const
+{
+	HistogramSnapshot snapshot;
+	snapshot.add(this->lateness);
+
+	return snapshot;
+}
+
+/*
+ * Description:
+ *	Get the lateness of the first fired changes, in the order they fired, up to the
+ *	latenessLogEvents given to the constructor.
+ *
+ * Return
+ * 	A copy of the log, in ns (saturated at UINT32_MAX). It is copied under the lock
+ * 	the thread appends with, so it can be read while the scheduler runs.
+ */
+vector<uint32_t> OutputScheduler::getLatenessLog(void) const
+{
+	lock_guard<mutex> lock(this->wheelMutex);
+
+	return this->latenessLog;
+}
+
+/*
+ * Take a free timer, fill it in and put it in the wheel.
+ */
+uint64_t OutputScheduler::add(const unsigned int GPIO_PIN, const GpioBase::VALUE GPIO_VALUE, const uint64_t DEADLINE_NS, const uint64_t PERIOD_NS,
+							  const uint64_t HIGH_NS, const uint64_t COUNT)
+{
+	if(GPIO_PIN >= GPIO_COUNT)
+	{
+		cout << "ERROR: OutputScheduler - GPIO " << GPIO_PIN << " does not exist" << endl;
+		return INVALID_HANDLE;
+	}
+
+	const PinDescriptor &PIN = getPinDescriptor(GPIO_PIN);
+
+	lock_guard<mutex> lock(this->wheelMutex);
+
+	if(this->freeList == NONE)
+	{
+		this->rejectedCount.fetch_add(1, memory_order_relaxed);
+		cout << "ERROR: OutputScheduler - All " << this->timers.size() << " timers are in use" << endl;
+		return INVALID_HANDLE;
+	}
+
+	const int32_t INDEX = this->freeList;
+	Timer &timer = this->timers[INDEX];
+	this->freeList = timer.next;
+
+	timer.deadlineNs = DEADLINE_NS;
+	timer.expiryTick = getExpiryTick(DEADLINE_NS);
+	timer.periodStartNs = DEADLINE_NS;
+	timer.periodNs = PERIOD_NS;
+	timer.highNs = HIGH_NS;
+	timer.remaining = COUNT;
+	timer.bank = PIN.bank;
+	timer.mask = PIN.mask;
+	timer.value = GPIO_VALUE;
+
+	insert(INDEX);
+	this->pendingCount.fetch_add(1, memory_order_relaxed);
+	this->scheduledCount.fetch_add(1, memory_order_relaxed);
+
+	updateTimer();
+
+	return ((uint64_t)timer.generation << 32) | (uint64_t)(INDEX + 1);
+}
+
+/*
+ * The thread: sleep until the timerfd expires, then fire every tick up to now.
+ */
+void OutputScheduler::run(const int CPU)
+{
+	ScopedCpuAffinity affinity(CPU);
+
+	while(this->running.load(memory_order_acquire))
+	{
+		uint64_t expirations = 0;
+
+		if(read(this->timerFileDescriptor, &expirations, sizeof(expirations)) != (ssize_t)sizeof(expirations))
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+
+			perror("OutputScheduler::run - Failed to read the timer: read()");
+			break;
+		}
+
+		this->wakeupCount.fetch_add(1, memory_order_relaxed);
+
+		lock_guard<mutex> lock(this->wheelMutex);
+
+		//The timer is one-shot, it is no longer set
+		this->armedTick = DISARMED;
+
+		advance((monotonicTimeNs() - this->originNs) / this->tickNs);
+		updateTimer();
+	}
+}
+
+/*
+ * Fire every tick from currentTick to LAST_TICK, cascading the higher levels on
+ * the way. Runs of empty level 0 slots are skipped using the occupancy bitmap.
+ */
+void OutputScheduler::advance(const uint64_t LAST_TICK)
+{
+	while(this->currentTick <= LAST_TICK)
+	{
+		if(this->pendingCount.load(memory_order_relaxed) == 0)
+		{
+			this->currentTick = LAST_TICK + 1;
+			break;
+		}
+
+		//Cascade from the top, so a change moved down two levels is moved again here
+		if((this->currentTick & (SLOTS - 1)) == 0)
+		{
+			for(unsigned int level = LEVELS - 1; level > 0; --level)
+			{
+				if((this->currentTick & ((1ULL << (SLOT_BITS * level)) - 1)) == 0)
+				{
+					cascade(level);
+				}
+			}
+		}
+
+		const unsigned int SLOT = (unsigned int)(this->currentTick & (SLOTS - 1));
+		const uint64_t BLOCK_END = (this->currentTick | (SLOTS - 1)) + 1;
+
+		//Slots before SLOT hold the changes of the next block, so only look up to the end of this one
+		const uint64_t BITS = this->occupied[0] >> SLOT;
+
+		if(BITS == 0)
+		{
+			this->currentTick = min(BLOCK_END, LAST_TICK + 1);
+			continue;
+		}
+
+		const uint64_t TICK = this->currentTick + (uint64_t)__builtin_ctzll(BITS);
+
+		if(TICK > LAST_TICK)
+		{
+			this->currentTick = LAST_TICK + 1;
+			break;
+		}
+
+		this->currentTick = TICK;
+		fireTick((int32_t)(TICK & (SLOTS - 1)));
+		this->currentTick = TICK + 1;
+	}
+}
+
+/*
+ * Write the changes of a level 0 slot: fold them into one set and one clear mask
+ * per bank, in deadline order so the later change of a pin wins, store the masks,
+ * then record the lateness of every change and put the pulse trains back.
+ */
+void OutputScheduler::fireTick(const int32_t LIST)
+{
+	this->due.clear();
+
+	for(int32_t index = this->heads[LIST]; index != NONE; index = this->timers[index].next)
+	{
+		this->due.push_back(index);
+		this->timers[index].list = NONE;
+	}
+
+	this->heads[LIST] = NONE;
+	this->occupied[0] &= ~(1ULL << LIST);
+
+	sort(this->due.begin(), this->due.end(), [this](const int32_t A, const int32_t B)
+	{
+		const uint64_t DEADLINE_A = this->timers[A].deadlineNs;
+		const uint64_t DEADLINE_B = this->timers[B].deadlineNs;
+
+		return (DEADLINE_A != DEADLINE_B) ? (DEADLINE_A < DEADLINE_B) : (A < B);
+	});
+
+	uint32_t setMasks[GPIO_BANKS] = {};
+	uint32_t clearMasks[GPIO_BANKS] = {};
+
+	for(const int32_t INDEX : this->due)
+	{
+		const Timer &TIMER = this->timers[INDEX];
+		const unsigned int BANK_INDEX = (unsigned int)TIMER.bank;
+
+		if(TIMER.value == GpioBase::VALUE::HIGH)
+		{
+			setMasks[BANK_INDEX] |= TIMER.mask;
+			clearMasks[BANK_INDEX] &= ~TIMER.mask;
+		}
+		else
+		{
+			clearMasks[BANK_INDEX] |= TIMER.mask;
+			setMasks[BANK_INDEX] &= ~TIMER.mask;
+		}
+	}
+
+	uint64_t stores = 0;
+
+	for(unsigned int bank = 0; bank < GPIO_BANKS; ++bank)
+	{
+		if(setMasks[bank] != 0)
+		{
+			this->memmap.write((MemMap::BANK)bank, GPIO_SETDATAOUT_OFFSET, setMasks[bank]);
+			stores++;
+		}
+
+		if(clearMasks[bank] != 0)
+		{
+			this->memmap.write((MemMap::BANK)bank, GPIO_CLEARDATAOUT_OFFSET, clearMasks[bank]);
+			stores++;
+		}
+	}
+
+	const uint64_t WRITTEN_NS = monotonicTimeNs();
+
+	this->storeCount.fetch_add(stores, memory_order_relaxed);
+	this->firedCount.fetch_add(this->due.size(), memory_order_relaxed);
+
+	for(const int32_t INDEX : this->due)
+	{
+		Timer &timer = this->timers[INDEX];
+		const uint64_t LATENESS = (WRITTEN_NS > timer.deadlineNs) ? WRITTEN_NS - timer.deadlineNs : 0;
+
+		this->lateness.record(LATENESS);
+
+		if(this->latenessLog.size() < this->latenessLogEvents)
+		{
+			this->latenessLog.push_back((uint32_t)min<uint64_t>(LATENESS, UINT32_MAX));
+		}
+
+		if(timer.periodNs == 0)
+		{
+			release(INDEX);
+			continue;
+		}
+
+		if(timer.value == GpioBase::VALUE::HIGH)
+		{
+			timer.value = GpioBase::VALUE::LOW;
+			timer.deadlineNs = timer.periodStartNs + timer.highNs;
+		}
+		else
+		{
+			if(timer.remaining != 0 && --timer.remaining == 0)
+			{
+				release(INDEX);
+				continue;
+			}
+
+			timer.value = GpioBase::VALUE::HIGH;
+			timer.periodStartNs += timer.periodNs;
+			timer.deadlineNs = timer.periodStartNs;
+		}
+
+		//A train whose period is shorter than a tick falls behind rather than firing twice in one
+		timer.expiryTick = max(getExpiryTick(timer.deadlineNs), this->currentTick + 1);
+		insert(INDEX);
+	}
+}
+
+/*
+ * Move the timers of the level's slot for the current block down the wheel.
+ */
+void OutputScheduler::cascade(const unsigned int LEVEL)
+{
+	const unsigned int SLOT = (unsigned int)((this->currentTick >> (SLOT_BITS * LEVEL)) & (SLOTS - 1));
+	const int32_t LIST = (int32_t)(LEVEL * SLOTS + SLOT);
+
+	int32_t index = this->heads[LIST];
+
+	this->heads[LIST] = NONE;
+	this->occupied[LEVEL] &= ~(1ULL << SLOT);
+
+	while(index != NONE)
+	{
+		const int32_t NEXT = this->timers[index].next;
+
+		insert(index);
+		index = NEXT;
+	}
+}
+
+/*
+ * Get the first tick that starts at or after a deadline.
+ */
+uint64_t OutputScheduler::getExpiryTick(const uint64_t DEADLINE_NS) const
+{
+	if(DEADLINE_NS <= this->originNs)
+	{
+		return 0;
+	}
+
+	return (DEADLINE_NS - this->originNs + this->tickNs - 1) / this->tickNs;
+}
+
+/*
+ * Link a timer into the slot of its expiry tick: the lowest level whose span,
+ * counted from the current tick, reaches it. A timer beyond the span of the top
+ * level is put in its last slot and put back in again when that slot is cascaded.
+ */
+void OutputScheduler::insert(const int32_t INDEX)
+{
+	Timer &timer = this->timers[INDEX];
+
+	const uint64_t TOP_SPAN = 1ULL << (SLOT_BITS * LEVELS);
+	uint64_t expiry = max(timer.expiryTick, this->currentTick);
+
+	if(expiry - this->currentTick >= TOP_SPAN)
+	{
+		expiry = this->currentTick + TOP_SPAN - 1;
+	}
+
+	const uint64_t DELTA = expiry - this->currentTick;
+
+	unsigned int level = 0;
+	while(level < LEVELS - 1 && DELTA >= (1ULL << (SLOT_BITS * (level + 1))))
+	{
+		level++;
+	}
+
+	const unsigned int SLOT = (unsigned int)((expiry >> (SLOT_BITS * level)) & (SLOTS - 1));
+	const int32_t LIST = (int32_t)(level * SLOTS + SLOT);
+
+	timer.list = LIST;
+	timer.previous = NONE;
+	timer.next = this->heads[LIST];
+
+	if(timer.next != NONE)
+	{
+		this->timers[timer.next].previous = INDEX;
+	}
+
+	this->heads[LIST] = INDEX;
+	this->occupied[level] |= 1ULL << SLOT;
+}
+
+void OutputScheduler::unlink(const int32_t INDEX)
+{
+	Timer &timer = this->timers[INDEX];
+
+	if(timer.previous != NONE)
+	{
+		this->timers[timer.previous].next = timer.next;
+	}
+	else
+	{
+		this->heads[timer.list] = timer.next;
+	}
+
+	if(timer.next != NONE)
+	{
+		this->timers[timer.next].previous = timer.previous;
+	}
+
+	if(this->heads[timer.list] == NONE)
+	{
+		this->occupied[timer.list / SLOTS] &= ~(1ULL << (timer.list % SLOTS));
+	}
+
+	timer.list = NONE;
+}
+
+/*
+ * Put a timer that is in no list back on the free list.
+ */
+void OutputScheduler::release(const int32_t INDEX)
+{
+	Timer &timer = this->timers[INDEX];
+
+	timer.generation++;
+	timer.list = NONE;
+	timer.next = this->freeList;
+	this->freeList = INDEX;
+
+	this->pendingCount.fetch_sub(1, memory_order_relaxed);
+}
+
+/*
+ * Get the next tick with something to do: the next occupied slot of level 0, or
+ * the next cascade of an occupied slot of a higher level, whichever comes first.
+ */
+uint64_t OutputScheduler::getNextTick(void) const
+{
+	uint64_t next = DISARMED;
+
+	if(this->occupied[0] != 0)
+	{
+		next = this->currentTick + getNextSetBit(this->occupied[0], (unsigned int)(this->currentTick & (SLOTS - 1)));
+	}
+
+	for(unsigned int level = 1; level < LEVELS; ++level)
+	{
+		if(this->occupied[level] == 0)
+		{
+			continue;
+		}
+
+		//The slot of the current block is cascaded when currentTick starts it, so past the start look from the next block
+		const uint64_t SPAN = 1ULL << (SLOT_BITS * level);
+		const uint64_t BLOCK = (this->currentTick + SPAN - 1) >> (SLOT_BITS * level);
+		const uint64_t CASCADE_BLOCK = BLOCK + getNextSetBit(this->occupied[level], (unsigned int)(BLOCK & (SLOTS - 1)));
+
+		next = min(next, CASCADE_BLOCK << (SLOT_BITS * level));
+	}
+
+	return next;
+}
+
+/*
+ * Set the timerfd to the next tick with something to do, if it changed.
+ */
+void OutputScheduler::updateTimer(void)
+{
+	const uint64_t NEXT_TICK = getNextTick();
+
+	if(NEXT_TICK == this->armedTick)
+	{
+		return;
+	}
+
+	armTimer((NEXT_TICK == DISARMED) ? 0 : this->originNs + NEXT_TICK * this->tickNs);
+	this->armedTick = NEXT_TICK;
+}
+
+/*
+ * Set the timerfd to an absolute CLOCK_MONOTONIC time, or disarm it with 0.
+ */
+void OutputScheduler::armTimer(const uint64_t DEADLINE_NS)
+{
+	struct itimerspec timer = {};
+	timer.it_value.tv_sec = (time_t)(DEADLINE_NS / 1000000000ULL);
+	timer.it_value.tv_nsec = (long)(DEADLINE_NS % 1000000000ULL);
+
+	if(timerfd_settime(this->timerFileDescriptor, TFD_TIMER_ABSTIME, &timer, nullptr) == -1)
+	{
+		perror("OutputScheduler - Failed to set the timer: timerfd_settime()");
+	}
+}
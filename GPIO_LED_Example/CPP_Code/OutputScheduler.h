@@ -0,0 +1,140 @@
+#ifndef H_OUTPUT_SCHEDULER_H_
+#define H_OUTPUT_SCHEDULER_H_
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "GpioBase.h"
+#include "MemMap.h"
+#include "EdgeStatistics.h"
+
+/*
+ * Output changes at absolute deadlines, for any number of pins, from one thread:
+ * schedule() changes a pin once, schedulePeriodic() drives a pulse train.
+ *
+ * Pending changes are kept in a hierarchical timing wheel of LEVELS levels of 64
+ * slots: level 0 holds the changes due in the next 64 ticks, one slot per tick, and
+ * every level above covers 64 times the span of the one below. Scheduling and
+ * cancelling are O(1) whatever the number of pending changes, and a change is
+ * moved down a level at most LEVELS - 1 times before it fires.
+ *
+ * The thread sleeps on a timerfd armed for the next tick with something to do (an
+ * occupancy bitmap per level finds it), so it costs nothing while nothing is due.
+ * All the changes due in the same tick are written together: one SETDATAOUT and
+ * one CLEARDATAOUT store per bank. When two changes of a pin fall in the same tick,
+ * the later one wins. Changes never fire early, and up to one tick late plus the
+ * wakeup latency of the thread. The lateness of every change is recorded.
+ *
+ * The pins must already be muxed and set as outputs. All the methods can be called
+ * from any thread.
+ */
+class OutputScheduler
+{
+public:
+	static const unsigned int LEVELS = 5;
+	static const unsigned int SLOT_BITS = 6;
+	static const unsigned int SLOTS = 1U << SLOT_BITS;
+
+	/* Returned when a change could not be scheduled */
+	static const uint64_t INVALID_HANDLE = 0;
+
+	struct Statistics
+	{
+		uint64_t scheduled;   //Changes accepted by schedule() and schedulePeriodic()
+		uint64_t rejected;    //Changes refused because every timer was in use
+		uint64_t cancelled;
+		uint64_t fired;       //Pin changes written, a periodic pulse counts two
+		uint64_t stores;      //SETDATAOUT/CLEARDATAOUT stores issued for them
+		uint64_t wakeups;     //Times the timerfd woke the thread up
+	};
+
+	OutputScheduler(MemMap &memmap, uint64_t tickNs = 100000, size_t capacity = 4096, size_t latenessLogEvents = 0);
+	~OutputScheduler();
+
+	OutputScheduler(const OutputScheduler &) = delete;
+	OutputScheduler &operator=(const OutputScheduler &) = delete;
+
+	bool start(const int CPU = -1);
+	void stop(void);
+
+	uint64_t schedule(const unsigned int GPIO_PIN, const GpioBase::VALUE GPIO_VALUE, const uint64_t DEADLINE_NS);
+	uint64_t schedulePeriodic(const unsigned int GPIO_PIN, const uint64_t FIRST_DEADLINE_NS, const uint64_t PERIOD_NS,
+							  const uint64_t HIGH_NS, const uint64_t COUNT = 0);
+	bool cancel(const uint64_t HANDLE);
+
+	size_t getPendingCount(void) const { return pendingCount.load(memory_order_relaxed); }
+	uint64_t getTickNs(void) const { return tickNs; }
+
+	Statistics getStatistics(void) const;
+	HistogramSnapshot getLateness(void) const;
+	vector<uint32_t> getLatenessLog(void) const;
+
+private:
+	static constexpr int32_t NONE = -1;
+
+	struct Timer
+	{
+		uint64_t deadlineNs;    //When the next change is due
+		uint64_t expiryTick;    //The first tick at or after deadlineNs
+		uint64_t periodStartNs; //Periodic: when the current pulse started
+		uint64_t periodNs;      //0 for a single change
+		uint64_t highNs;        //Periodic: how long the pin is HIGH in every period
+		uint64_t remaining;     //Periodic: pulses left, 0 for no limit
+		MemMap::BANK bank;
+		uint32_t mask;
+		GpioBase::VALUE value;  //The change due at deadlineNs
+		uint32_t generation;    //Incremented whenever the timer is freed, so stale handles are ignored
+		int32_t next;           //In the slot list, or the free list
+		int32_t previous;
+		int32_t list;           //level * SLOTS + slot of the list the timer is in, NONE when free
+	};
+
+	MemMap &memmap;
+	uint64_t tickNs;
+	uint64_t originNs;      //Time of tick 0
+	int timerFileDescriptor;
+
+	mutable mutex wheelMutex; //Held by the thread while it fires a tick, and to schedule or cancel
+	vector<Timer> timers;     //Preallocated, linked into the wheel or the free list
+	int32_t freeList;
+	int32_t heads[LEVELS * SLOTS];
+	uint64_t occupied[LEVELS]; //Bit s is set when slot s of the level holds timers
+	uint64_t currentTick;     //The next tick to fire
+	uint64_t armedTick;       //What the timerfd is set to, UINT64_MAX when disarmed
+	vector<int32_t> due;      //The timers of the tick being fired, preallocated
+
+	atomic<size_t> pendingCount;
+	atomic<bool> running;
+	thread worker;
+
+	atomic<uint64_t> scheduledCount;
+	atomic<uint64_t> rejectedCount;
+	atomic<uint64_t> cancelledCount;
+	atomic<uint64_t> firedCount;
+	atomic<uint64_t> storeCount;
+	atomic<uint64_t> wakeupCount;
+	LatencyHistogram lateness;    //Only written by the thread
+	vector<uint32_t> latenessLog; //Lateness of the first latenessLogEvents changes, preallocated, guarded by wheelMutex
+	size_t latenessLogEvents;
+
+	uint64_t add(const unsigned int GPIO_PIN, const GpioBase::VALUE GPIO_VALUE, const uint64_t DEADLINE_NS, const uint64_t PERIOD_NS,
+				 const uint64_t HIGH_NS, const uint64_t COUNT);
+	void run(const int CPU);
+	void advance(const uint64_t LAST_TICK);
+	void fireTick(const int32_t LIST);
+	void cascade(const unsigned int LEVEL);
+
+	uint64_t getExpiryTick(const uint64_t DEADLINE_NS) const;
+	void insert(const int32_t INDEX);
+	void unlink(const int32_t INDEX);
+	void release(const int32_t INDEX);
+	uint64_t getNextTick(void) const;
+	void updateTimer(void);
+	void armTimer(const uint64_t DEADLINE_NS);
+};
+
+#endif /* H_OUTPUT_SCHEDULER_H_ */
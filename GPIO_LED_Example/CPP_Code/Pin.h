@@ -0,0 +1,67 @@
+#ifndef H_PIN_H_
+#define H_PIN_H_
+
+#include <stdint.h>
+
+#include "GpioBase.h"
+#include "MemMap.h"
+#include "PinTable.h"
+
+/*
+ * Register-level access to a single GPIO chosen at compile time, e.g. Pin<49> or
+ * Pin<"p9.23"_pin>. Invalid pins are rejected by the compiler, and the bank and
+ * bit mask are constants, so setValue() compiles down to one store of an
+ * immediate into SETDATAOUT or CLEARDATAOUT.
+ */
+template<unsigned int GPIO_NUMBER>
+class Pin
+{
+	static_assert(GPIO_NUMBER < GPIO_COUNT, "Pin: invalid GPIO, it must be 0 - 127 or a known header pin such as \"p9.23\"_pin");
+
+public:
+	static constexpr unsigned int NUMBER = GPIO_NUMBER;
+	static constexpr MemMap::BANK BANK = getPinDescriptor(GPIO_NUMBER).bank;
+	static constexpr uint32_t MASK = getPinDescriptor(GPIO_NUMBER).mask;
+	static constexpr ulong BANK_ADDRESS = getPinDescriptor(GPIO_NUMBER).bankAddress;
+	static constexpr const char *HEADER_NAME = getPinDescriptor(GPIO_NUMBER).headerName;
+
+	explicit Pin(MemMap &memmap, GpioBase::DIRECTION direction = GpioBase::DIRECTION::OUTPUT) : memmap(memmap)
+	{
+		setDirection(direction);
+	}
+
+	/*
+	 * Description:
+	 *	Updates the direction of the pin through the bank's OE register (cleared bit = output).
+	 */
+	void setDirection(const GpioBase::DIRECTION GPIO_DIRECTION)
+	{
+		MemMap::Transaction transaction(memmap);
+
+		if(GPIO_DIRECTION == GpioBase::DIRECTION::OUTPUT)
+		{
+			transaction.setOutput(BANK, MASK);
+		}
+		else
+		{
+			transaction.setInput(BANK, MASK);
+		}
+
+		transaction.commit();
+	}
+
+	inline void setValue(const GpioBase::VALUE GPIO_VALUE)
+	{
+		memmap.write(BANK, (GPIO_VALUE == GpioBase::VALUE::HIGH) ? GPIO_SETDATAOUT_OFFSET : GPIO_CLEARDATAOUT_OFFSET, MASK);
+	}
+
+	inline GpioBase::VALUE getValue(void) const
+	{
+		return (memmap.read(BANK, GPIO_DATAIN_OFFSET) & MASK) ? GpioBase::VALUE::HIGH : GpioBase::VALUE::LOW;
+	}
+
+private:
+	MemMap &memmap;
+};
+
+#endif /* H_PIN_H_ */
@@ -0,0 +1,118 @@
+/*
+ * This program measures how long it takes to configure 1, 16 and 64 pins as GPIOs.
+ * It compares forking a command per pin (what calling config-pin through system()
+ * costs at the very least, before config-pin itself runs) with GpioBase::configureAll(),
+ * both on pins that still need configuring and on pins that already are.
+ *
+ * It runs against a fake sysfs tree in /tmp, so no hardware is needed.
+ */
+
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "GpioBase.h"
+#include "PinTable.h"
+
+using namespace std;
+
+static const string FAKE_ROOT = "/tmp/pinconfig_bench";
+static const string FAKE_GPIO_PATH = FAKE_ROOT + "/sys/class/gpio/";
+static const string FAKE_PINMUX_PATH = FAKE_ROOT + "/sys/devices/platform/ocp/";
+
+static void writeFile(const string &path, const string &contents)
+{
+	int fileDescriptor = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+	if(fileDescriptor == -1 || write(fileDescriptor, contents.c_str(), contents.size()) != (ssize_t)contents.size())
+	{
+		perror(("PinConfigBench - Failed to write " + path).c_str());
+	}
+
+	close(fileDescriptor);
+}
+
+/*
+ * Description:
+ * 	Build the fake tree: an export file, and a pinmux helper per header pin left in
+ * 	its "default" state. If exported is true the gpio<N> directories exist and the
+ * 	pins are already muxed as GPIOs.
+ */
+static void createFakeTree(const bool EXPORTED)
+{
+	system(("rm -rf " + FAKE_ROOT).c_str());
+	system(("mkdir -p " + FAKE_GPIO_PATH + " " + FAKE_PINMUX_PATH).c_str());
+
+	writeFile(FAKE_GPIO_PATH + "export", "");
+
+	for(size_t index = 0; index < HEADER_PIN_COUNT; ++index)
+	{
+		const char *name = HEADER_PINS[index].name;
+		const string PINMUX_DIRECTORY = FAKE_PINMUX_PATH + "ocp:P" + name[1] + "_" + &name[3] + "_pinmux";
+
+		mkdir(PINMUX_DIRECTORY.c_str(), 0755);
+		writeFile(PINMUX_DIRECTORY + "/state", EXPORTED ? "gpio\n" : "default\n");
+
+		if(EXPORTED)
+		{
+			mkdir((FAKE_GPIO_PATH + "gpio" + to_string(HEADER_PINS[index].gpio)).c_str(), 0755);
+		}
+	}
+}
+
+template<typename CONFIGURE>
+static void report(const string &name, const unsigned int PINS, CONFIGURE configure)
+{
+	auto start = chrono::steady_clock::now();
+	configure();
+	chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+
+	cout << name << " (" << PINS << " pins): " << elapsed.count() << " ms ("
+		 << (elapsed.count() * 1000.0 / PINS) << " us/pin)" << endl;
+}
+
+int main()
+{
+	const unsigned int PIN_COUNTS[] = {1, 16, 64};
+
+	GpioBase::setGpioPath(FAKE_GPIO_PATH);
+	GpioBase::setPinmuxPath(FAKE_PINMUX_PATH);
+
+	for(unsigned int pinCount : PIN_COUNTS)
+	{
+		vector<unsigned int> pins;
+
+		for(unsigned int index = 0; index < pinCount && index < HEADER_PIN_COUNT; ++index)
+		{
+			pins.push_back(HEADER_PINS[index].gpio);
+		}
+
+		report("fork + exec per pin (before)", pinCount, [&]()
+		{
+			for(size_t index = 0; index < pins.size(); ++index)
+			{
+				system("true");
+			}
+		});
+
+		createFakeTree(false);
+		report("GpioBase::configureAll, unconfigured", pinCount, [&]()
+		{
+			GpioBase::configureAll(pins);
+		});
+
+		createFakeTree(true);
+		report("GpioBase::configureAll, already configured", pinCount, [&]()
+		{
+			GpioBase::configureAll(pins);
+		});
+	}
+
+	system(("rm -rf " + FAKE_ROOT).c_str());
+
+	return 0;
+}
@@ -0,0 +1,130 @@
+#include "PinGroup.h"
+#include "PinTable.h"
+
+/*
+ * Description:
+ * 	Group the pins by bank, configure them as outputs and build the lookup table
+ * 	used by write().
+ *
+ * Args:
+ * 	memmap The mapped GPIO banks the pins belong to
+ * 	gpioPins The GPIO numbers of the pins, bit i of the value drives gpioPins[i]
+ */
+PinGroup::PinGroup(MemMap &memmap, const vector<unsigned int> &gpioPins) : memmap(memmap), pinCount(0), valueBytes(0)
+{
+	bankMasks.fill(0);
+
+	//Bit i of the value, translated to a bank and a bit within that bank
+	std::array<uint32_t, MAX_PINS> pinMasks;
+	std::array<unsigned int, MAX_PINS> pinBanks;
+
+	for(unsigned int gpioPin : gpioPins)
+	{
+		if(this->pinCount == MAX_PINS)
+		{
+			cout << "ERROR: PinGroup - A group holds at most " << MAX_PINS << " pins, ignoring GPIO " << gpioPin << endl;
+			continue;
+		}
+
+		if(gpioPin >= GPIO_COUNT)
+		{
+			cout << "ERROR: PinGroup - GPIO " << gpioPin << " does not exist" << endl;
+			pinMasks[this->pinCount] = 0;
+			pinBanks[this->pinCount] = 0;
+		}
+		else
+		{
+			const PinDescriptor &PIN = getPinDescriptor(gpioPin);
+
+			pinBanks[this->pinCount] = (unsigned int)PIN.bank;
+			pinMasks[this->pinCount] = PIN.mask;
+			this->bankMasks[(unsigned int)PIN.bank] |= PIN.mask;
+		}
+
+		this->pinCount++;
+	}
+
+	this->valueBytes = (this->pinCount + 7) / 8;
+	this->scatterTable.resize(this->valueBytes * BYTE_VALUES);
+
+	for(unsigned int byte = 0; byte < this->valueBytes; ++byte)
+	{
+		for(unsigned int byteValue = 0; byteValue < BYTE_VALUES; ++byteValue)
+		{
+			std::array<uint32_t, GPIO_BANKS> &entry = this->scatterTable[byte * BYTE_VALUES + byteValue];
+			entry.fill(0);
+
+			for(unsigned int bit = 0; bit < 8; ++bit)
+			{
+				const unsigned int PIN = byte * 8 + bit;
+
+				if(PIN < this->pinCount && (byteValue & (1U << bit)))
+				{
+					entry[pinBanks[PIN]] |= pinMasks[PIN];
+				}
+			}
+		}
+	}
+
+	//Every pin of the group becomes an output, with at most one OE store per bank
+	MemMap::Transaction outputs(this->memmap);
+
+	for(unsigned int bank = 0; bank < GPIO_BANKS; ++bank)
+	{
+		if(this->bankMasks[bank] != 0)
+		{
+			this->usedBanks.push_back((MemMap::BANK)bank);
+			outputs.setOutput((MemMap::BANK)bank, this->bankMasks[bank]);
+		}
+	}
+
+	outputs.commit();
+}
+
+/*
+ * Description:
+ *	Update every pin of the group at once.
+ *
+ * Args:
+ *	VALUE Bit i is the new value of the i-th pin of the group
+ *
+ * Return
+ * 	None
+ */
+void PinGroup::write(const uint32_t VALUE)
+{
+	uint32_t setMasks[GPIO_BANKS] = {0, 0, 0, 0};
+
+	for(unsigned int byte = 0; byte < this->valueBytes; ++byte)
+	{
+		const std::array<uint32_t, GPIO_BANKS> &entry = this->scatterTable[byte * BYTE_VALUES + ((VALUE >> (byte * 8)) & 0xFF)];
+
+		for(unsigned int bank = 0; bank < GPIO_BANKS; ++bank)
+		{
+			setMasks[bank] |= entry[bank];
+		}
+	}
+
+	for(MemMap::BANK bank : this->usedBanks)
+	{
+		const uint32_t SET_MASK = setMasks[(unsigned int)bank];
+		const uint32_t CLEAR_MASK = this->bankMasks[(unsigned int)bank] & ~SET_MASK;
+
+		if(SET_MASK != 0)
+		{
+			this->memmap.write(bank, GPIO_SETDATAOUT_OFFSET, SET_MASK);
+		}
+
+		if(CLEAR_MASK != 0)
+		{
+			this->memmap.write(bank, GPIO_CLEARDATAOUT_OFFSET, CLEAR_MASK);
+		}
+	}
+}
+
+/*
+ * Destructor
+ */
+PinGroup::~PinGroup()
+{
+}
@@ -0,0 +1,45 @@
+#ifndef H_PIN_GROUP_H_
+#define H_PIN_GROUP_H_
+
+#include <array>
+#include <vector>
+#include <stdint.h>
+
+#include "MemMap.h"
+
+/*
+ * Drives a set of GPIO outputs as a parallel bus. Bit i of the value written to
+ * the group drives the i-th pin given to the constructor.
+ *
+ * The pins are grouped by bank (see PinTable.h) and a lookup table
+ * translating every byte of the value into per-bank bit masks is built up front.
+ * A write is then a handful of table lookups followed by one SETDATAOUT and one
+ * CLEARDATAOUT store per bank used, so all pins of a bank change together.
+ */
+class PinGroup
+{
+public:
+	static const unsigned int MAX_PINS = 32;
+
+	PinGroup(MemMap &memmap, const vector<unsigned int> &gpioPins);
+	~PinGroup();
+
+	void write(const uint32_t VALUE);
+
+	unsigned int size(void) const { return pinCount; }
+	uint32_t getBankMask(const MemMap::BANK GPIO_BANK) const { return bankMasks[(unsigned int)GPIO_BANK]; }
+
+private:
+	static const unsigned int BYTE_VALUES = 256;
+
+	MemMap &memmap;
+	unsigned int pinCount;
+	unsigned int valueBytes; //The number of bytes of the value that drive a pin
+	std::array<uint32_t, GPIO_BANKS> bankMasks; //Every pin of the group, per bank
+	vector<MemMap::BANK> usedBanks;
+
+	//scatterTable[byte * BYTE_VALUES + byteValue][bank]: the bank bits set by that byte of the value
+	vector<std::array<uint32_t, GPIO_BANKS>> scatterTable;
+};
+
+#endif /* H_PIN_GROUP_H_ */
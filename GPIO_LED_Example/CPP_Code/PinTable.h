@@ -0,0 +1,248 @@
+#ifndef H_PIN_TABLE_H_
+#define H_PIN_TABLE_H_
+
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "MemMap.h"
+
+/*
+ * Compile-time description of every GPIO of the AM335x (GPIO0_0 - GPIO3_31),
+ * indexed directly by GPIO number. Looking a pin up is a single array access, and
+ * when the GPIO number is a constant the compiler folds the lookup away entirely.
+ */
+
+/* The number of GPIOs: 4 banks of 32 */
+constexpr unsigned int GPIO_COUNT = GPIO_BANKS * 32;
+
+/* Returned by findPin() when a header name is unknown */
+constexpr unsigned int INVALID_GPIO = GPIO_COUNT;
+
+struct PinDescriptor
+{
+	const char *headerName; //Physical header pin, e.g. "p9.23" (nullptr if not broken out on P8/P9)
+	MemMap::BANK bank;      //gpio / 32
+	uint32_t mask;          //1 << (gpio % 32)
+	ulong bankAddress;      //GPIOx_MEM_MAP_ADDR of the bank
+};
+
+struct HeaderPin
+{
+	unsigned int gpio;
+	const char *name;
+};
+
+/* This array is organized in the following format:
+   Column 1: GPIO_#
+   Column 2: Physical header pin number
+ */
+constexpr HeaderPin HEADER_PINS[] = {
+	/*GPIO pins on header P8*/
+	{38 , "p8.3"},
+	{39 , "p8.4"},
+	{34 , "p8.5"},
+	{35 , "p8.6"},
+	{66 , "p8.7"},
+	{67 , "p8.8"},
+	{69 , "p8.9"},
+	{68 , "p8.10"},
+	{45 , "p8.11"},
+	{44 , "p8.12"},
+	{23 , "p8.13"},
+	{26 , "p8.14"},
+	{47 , "p8.15"},
+	{46 , "p8.16"},
+	{27 , "p8.17"},
+	{65 , "p8.18"},
+	{22 , "p8.19"},
+	{63 , "p8.20"},
+	{62 , "p8.21"},
+	{37 , "p8.22"},
+	{36 , "p8.23"},
+	{33 , "p8.24"},
+	{32 , "p8.25"},
+	{61 , "p8.26"},
+	{86 , "p8.27"},
+	{88 , "p8.28"},
+	{87 , "p8.29"},
+	{89 , "p8.30"},
+	{10 , "p8.31"},
+	{11 , "p8.32"},
+	{9  , "p8.33"},
+	{81 , "p8.34"},
+	{8  , "p8.35"},
+	{80 , "p8.36"},
+	{78 , "p8.37"},
+	{79 , "p8.38"},
+	{76 , "p8.39"},
+	{77 , "p8.40"},
+	{74 , "p8.41"},
+	{75 , "p8.42"},
+	{72 , "p8.43"},
+	{73 , "p8.44"},
+	{70 , "p8.45"},
+	{71 , "p8.46"},
+
+	/*GPIO pins on header P9*/
+	{30 , "p9.11"},
+	{60 , "p9.12"},
+	{31 , "p9.13"},
+	{40 , "p9.14"},
+	{48 , "p9.15"},
+	{51 , "p9.16"},
+	{4  , "p9.17"},
+	{5  , "p9.18"},
+	{3  , "p9.21"},
+	{2  , "p9.22"},
+	{49 , "p9.23"},
+	{15 , "p9.24"},
+	{117, "p9.25"},
+	{14 , "p9.26"},
+	{115, "p9.27"},
+	{113, "p9.28"},
+	{111, "p9.29"},
+	{112, "p9.30"},
+	{110, "p9.31"},
+	{20 , "p9.41"},
+	{7  , "p9.42"}
+};
+
+constexpr size_t HEADER_PIN_COUNT = sizeof(HEADER_PINS) / sizeof(HEADER_PINS[0]);
+
+/*
+ * Description:
+ * 	Fill in the descriptor of every GPIO, then attach the header names.
+ */
+constexpr std::array<PinDescriptor, GPIO_COUNT> buildPinTable(void)
+{
+	constexpr ulong BANK_ADDRESSES[GPIO_BANKS] = {GPIO0_MEM_MAP_ADDR, GPIO1_MEM_MAP_ADDR, GPIO2_MEM_MAP_ADDR, GPIO3_MEM_MAP_ADDR};
+
+	std::array<PinDescriptor, GPIO_COUNT> table{};
+
+	for(unsigned int gpio = 0; gpio < GPIO_COUNT; ++gpio)
+	{
+		table[gpio] = {nullptr, (MemMap::BANK)(gpio / 32), (1U << (gpio % 32)), BANK_ADDRESSES[gpio / 32]};
+	}
+
+	for(size_t index = 0; index < HEADER_PIN_COUNT; ++index)
+	{
+		table[HEADER_PINS[index].gpio].headerName = HEADER_PINS[index].name;
+	}
+
+	return table;
+}
+
+constexpr std::array<PinDescriptor, GPIO_COUNT> PIN_TABLE = buildPinTable();
+
+/*
+ * Description:
+ * 	Get the descriptor of a GPIO. GPIO must be lower than GPIO_COUNT.
+ */
+constexpr const PinDescriptor &getPinDescriptor(const unsigned int GPIO)
+{
+	return PIN_TABLE[GPIO];
+}
+
+constexpr char toLowerPinCharacter(const char CHARACTER)
+{
+	return (CHARACTER >= 'A' && CHARACTER <= 'Z') ? (char)(CHARACTER - 'A' + 'a') : CHARACTER;
+}
+
+/*
+ * Description:
+ * 	FNV-1a hash of a header name. Letters are hashed as lower case so "P9.23" and
+ * 	"p9.23" are the same pin.
+ */
+constexpr uint32_t hashPinName(const char *name)
+{
+	uint32_t hash = 2166136261U;
+
+	for(; *name != '\0'; ++name)
+	{
+		hash = (hash ^ (uint8_t)toLowerPinCharacter(*name)) * 16777619U;
+	}
+
+	return hash;
+}
+
+constexpr bool pinNamesMatch(const char *name, const char *headerName)
+{
+	for(; *name != '\0' && *headerName != '\0'; ++name, ++headerName)
+	{
+		if(toLowerPinCharacter(*name) != *headerName)
+		{
+			return false;
+		}
+	}
+
+	return *name == *headerName;
+}
+
+/* Open addressing hash table of the header names, holding GPIO numbers (INVALID_GPIO when empty) */
+constexpr unsigned int PIN_NAME_SLOTS = 128;
+
+constexpr std::array<unsigned int, PIN_NAME_SLOTS> buildPinNameTable(void)
+{
+	std::array<unsigned int, PIN_NAME_SLOTS> slots{};
+
+	for(unsigned int slot = 0; slot < PIN_NAME_SLOTS; ++slot)
+	{
+		slots[slot] = INVALID_GPIO;
+	}
+
+	for(size_t index = 0; index < HEADER_PIN_COUNT; ++index)
+	{
+		unsigned int slot = hashPinName(HEADER_PINS[index].name) & (PIN_NAME_SLOTS - 1);
+
+		while(slots[slot] != INVALID_GPIO)
+		{
+			slot = (slot + 1) & (PIN_NAME_SLOTS - 1);
+		}
+
+		slots[slot] = HEADER_PINS[index].gpio;
+	}
+
+	return slots;
+}
+
+constexpr std::array<unsigned int, PIN_NAME_SLOTS> PIN_NAME_TABLE = buildPinNameTable();
+
+/*
+ * Description:
+ * 	Find the GPIO number of a header pin, e.g. findPin("p9.23") == 49. Resolved at
+ * 	compile time when name is a constant.
+ *
+ * Return
+ * 	The GPIO number, or INVALID_GPIO if no GPIO is on that header pin
+ */
+constexpr unsigned int findPin(const char *name)
+{
+	unsigned int slot = hashPinName(name) & (PIN_NAME_SLOTS - 1);
+
+	while(PIN_NAME_TABLE[slot] != INVALID_GPIO)
+	{
+		if(pinNamesMatch(name, PIN_TABLE[PIN_NAME_TABLE[slot]].headerName))
+		{
+			return PIN_NAME_TABLE[slot];
+		}
+
+		slot = (slot + 1) & (PIN_NAME_SLOTS - 1);
+	}
+
+	return INVALID_GPIO;
+}
+
+/*
+ * Description:
+ * 	"p9.23"_pin is the GPIO number on header pin P9.23 (49), or INVALID_GPIO.
+ */
+constexpr unsigned int operator""_pin(const char *name, size_t)
+{
+	return findPin(name);
+}
+
+static_assert("p9.23"_pin == 49 && "P8.46"_pin == 71, "PinTable: header name lookup is broken");
+static_assert(PIN_TABLE[49].bank == MemMap::BANK::GPIO1 && PIN_TABLE[49].mask == (1U << 17), "PinTable: descriptor table is broken");
+
+#endif /* H_PIN_TABLE_H_ */
@@ -0,0 +1,240 @@
+#include <algorithm>
+
+#include "PulseCapture.h"
+
+/*
+ * Description:
+ * 	Start capturing: subscribe to the edges of pin, which must be an input set up
+ * 	for EDGE::BOTH.
+ *
+ * Args:
+ * 	pin The pin to measure. It must outlive the capture.
+ * 	window The number of values of each measurement kept for getStatistics()
+ */
+PulseCapture::PulseCapture(GpioBase &pin, size_t window) : sequence(0), latestTimestampNs(0),
+	latestHighNs(0), latestLowNs(0), latestPeriodNs(0), latestPulseCount(0), hasEdge(false),
+	lastLevel(GpioBase::VALUE::LOW), lastEdgeNs(0), lastRisingNs(0), edgeCount(0), missedEdgeCount(0)
+{
+	if(window == 0)
+	{
+		window = 1;
+	}
+
+	this->high = {vector<uint64_t>(window, 0), 0};
+	this->low = {vector<uint64_t>(window, 0), 0};
+	this->period = {vector<uint64_t>(window, 0), 0};
+
+	if(pin.getEdge() != GpioBase::EDGE::BOTH)
+	{
+		cout << "ERROR: PulseCapture - GPIO " << pin.getPinNumber() << " must detect EDGE::BOTH" << endl;
+		return;
+	}
+
+	this->subscription = pin.triggerOnEdge([this](unsigned int, GpioBase::VALUE level, uint64_t timestampNs)
+	{
+		onEdge(level, timestampNs);
+	});
+}
+
+/*
+ * Destructor. Stops watching the pin before the buffers go away.
+ */
+PulseCapture::~PulseCapture()
+{
+	stop();
+}
+
+/*
+ * Description:
+ * 	Stop capturing. The measurements taken so far can still be read.
+ */
+void PulseCapture::stop(void)
+{
+	this->subscription.cancel();
+}
+
+/*
+ * Description:
+ * 	Pair the edge with the previous one. A falling edge ends a high time, a rising
+ * 	edge ends a low time and a period.
+ */
+void PulseCapture::onEdge(const GpioBase::VALUE LEVEL, const uint64_t TIMESTAMP_NS)
+{
+	const bool PAIRED = this->hasEdge && LEVEL != this->lastLevel;
+	const bool RISING = (LEVEL == GpioBase::VALUE::HIGH);
+
+	uint64_t highNs = 0;
+	uint64_t lowNs = 0;
+	uint64_t periodNs = 0;
+
+	if(PAIRED)
+	{
+		if(RISING)
+		{
+			lowNs = TIMESTAMP_NS - this->lastEdgeNs;
+			periodNs = (this->lastRisingNs != 0) ? TIMESTAMP_NS - this->lastRisingNs : 0;
+		}
+		else
+		{
+			highNs = TIMESTAMP_NS - this->lastEdgeNs;
+		}
+	}
+
+	{
+		lock_guard<mutex> lock(this->windowsMutex);
+
+		this->edgeCount++;
+
+		if(this->hasEdge && !PAIRED)
+		{
+			this->missedEdgeCount++;
+		}
+
+		if(highNs != 0)
+		{
+			this->high.add(highNs);
+		}
+
+		if(lowNs != 0)
+		{
+			this->low.add(lowNs);
+		}
+
+		if(periodNs != 0)
+		{
+			this->period.add(periodNs);
+		}
+	}
+
+	//Two falling edges in a row hide a rising edge, so the next period cannot be measured
+	if(RISING)
+	{
+		this->lastRisingNs = TIMESTAMP_NS;
+	}
+	else if(!PAIRED)
+	{
+		this->lastRisingNs = 0;
+	}
+	this->lastLevel = LEVEL;
+	this->lastEdgeNs = TIMESTAMP_NS;
+	this->hasEdge = true;
+
+	//Publish: readers retry while the sequence is odd or has moved
+	const uint32_t SEQUENCE = this->sequence.load(memory_order_relaxed);
+	this->sequence.store(SEQUENCE + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+
+	this->latestTimestampNs.store(TIMESTAMP_NS, memory_order_relaxed);
+
+	if(highNs != 0)
+	{
+		this->latestHighNs.store(highNs, memory_order_relaxed);
+		this->latestPulseCount.store(this->latestPulseCount.load(memory_order_relaxed) + 1, memory_order_relaxed);
+	}
+
+	if(lowNs != 0)
+	{
+		this->latestLowNs.store(lowNs, memory_order_relaxed);
+	}
+
+	if(periodNs != 0)
+	{
+		this->latestPeriodNs.store(periodNs, memory_order_relaxed);
+	}
+
+	this->sequence.store(SEQUENCE + 2, memory_order_release);
+}
+
+/*
+ * Description:
+ * 	Read the latest measurements without locking: a consistent copy of the values
+ * 	published by the last edge. Can be called from any thread, as often as needed.
+ *
+ * Args:
+ * 	measurement Receives the latest measurements, 0 for those not measured yet
+ *
+ * Return
+ * 	False if no edge has been seen yet
+ */
+bool PulseCapture::getLatest(PulseMeasurement &measurement) const
+{
+	uint32_t before;
+	uint32_t after;
+
+	do
+	{
+		before = this->sequence.load(memory_order_acquire);
+
+		measurement.timestampNs = this->latestTimestampNs.load(memory_order_relaxed);
+		measurement.highNs = this->latestHighNs.load(memory_order_relaxed);
+		measurement.lowNs = this->latestLowNs.load(memory_order_relaxed);
+		measurement.periodNs = this->latestPeriodNs.load(memory_order_relaxed);
+		measurement.pulseCount = this->latestPulseCount.load(memory_order_relaxed);
+
+		atomic_thread_fence(memory_order_acquire);
+		after = this->sequence.load(memory_order_relaxed);
+	}
+	while((before & 1) != 0 || before != after);
+
+	return before != 0;
+}
+
+/*
+ * Description:
+ * 	Rolling statistics over the last window values of each measurement. The values
+ * 	are copied out under the lock and sorted on the calling thread, so the watching
+ * 	thread only ever waits for the copy.
+ */
+PulseCapture::Statistics PulseCapture::getStatistics(void) const
+{
+	Window highCopy;
+	Window lowCopy;
+	Window periodCopy;
+	Statistics statistics;
+
+	{
+		lock_guard<mutex> lock(this->windowsMutex);
+
+		highCopy = this->high;
+		lowCopy = this->low;
+		periodCopy = this->period;
+		statistics.edges = this->edgeCount;
+		statistics.missedEdges = this->missedEdgeCount;
+	}
+
+	statistics.high = highCopy.summarize();
+	statistics.low = lowCopy.summarize();
+	statistics.period = periodCopy.summarize();
+
+	return statistics;
+}
+
+PulseCapture::Summary PulseCapture::Window::summarize(void) const
+{
+	Summary summary = {0, 0, 0, 0, 0, 0, 0};
+
+	summary.samples = min(this->count, this->values.size());
+
+	if(summary.samples == 0)
+	{
+		return summary;
+	}
+
+	vector<uint64_t> sorted(this->values.begin(), this->values.begin() + summary.samples);
+	sort(sorted.begin(), sorted.end());
+
+	double total = 0;
+	for(uint64_t value : sorted)
+	{
+		total += (double)value;
+	}
+
+	summary.min = sorted.front();
+	summary.max = sorted.back();
+	summary.mean = total / (double)summary.samples;
+	summary.p50 = sorted[(summary.samples - 1) * 50 / 100];
+	summary.p90 = sorted[(summary.samples - 1) * 90 / 100];
+	summary.p99 = sorted[(summary.samples - 1) * 99 / 100];
+
+	return summary;
+}
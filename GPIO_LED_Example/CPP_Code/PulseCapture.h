@@ -0,0 +1,113 @@
+#ifndef H_PULSE_CAPTURE_H_
+#define H_PULSE_CAPTURE_H_
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "GpioBase.h"
+#include "EdgeSubscription.h"
+
+/* The latest of each measurement of a pulse train, see PulseCapture::getLatest() */
+struct PulseMeasurement
+{
+	uint64_t timestampNs; //When the last edge was detected
+	uint64_t highNs;      //Last high time: rising to falling edge
+	uint64_t lowNs;       //Last low time: falling to rising edge
+	uint64_t periodNs;    //Last period: rising to rising edge
+	uint64_t pulseCount;  //High pulses measured so far
+};
+
+/*
+ * Input capture on a pin set up for EDGE::BOTH, e.g. the echo of an ultrasonic
+ * ranger or the feedback of a PWM signal. Consecutive edges are paired into high
+ * times, low times and periods, timestamped when each edge was detected.
+ *
+ * The edges are handled on the pin's own watching thread (triggerOnEdge()), which
+ * keeps the last WINDOW values of each measurement in buffers allocated up front.
+ * There is no EdgeWorkerPool option: the pairing needs the edges one at a time and
+ * in order, which a pool of several workers does not give.
+ * getStatistics() works out min/max/mean/percentiles over them on the caller's
+ * thread. getLatest() reads the latest values lock-free and never blocks or wakes
+ * the watching thread.
+ *
+ * Two consecutive edges at the same level mean an edge was missed (the pulse was
+ * shorter than the wakeup latency): the pairing restarts and the edge is counted,
+ * see Statistics::missedEdges.
+ */
+class PulseCapture
+{
+public:
+	/* Rolling statistics of one measurement, in ns */
+	struct Summary
+	{
+		size_t samples;
+		uint64_t min;
+		uint64_t max;
+		double mean;
+		uint64_t p50;
+		uint64_t p90;
+		uint64_t p99;
+	};
+
+	struct Statistics
+	{
+		Summary high;
+		Summary low;
+		Summary period;
+		uint64_t edges;       //Edges seen
+		uint64_t missedEdges; //Edges whose level repeated the previous one
+	};
+
+	PulseCapture(GpioBase &pin, size_t window = 256);
+	~PulseCapture();
+
+	PulseCapture(const PulseCapture &) = delete;
+	PulseCapture &operator=(const PulseCapture &) = delete;
+
+	bool getLatest(PulseMeasurement &measurement) const;
+	Statistics getStatistics(void) const;
+	void stop(void);
+
+	bool isCapturing(void) const { return subscription.isActive(); }
+
+private:
+	/* The last values of one measurement, oldest overwritten first */
+	struct Window
+	{
+		vector<uint64_t> values;
+		size_t count; //Values written so far
+
+		void add(const uint64_t VALUE) { values[count++ % values.size()] = VALUE; }
+		Summary summarize(void) const;
+	};
+
+	/* The latest measurement, published with a sequence lock: odd while being written */
+	atomic<uint32_t> sequence;
+	atomic<uint64_t> latestTimestampNs;
+	atomic<uint64_t> latestHighNs;
+	atomic<uint64_t> latestLowNs;
+	atomic<uint64_t> latestPeriodNs;
+	atomic<uint64_t> latestPulseCount;
+
+	//Only touched by the watching thread
+	bool hasEdge;
+	GpioBase::VALUE lastLevel;
+	uint64_t lastEdgeNs;
+	uint64_t lastRisingNs; //0 until the first rising edge
+
+	mutable mutex windowsMutex; //Held by the watching thread only to add a value
+	Window high;
+	Window low;
+	Window period;
+	uint64_t edgeCount;
+	uint64_t missedEdgeCount;
+
+	EdgeSubscription subscription;
+
+	void onEdge(const GpioBase::VALUE LEVEL, const uint64_t TIMESTAMP_NS);
+};
+
+#endif /* H_PULSE_CAPTURE_H_ */
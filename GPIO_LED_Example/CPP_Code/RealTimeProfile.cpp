@@ -0,0 +1,79 @@
+#include <stdio.h>
+#include <alloca.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include "RealTimeProfile.h"
+
+/*
+ * Description:
+ *	Write to every page of the next BYTES of stack, so the thread does not page
+ *	fault the first time it goes that deep. Kept out of line so the stack it
+ *	touches is below the caller's frame.
+ */
+static void __attribute__((noinline)) prefaultStack(const size_t BYTES)
+{
+	const size_t PAGE_SIZE = 4096;
+	volatile char *stack = static_cast<volatile char*>(alloca(BYTES));
+
+	for(size_t offset = 0; offset < BYTES; offset += PAGE_SIZE)
+	{
+		stack[offset] = 0;
+	}
+}
+
+/*
+ * Description:
+ * 	Apply the profile to the calling thread: lock memory, prefault the stack, pin
+ * 	the thread and switch it to SCHED_FIFO.
+ *
+ * Args:
+ * 	profile The settings to apply
+ */
+ScopedRealTimeProfile::ScopedRealTimeProfile(const RealTimeProfile &profile) : affinity(profile.cpu), scheduled(false),
+	previousPolicy(SCHED_OTHER)
+{
+	if(profile.lockMemory && mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+	{
+		perror("ScopedRealTimeProfile - Failed to lock memory: mlockall()");
+	}
+
+	if(profile.prefaultStackBytes > 0)
+	{
+		prefaultStack(profile.prefaultStackBytes);
+	}
+
+	if(profile.priority <= 0)
+	{
+		return;
+	}
+
+	if(pthread_getschedparam(pthread_self(), &this->previousPolicy, &this->previousParameters) != 0)
+	{
+		return;
+	}
+
+	struct sched_param parameters;
+	parameters.sched_priority = profile.priority;
+
+	const int ERROR = pthread_setschedparam(pthread_self(), SCHED_FIFO, &parameters);
+	if(ERROR != 0)
+	{
+		cout << "Warning: ScopedRealTimeProfile - Could not switch to SCHED_FIFO " << profile.priority
+			 << " (error " << ERROR << "), running with the default scheduler" << endl;
+		return;
+	}
+
+	this->scheduled = true;
+}
+
+/*
+ * Destructor
+ */
+ScopedRealTimeProfile::~ScopedRealTimeProfile()
+{
+	if(this->scheduled)
+	{
+		pthread_setschedparam(pthread_self(), this->previousPolicy, &this->previousParameters);
+	}
+}
@@ -0,0 +1,66 @@
+#ifndef H_REAL_TIME_PROFILE_H_
+#define H_REAL_TIME_PROFILE_H_
+
+#include <stddef.h>
+#include <sched.h>
+
+#include "CpuAffinity.h"
+
+/*
+ * Opt-in real-time settings for the threads that wait for edges (pollEdge() and
+ * GpioEventLoop::run()). With the defaults nothing changes; fields left at their
+ * default are not applied.
+ *
+ *     priority           SCHED_FIFO priority (1 - 99), 0 keeps SCHED_OTHER
+ *     cpu                The core the thread is pinned to, -1 to leave it free
+ *     lockMemory         mlockall() the whole process, now and in the future
+ *     prefaultStackBytes Touch this much of the thread's stack up front
+ *
+ * SCHED_FIFO and mlockall() need CAP_SYS_NICE and CAP_IPC_LOCK (or root). When
+ * they are refused a warning is printed and the thread runs without them.
+ */
+struct RealTimeProfile
+{
+	int priority = 0;
+	int cpu = -1;
+	bool lockMemory = false;
+	size_t prefaultStackBytes = 0;
+
+	bool isEnabled(void) const { return priority > 0 || cpu >= 0 || lockMemory || prefaultStackBytes > 0; }
+
+	/* The profile used by the latency self-test: FIFO 80 on CPU 0, memory locked, 256KB of stack */
+	static RealTimeProfile lowLatency(void)
+	{
+		RealTimeProfile profile;
+		profile.priority = 80;
+		profile.cpu = 0;
+		profile.lockMemory = true;
+		profile.prefaultStackBytes = 256 * 1024;
+		return profile;
+	}
+};
+
+/*
+ * Applies a RealTimeProfile to the calling thread for as long as it is in scope.
+ * The scheduling policy and CPU affinity are put back afterwards, locked memory
+ * stays locked.
+ */
+class ScopedRealTimeProfile
+{
+public:
+	ScopedRealTimeProfile(const RealTimeProfile &profile);
+	~ScopedRealTimeProfile();
+
+	ScopedRealTimeProfile(const ScopedRealTimeProfile &) = delete;
+	ScopedRealTimeProfile &operator=(const ScopedRealTimeProfile &) = delete;
+
+	bool isRealTime(void) const { return scheduled; }
+
+private:
+	ScopedCpuAffinity affinity;
+	bool scheduled;
+	int previousPolicy;
+	struct sched_param previousParameters;
+};
+
+#endif /* H_REAL_TIME_PROFILE_H_ */
@@ -0,0 +1,152 @@
+#include "RegisterBackend.h"
+#include "PinTable.h"
+
+atomic<MemMap*> RegisterBackend::sharedMemMap(nullptr);
+
+/*
+ * Description:
+ * 	Setup the chosen GPIO pin for register access. On the board (/dev/mem) the pin
+ * 	is also muxed as a GPIO, a stand-in device has nothing to configure.
+ */
+RegisterBackend::RegisterBackend(unsigned int pin) : gpioPinNumber(pin), memmap(getMemMap()),
+	bank(getPinDescriptor(pin % GPIO_COUNT).bank), mask(0)
+{
+	if(pin >= GPIO_COUNT)
+	{
+		cout << "ERROR: RegisterBackend - GPIO " << pin << " does not exist" << endl;
+		return;
+	}
+
+	this->mask = getPinDescriptor(pin).mask;
+
+	if(this->memmap.getDevicePath() == MemMap::DEFAULT_DEVICE_PATH)
+	{
+		GpioBase::configureAll({pin});
+	}
+}
+
+/*
+ * Description:
+ *	Updates the direction of the pin through the bank's OE register (cleared bit = output).
+ *	OE is only stored if the direction changes, it is never read back from the device.
+ *
+ * Args:
+ *	GPIO_DIRECTION The new direction for the selected GPIO pin
+ *
+ * Return
+ * 	None
+ */
+void RegisterBackend::setDirection(const DIRECTION GPIO_DIRECTION) const
+{
+	MemMap::Transaction transaction(this->memmap);
+
+	if(GPIO_DIRECTION == DIRECTION::INPUT)
+	{
+		transaction.setInput(this->bank, this->mask);
+	}
+	else
+	{
+		transaction.setOutput(this->bank, this->mask);
+	}
+
+	transaction.commit();
+}
+
+/*
+ * Description:
+ *	Updates the edge that is reported for the pin. Edges are delivered by the kernel,
+ *	so this goes through the pin's sysfs edge attribute.
+ *
+ * Args:
+ *	GPIO_EDGE The edge to report
+ *
+ * Return
+ * 	None
+ */
+void RegisterBackend::setEdge(const EDGE GPIO_EDGE)
+{
+	if(GPIO_EDGE == EDGE::NONE && !this->edgeBackend)
+	{
+		return;
+	}
+
+	if(!this->edgeBackend)
+	{
+		this->edgeBackend.reset(new SysfsBackend(this->gpioPinNumber));
+	}
+
+	this->edgeBackend->setEdge(GPIO_EDGE);
+}
+
+/*
+ * Description:
+ *	Program the hardware debouncer of the pin: its DEBOUNCENABLE bit, and the
+ *	bank's DEBOUNCINGTIME. The time is shared by every debounced pin of the bank,
+ *	the last pin configured sets it.
+ *
+ * Args:
+ *	DEBOUNCE_NS The debounce time in ns (saturates at ~7.9 ms), 0 disables the debouncer
+ *
+ * Return
+ * 	True, the register backend always has a hardware debouncer
+ */
+bool RegisterBackend::setDebounce(const uint64_t DEBOUNCE_NS) const
+{
+	MemMap::Transaction transaction(this->memmap);
+
+	if(DEBOUNCE_NS == 0)
+	{
+		transaction.clearBits(this->bank, GPIO_DEBOUNCENABLE_OFFSET, this->mask);
+	}
+	else
+	{
+		transaction.assign(this->bank, GPIO_DEBOUNCINGTIME_OFFSET, GpioBase::getDebouncingTime(DEBOUNCE_NS));
+		transaction.setBits(this->bank, GPIO_DEBOUNCENABLE_OFFSET, this->mask);
+	}
+
+	transaction.commit();
+
+	return true;
+}
+
+int RegisterBackend::getEdgeFileDescriptor(void) const
+{
+	return this->edgeBackend ? this->edgeBackend->getEdgeFileDescriptor() : -1;
+}
+
+/*
+ * Description:
+ *	Use memmap for every RegisterBackend pin created from now on.
+ *
+ * Args:
+ *	memmap The mapped banks, e.g. a MemMap of a stand-in file. It must outlive the pins.
+ *
+ * Return
+ * 	None
+ */
+void RegisterBackend::useMemMap(MemMap &memmap)
+{
+	sharedMemMap = &memmap;
+}
+
+MemMap &RegisterBackend::getMemMap(void)
+{
+	MemMap *memmap = sharedMemMap.load();
+
+	//Pins created on several threads at once agree on a single default MemMap
+	if(memmap == nullptr)
+	{
+		static MemMap defaultMemMap;
+		sharedMemMap.compare_exchange_strong(memmap, &defaultMemMap);
+		memmap = sharedMemMap.load();
+	}
+
+	return *memmap;
+}
+
+/*
+ * Destructor
+ */
+RegisterBackend::~RegisterBackend()
+{
+}
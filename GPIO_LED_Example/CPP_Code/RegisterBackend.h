@@ -0,0 +1,76 @@
+#ifndef H_REGISTER_BACKEND_H_
+#define H_REGISTER_BACKEND_H_
+
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+
+#include "GpioBase.h"
+#include "MemMap.h"
+#include "SysfsBackend.h"
+
+/*
+ * GPIO backend that reads and writes the bank registers directly through MemMap.
+ * setValue() is a single store into SETDATAOUT or CLEARDATAOUT.
+ *
+ * The registers cannot report edges without the kernel's interrupt handling, so
+ * when an edge is requested the pin is also opened through sysfs and its value
+ * file is used as the edge descriptor.
+ *
+ * All pins share one MemMap: /dev/mem by default, or the one given to useMemMap()
+ * (e.g. mapping a stand-in file) before the first pin is created.
+ *
+ * Different pins can be used from different threads at the same time, even pins of
+ * the same bank: setValue() is a lock-free SETDATAOUT/CLEARDATAOUT store, and
+ * setDirection()/setDebounce() commit through the MemMap shadow. A single pin's
+ * setEdge() must not race with itself.
+ */
+class RegisterBackend
+{
+public:
+	typedef GpioBase::DIRECTION DIRECTION;
+	typedef GpioBase::VALUE VALUE;
+	typedef GpioBase::EDGE EDGE;
+
+	RegisterBackend(unsigned int pin);
+	~RegisterBackend();
+
+	RegisterBackend(const RegisterBackend &) = delete;
+	RegisterBackend &operator=(const RegisterBackend &) = delete;
+
+	inline void setValue(const VALUE GPIO_VALUE) const
+	{
+		memmap.write(bank, (GPIO_VALUE == VALUE::HIGH) ? GPIO_SETDATAOUT_OFFSET : GPIO_CLEARDATAOUT_OFFSET, mask);
+	}
+
+	inline VALUE getValue(void) const
+	{
+		return (memmap.read(bank, GPIO_DATAIN_OFFSET) & mask) ? VALUE::HIGH : VALUE::LOW;
+	}
+
+	bool readValue(VALUE &value) const
+	{
+		value = getValue();
+		return true;
+	}
+
+	void setDirection(const DIRECTION GPIO_DIRECTION) const;
+	void setEdge(const EDGE GPIO_EDGE);
+	bool setDebounce(const uint64_t DEBOUNCE_NS) const;
+
+	int getEdgeFileDescriptor(void) const;
+
+	static void useMemMap(MemMap &memmap);
+	static MemMap &getMemMap(void);
+
+private:
+	static atomic<MemMap*> sharedMemMap;
+
+	unsigned int gpioPinNumber;
+	MemMap &memmap;
+	MemMap::BANK bank;
+	uint32_t mask;
+	unique_ptr<SysfsBackend> edgeBackend; //Only opened once an edge is requested
+};
+
+#endif /* H_REGISTER_BACKEND_H_ */
@@ -0,0 +1,274 @@
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "SampleCapture.h"
+#include "CpuAffinity.h"
+#include "PinTable.h"
+#include "Timestamp.h"
+
+static const char CAPTURE_MAGIC[8] = {'G', 'P', 'I', 'O', 'C', 'A', 'P', '1'};
+
+/*
+ * Description:
+ * 	Group the pins by bank and map the ring: anonymous memory, or captureFile
+ * 	(created, or truncated, to hold a SampleCaptureHeader and capacity records).
+ * 	The mapping is prefaulted so the sampler never takes a page fault.
+ *
+ * Args:
+ * 	memmap The mapped GPIO banks to sample
+ * 	gpioPins The GPIO numbers of the pins to capture
+ * 	capacity The number of transitions kept, rounded up to a power of two
+ * 	captureFile Where to stream the transitions, or "" to keep them in memory
+ */
+SampleCapture::SampleCapture(MemMap &memmap, const vector<unsigned int> &gpioPins, size_t capacity, const string &captureFile) :
+	memmap(memmap), capacity(1), mask(0), captureFile(captureFile), mapping(MAP_FAILED), mappingSize(0),
+	header(nullptr), records(nullptr), running(false)
+{
+	memset(&this->statistics, 0, sizeof(this->statistics));
+	bankMasks.fill(0);
+
+	for(unsigned int gpioPin : gpioPins)
+	{
+		if(gpioPin >= GPIO_COUNT)
+		{
+			cout << "ERROR: SampleCapture - GPIO " << gpioPin << " does not exist" << endl;
+			continue;
+		}
+
+		this->bankMasks[(unsigned int)getPinDescriptor(gpioPin).bank] |= getPinDescriptor(gpioPin).mask;
+	}
+
+	for(unsigned int bank = 0; bank < GPIO_BANKS; ++bank)
+	{
+		if(this->bankMasks[bank] != 0)
+		{
+			this->usedBanks.push_back((MemMap::BANK)bank);
+		}
+	}
+
+	while(this->capacity < capacity)
+	{
+		this->capacity <<= 1;
+	}
+
+	this->mask = this->capacity - 1;
+	this->mappingSize = sizeof(SampleCaptureHeader) + this->capacity * sizeof(SampleTransition);
+
+	if(captureFile.empty())
+	{
+		this->mapping = mmap(nullptr, this->mappingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+	}
+	else
+	{
+		int fileDescriptor = open(captureFile.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if(fileDescriptor == -1)
+		{
+			perror(("SampleCapture - Failed to open the capture file: " + captureFile).c_str());
+			return;
+		}
+
+		if(ftruncate(fileDescriptor, this->mappingSize) == 0)
+		{
+			this->mapping = mmap(nullptr, this->mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fileDescriptor, 0);
+		}
+		else
+		{
+			perror(("SampleCapture - Failed to size the capture file: " + captureFile).c_str());
+		}
+
+		close(fileDescriptor); //The mapping keeps the file
+	}
+
+	if(this->mapping == MAP_FAILED)
+	{
+		perror("SampleCapture - Failed to map the capture ring: mmap()");
+		return;
+	}
+
+	//A file mapping is only populated for pages already in the page cache, so touch every page.
+	memset(this->mapping, 0, this->mappingSize);
+
+	this->header = static_cast<SampleCaptureHeader*>(this->mapping);
+	this->records = reinterpret_cast<SampleTransition*>(this->header + 1);
+
+	memcpy(this->header->magic, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));
+	this->header->capacity = this->capacity;
+
+	for(unsigned int bank = 0; bank < GPIO_BANKS; ++bank)
+	{
+		this->header->bankMasks[bank] = this->bankMasks[bank];
+	}
+}
+
+/*
+ * Description:
+ *	Sample the captured pins every 1/SAMPLE_RATE_HZ seconds until DURATION_NS has
+ *	elapsed or stop() is called. Runs on the calling thread, spinning on the clock
+ *	between samples. A sample that is due while the sampler is still behind by a
+ *	whole period is skipped (and counted) rather than taken late, so sampleIndex
+ *	stays an exact time base.
+ *
+ * Args:
+ *	SAMPLE_RATE_HZ The target sample rate
+ *	DURATION_NS How long to capture for
+ *	CPU The core to run the capture on, or -1 to stay where the thread is
+ *
+ * Return
+ * 	False if the capture could not start
+ */
+bool SampleCapture::run(const uint64_t SAMPLE_RATE_HZ, const uint64_t DURATION_NS, const int CPU)
+{
+	if(!isReady() || SAMPLE_RATE_HZ == 0)
+	{
+		cout << "ERROR: SampleCapture::run - The capture ring is not mapped or the sample rate is 0" << endl;
+		return false;
+	}
+
+	ScopedCpuAffinity affinity(CPU);
+
+	this->running.store(true, memory_order_relaxed);
+
+	this->header->transitionCount = 0;
+	this->header->sampleCount = 0;
+	this->header->sampleRateHz = SAMPLE_RATE_HZ;
+
+	const MemMap::BANK *BANKS = this->usedBanks.data();
+	const unsigned int BANK_COUNT = this->usedBanks.size();
+
+	uint32_t levels[GPIO_BANKS] = {0, 0, 0, 0};
+	uint64_t transitionCount = 0;
+	uint64_t sampleCount = 0;
+	uint64_t missedSampleCount = 0;
+	uint64_t jitterSum = 0;
+	uint64_t maxJitter = 0;
+
+	const uint64_t START = monotonicTimeNs();
+	const uint64_t END = START + DURATION_NS;
+	uint64_t now = START;
+
+	for(uint64_t sampleIndex = 0; this->running.load(memory_order_relaxed); ++sampleIndex)
+	{
+		const uint64_t DEADLINE = START + (sampleIndex * 1000000000ULL) / SAMPLE_RATE_HZ;
+
+		if(DEADLINE >= END)
+		{
+			break;
+		}
+
+		while((now = monotonicTimeNs()) < DEADLINE)
+		{
+		}
+
+		const uint64_t JITTER = now - DEADLINE;
+		jitterSum += JITTER;
+		if(JITTER > maxJitter)
+		{
+			maxJitter = JITTER;
+		}
+
+		//Fallen behind by whole periods: skip the samples that can no longer be taken on time.
+		const uint64_t DUE_INDEX = ((now - START) * SAMPLE_RATE_HZ) / 1000000000ULL;
+		if(DUE_INDEX > sampleIndex)
+		{
+			missedSampleCount += DUE_INDEX - sampleIndex;
+			sampleIndex = DUE_INDEX;
+		}
+
+		bool changed = (sampleCount == 0);
+		uint32_t sample[GPIO_BANKS] = {0, 0, 0, 0};
+
+		for(unsigned int index = 0; index < BANK_COUNT; ++index)
+		{
+			const unsigned int BANK = (unsigned int)BANKS[index];
+
+			sample[BANK] = this->memmap.read(BANKS[index], GPIO_DATAIN_OFFSET) & this->bankMasks[BANK];
+			changed |= (sample[BANK] != levels[BANK]);
+		}
+
+		if(changed)
+		{
+			SampleTransition &transition = this->records[transitionCount & this->mask];
+
+			transition.timestampNs = now;
+			transition.sampleIndex = sampleIndex;
+
+			for(unsigned int bank = 0; bank < GPIO_BANKS; ++bank)
+			{
+				transition.levels[bank] = sample[bank];
+				levels[bank] = sample[bank];
+			}
+
+			this->header->transitionCount = ++transitionCount;
+		}
+
+		this->header->sampleCount = ++sampleCount;
+	}
+
+	const uint64_t ELAPSED = now - START;
+
+	this->running.store(false, memory_order_relaxed);
+
+	this->statistics.sampleCount = sampleCount;
+	this->statistics.transitionCount = transitionCount;
+	this->statistics.overwrittenCount = (transitionCount > this->capacity) ? transitionCount - this->capacity : 0;
+	this->statistics.missedSampleCount = missedSampleCount;
+	this->statistics.targetRateHz = (double)SAMPLE_RATE_HZ;
+	this->statistics.achievedRateHz = (ELAPSED == 0) ? 0 : (double)sampleCount * 1e9 / (double)ELAPSED;
+	this->statistics.meanJitterNs = (sampleCount == 0) ? 0 : (double)jitterSum / (double)sampleCount;
+	this->statistics.maxJitterNs = maxJitter;
+
+	if(!this->captureFile.empty())
+	{
+		msync(this->mapping, this->mappingSize, MS_ASYNC);
+	}
+
+	return true;
+}
+
+/*
+ * Description:
+ *	Make run() return after its current sample. Can be called from any thread.
+ */
+void SampleCapture::stop(void)
+{
+	this->running.store(false, memory_order_relaxed);
+}
+
+/*
+ * Description:
+ *	The number of transitions held in the ring, at most getCapacity().
+ */
+size_t SampleCapture::size(void) const
+{
+	if(!isReady())
+	{
+		return 0;
+	}
+
+	return (this->header->transitionCount < this->capacity) ? this->header->transitionCount : this->capacity;
+}
+
+/*
+ * Description:
+ *	Get a recorded transition, oldest first. INDEX must be lower than size().
+ */
+const SampleTransition &SampleCapture::getTransition(const size_t INDEX) const
+{
+	const uint64_t OLDEST = this->header->transitionCount - size();
+
+	return this->records[(OLDEST + INDEX) & this->mask];
+}
+
+/*
+ * Destructor
+ */
+SampleCapture::~SampleCapture()
+{
+	if(this->mapping != MAP_FAILED)
+	{
+		munmap(this->mapping, this->mappingSize);
+	}
+}
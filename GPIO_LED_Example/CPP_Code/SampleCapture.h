@@ -0,0 +1,95 @@
+#ifndef H_SAMPLE_CAPTURE_H_
+#define H_SAMPLE_CAPTURE_H_
+
+#include <array>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "MemMap.h"
+
+/* A change of the sampled pins, as stored in the SampleCapture ring */
+struct SampleTransition
+{
+	uint64_t timestampNs;            //CLOCK_MONOTONIC time the sample was taken
+	uint64_t sampleIndex;            //Sample number since the start of the capture
+	uint32_t levels[GPIO_BANKS];     //DATAIN of every bank, masked to the captured pins
+};
+
+/* The start of a capture file, followed by capacity SampleTransition records */
+struct SampleCaptureHeader
+{
+	char magic[8];                   //"GPIOCAP1"
+	uint64_t capacity;               //Number of records in the file, a power of two
+	uint64_t transitionCount;        //Records written so far, record i is at (i & (capacity - 1))
+	uint64_t sampleCount;            //Samples taken so far
+	uint64_t sampleRateHz;           //Target sample rate
+	uint32_t bankMasks[GPIO_BANKS];  //The captured pins of every bank
+};
+
+/*
+ * Software logic analyzer. The DATAIN registers of the banks holding the captured
+ * pins are sampled at a fixed rate by a thread spinning on the clock (ideally alone
+ * on its core), much faster than edges can be delivered through sysfs.
+ *
+ * Only changes are kept: a SampleTransition is recorded whenever the sampled levels
+ * differ from the previous sample, and the run length of a level is the distance to
+ * the next transition's sampleIndex. Transitions go into a ring preallocated (and
+ * prefaulted) up front, either in memory or in a memory-mapped capture file that other
+ * processes can read while the capture runs. When the ring is full the oldest
+ * transitions are overwritten, so it always holds the latest capacity changes.
+ */
+class SampleCapture
+{
+public:
+	struct Statistics
+	{
+		uint64_t sampleCount;        //Samples taken
+		uint64_t transitionCount;    //Transitions recorded (including overwritten ones)
+		uint64_t overwrittenCount;   //Transitions lost because the ring wrapped
+		uint64_t missedSampleCount;  //Sample times skipped because the sampler fell behind
+		double targetRateHz;
+		double achievedRateHz;       //Samples actually taken per second of capture
+		double meanJitterNs;         //Mean lateness of a sample compared to its scheduled time
+		uint64_t maxJitterNs;        //Worst lateness
+	};
+
+	SampleCapture(MemMap &memmap, const vector<unsigned int> &gpioPins, size_t capacity, const string &captureFile = "");
+	~SampleCapture();
+
+	SampleCapture(const SampleCapture &) = delete;
+	SampleCapture &operator=(const SampleCapture &) = delete;
+
+	bool isReady(void) const { return records != nullptr; }
+
+	bool run(const uint64_t SAMPLE_RATE_HZ, const uint64_t DURATION_NS, const int CPU = -1);
+	void stop(void);
+
+	const Statistics &getStatistics(void) const { return statistics; }
+
+	size_t getCapacity(void) const { return capacity; }
+	size_t size(void) const;
+	const SampleTransition &getTransition(const size_t INDEX) const;
+	uint32_t getBankMask(const MemMap::BANK GPIO_BANK) const { return bankMasks[(unsigned int)GPIO_BANK]; }
+
+private:
+	MemMap &memmap;
+	std::array<uint32_t, GPIO_BANKS> bankMasks;
+	vector<MemMap::BANK> usedBanks;
+
+	size_t capacity; //Always a power of two
+	size_t mask;
+	string captureFile;
+
+	void *mapping; //The header (capture file only) and the records
+	size_t mappingSize;
+	SampleCaptureHeader *header;
+	SampleTransition *records;
+
+	std::atomic<bool> running;
+	Statistics statistics;
+};
+
+#endif /* H_SAMPLE_CAPTURE_H_ */
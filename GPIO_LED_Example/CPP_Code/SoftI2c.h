@@ -0,0 +1,334 @@
+#ifndef H_SOFT_I2C_H_
+#define H_SOFT_I2C_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "MemMap.h"
+#include "PinTable.h"
+#include "Timestamp.h"
+
+/*
+ * Bit-banged I2C master. SCL and SDA are open drain: a line is pulled low by making
+ * the pin an output (its DATAOUT bit is kept at 0) and released by making it an
+ * input, letting the pull-up raise it. Both lines are read back from DATAIN, which
+ * is how ACKs, read data and clock stretching by the slave are seen.
+ *
+ * Transfers run from the caller's buffers, with no system calls or allocations.
+ *
+ * REGISTERS is MemMap on the board or a model of the banks (see updateBits()). The
+ * pins must already be muxed as GPIOs (see GpioBase::configureAll()) and have pull-ups.
+ */
+template<typename REGISTERS = MemMap>
+class SoftI2c
+{
+public:
+	/* How long a slave may stretch the clock before the transfer is abandoned */
+	static const uint64_t STRETCH_TIMEOUT_NS = 10000000ULL;
+
+	/*
+	 * Description:
+	 * 	Setup the bus pins, leaving both lines released (idle). If a pin is not a valid
+	 * 	GPIO nothing is touched, and every transfer fails (see isValid()).
+	 *
+	 * Args:
+	 * 	registers The register file the pins are in
+	 * 	sclPin, sdaPin The GPIO numbers of the bus lines
+	 * 	clockHz The SCL frequency, e.g. 100000 or 400000
+	 */
+	SoftI2c(REGISTERS &registers, unsigned int sclPin, unsigned int sdaPin, uint32_t clockHz = 100000) :
+		//The modulo only keeps the lookups inside the pin table, the descriptors of invalid pins are never used
+		registers(registers), scl(getPinDescriptor(sclPin % GPIO_COUNT)), sda(getPinDescriptor(sdaPin % GPIO_COUNT)),
+		valid(sclPin < GPIO_COUNT && sdaPin < GPIO_COUNT), halfPeriodNs(0)
+	{
+		setClock(clockHz);
+
+		if(!this->valid)
+		{
+			cout << "ERROR: SoftI2c - SCL and SDA must be valid GPIOs" << endl;
+			return;
+		}
+
+		//Pulling a line low is then only a change of direction
+		this->registers.write(this->scl.bank, GPIO_CLEARDATAOUT_OFFSET, this->scl.mask);
+		this->registers.write(this->sda.bank, GPIO_CLEARDATAOUT_OFFSET, this->sda.mask);
+
+		release(this->scl);
+		release(this->sda);
+	}
+
+	void setClock(const uint32_t CLOCK_HZ)
+	{
+		this->halfPeriodNs = (CLOCK_HZ == 0) ? 0 : (500000000U + CLOCK_HZ - 1) / CLOCK_HZ;
+	}
+
+	/*
+	 * Description:
+	 * 	Write LENGTH bytes to the slave at ADDRESS (7 bit).
+	 *
+	 * Return
+	 * 	True if the slave acknowledged its address and every byte
+	 */
+	bool write(const uint8_t ADDRESS, const uint8_t *data, const size_t LENGTH)
+	{
+		return transfer(ADDRESS, data, LENGTH, nullptr, 0);
+	}
+
+	/*
+	 * Description:
+	 * 	Read LENGTH bytes from the slave at ADDRESS (7 bit).
+	 *
+	 * Return
+	 * 	True if the slave acknowledged its address
+	 */
+	bool read(const uint8_t ADDRESS, uint8_t *data, const size_t LENGTH)
+	{
+		return transfer(ADDRESS, nullptr, 0, data, LENGTH);
+	}
+
+	/*
+	 * Description:
+	 * 	Write TX_LENGTH bytes then, after a repeated start, read RX_LENGTH bytes: the
+	 * 	usual "write register address, read register contents" transaction. Either
+	 * 	part may be empty. An address with nothing to write or read is a probe.
+	 *
+	 * Return
+	 * 	True if every address and written byte was acknowledged, false without touching
+	 * 	the bus if a pin is not a valid GPIO
+	 */
+	bool transfer(const uint8_t ADDRESS, const uint8_t *tx, const size_t TX_LENGTH, uint8_t *rx, const size_t RX_LENGTH)
+	{
+		if(!this->valid)
+		{
+			return false;
+		}
+
+		bool acknowledged = start();
+
+		if(acknowledged && (TX_LENGTH > 0 || RX_LENGTH == 0))
+		{
+			acknowledged = writeByte((uint8_t)(ADDRESS << 1));
+
+			for(size_t index = 0; acknowledged && index < TX_LENGTH; ++index)
+			{
+				acknowledged = writeByte(tx[index]);
+			}
+
+			if(acknowledged && RX_LENGTH > 0)
+			{
+				acknowledged = start(); //Repeated start
+			}
+		}
+
+		if(acknowledged && RX_LENGTH > 0)
+		{
+			acknowledged = writeByte((uint8_t)((ADDRESS << 1) | 1));
+
+			for(size_t index = 0; acknowledged && index < RX_LENGTH; ++index)
+			{
+				//Every byte but the last is acknowledged by the master
+				acknowledged = readByte(rx[index], index + 1 < RX_LENGTH);
+			}
+		}
+
+		stop();
+
+		return acknowledged;
+	}
+
+	/*
+	 * Description:
+	 * 	Check whether a slave answers at ADDRESS.
+	 */
+	bool probe(const uint8_t ADDRESS)
+	{
+		return transfer(ADDRESS, nullptr, 0, nullptr, 0);
+	}
+
+	/* False if a pin given to the constructor is not a valid GPIO */
+	bool isValid(void) const { return valid; }
+
+private:
+	REGISTERS &registers;
+	PinDescriptor scl;
+	PinDescriptor sda;
+	bool valid;
+	uint32_t halfPeriodNs;
+
+	/*
+	 * On the board the direction goes through MemMap's shadow of OE, so a later
+	 * transaction on the bank does not put the line back to a stale direction.
+	 */
+	inline void pullLow(const PinDescriptor &PIN)
+	{
+		updateBits(this->registers, PIN.bank, GPIO_OE_OFFSET, PIN.mask, 0);
+	}
+
+	inline void release(const PinDescriptor &PIN)
+	{
+		updateBits(this->registers, PIN.bank, GPIO_OE_OFFSET, 0, PIN.mask);
+	}
+
+	inline bool isHigh(const PinDescriptor &PIN) const
+	{
+		return (this->registers.read(PIN.bank, GPIO_DATAIN_OFFSET) & PIN.mask) != 0;
+	}
+
+	inline void waitHalfPeriod(void) const
+	{
+		if(this->halfPeriodNs == 0)
+		{
+			return;
+		}
+
+		const uint64_t DEADLINE = monotonicTimeNs() + this->halfPeriodNs;
+
+		while(monotonicTimeNs() < DEADLINE)
+		{
+		}
+	}
+
+	/*
+	 * Release SCL and wait for it to go high, the slave may hold it low (clock stretching).
+	 */
+	inline bool releaseClock(void)
+	{
+		release(this->scl);
+
+		if(isHigh(this->scl))
+		{
+			return true;
+		}
+
+		const uint64_t TIMEOUT = monotonicTimeNs() + STRETCH_TIMEOUT_NS;
+
+		while(!isHigh(this->scl))
+		{
+			if(monotonicTimeNs() > TIMEOUT)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	/*
+	 * START (or repeated START): SDA falls while SCL is high.
+	 */
+	bool start(void)
+	{
+		release(this->sda);
+		waitHalfPeriod();
+
+		if(!releaseClock())
+		{
+			return false;
+		}
+
+		waitHalfPeriod();
+		pullLow(this->sda);
+		waitHalfPeriod();
+		pullLow(this->scl);
+
+		return true;
+	}
+
+	/*
+	 * STOP: SDA rises while SCL is high.
+	 */
+	void stop(void)
+	{
+		pullLow(this->sda);
+		waitHalfPeriod();
+		releaseClock();
+		waitHalfPeriod();
+		release(this->sda);
+		waitHalfPeriod();
+	}
+
+	/*
+	 * Shift out a byte MSB first, then clock in the slave's ACK (SDA low).
+	 */
+	bool writeByte(const uint8_t BYTE)
+	{
+		for(int bit = 7; bit >= 0; --bit)
+		{
+			if((BYTE >> bit) & 1)
+			{
+				release(this->sda);
+			}
+			else
+			{
+				pullLow(this->sda);
+			}
+
+			waitHalfPeriod();
+
+			if(!releaseClock())
+			{
+				return false;
+			}
+
+			waitHalfPeriod();
+			pullLow(this->scl);
+		}
+
+		release(this->sda);
+		waitHalfPeriod();
+
+		if(!releaseClock())
+		{
+			return false;
+		}
+
+		const bool ACK = !isHigh(this->sda);
+		waitHalfPeriod();
+		pullLow(this->scl);
+
+		return ACK;
+	}
+
+	/*
+	 * Clock in a byte MSB first, then send ACK (or NACK after the last byte).
+	 */
+	bool readByte(uint8_t &byte, const bool ACK)
+	{
+		release(this->sda);
+		byte = 0;
+
+		for(int bit = 7; bit >= 0; --bit)
+		{
+			waitHalfPeriod();
+
+			if(!releaseClock())
+			{
+				return false;
+			}
+
+			byte = (uint8_t)((byte << 1) | (isHigh(this->sda) ? 1 : 0));
+			waitHalfPeriod();
+			pullLow(this->scl);
+		}
+
+		if(ACK)
+		{
+			pullLow(this->sda);
+		}
+
+		waitHalfPeriod();
+
+		if(!releaseClock())
+		{
+			return false;
+		}
+
+		waitHalfPeriod();
+		pullLow(this->scl);
+		release(this->sda);
+
+		return true;
+	}
+};
+
+#endif /* H_SOFT_I2C_H_ */
@@ -0,0 +1,256 @@
+#ifndef H_SOFT_SPI_H_
+#define H_SOFT_SPI_H_
+
+#include <algorithm>
+#include <span>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "MemMap.h"
+#include "PinTable.h"
+#include "Timestamp.h"
+
+/*
+ * Bit-banged SPI master. SCK, MOSI and the optional chip select are driven with
+ * SETDATAOUT/CLEARDATAOUT stores and MISO is read from DATAIN, so a transfer makes
+ * no system calls and allocates nothing: it runs straight from the caller's buffers.
+ *
+ * REGISTERS is MemMap on the board or a loopback model of the banks (see
+ * updateBits()). The pins must already be muxed as GPIOs (see GpioBase::configureAll()).
+ *
+ * The clock is timed by spinning on the clock between edges. A clock of 0 runs as
+ * fast as the stores allow.
+ */
+template<typename REGISTERS = MemMap>
+class SoftSpi
+{
+public:
+	enum class MODE
+	{
+		MODE0 = 0, //CPOL 0, CPHA 0: idle low, sample on the rising edge
+		MODE1 = 1, //CPOL 0, CPHA 1: idle low, sample on the falling edge
+		MODE2 = 2, //CPOL 1, CPHA 0: idle high, sample on the falling edge
+		MODE3 = 3  //CPOL 1, CPHA 1: idle high, sample on the rising edge
+	};
+
+	/*
+	 * Description:
+	 * 	Setup the bus pins: SCK, MOSI and CS as outputs, MISO as an input. If a pin is
+	 * 	not a valid GPIO nothing is touched, and every transfer fails (see isValid()).
+	 *
+	 * Args:
+	 * 	registers The register file the pins are in
+	 * 	sckPin, mosiPin, misoPin The GPIO numbers of the bus lines
+	 * 	csPin The GPIO number of the (active low) chip select, or INVALID_GPIO if the caller handles it
+	 */
+	SoftSpi(REGISTERS &registers, unsigned int sckPin, unsigned int mosiPin, unsigned int misoPin,
+			unsigned int csPin = INVALID_GPIO, MODE mode = MODE::MODE0, uint32_t clockHz = 1000000) :
+		//The modulo only keeps the lookups inside the pin table, the descriptors of invalid pins are never used
+		registers(registers), sck(getPinDescriptor(sckPin % GPIO_COUNT)), mosi(getPinDescriptor(mosiPin % GPIO_COUNT)),
+		miso(getPinDescriptor(misoPin % GPIO_COUNT)), cs(getPinDescriptor(csPin % GPIO_COUNT)), hasChipSelect(csPin < GPIO_COUNT),
+		valid(sckPin < GPIO_COUNT && mosiPin < GPIO_COUNT && misoPin < GPIO_COUNT && csPin <= INVALID_GPIO),
+		cpol(false), cpha(false), halfPeriodNs(0)
+	{
+		setClock(clockHz);
+
+		if(!this->valid)
+		{
+			cout << "ERROR: SoftSpi - SCK, MOSI, MISO and CS must be valid GPIOs" << endl;
+			return;
+		}
+
+		setMode(mode);
+
+		setOutput(this->mosi, true);
+		setOutput(this->miso, false);
+
+		if(this->hasChipSelect)
+		{
+			this->registers.write(this->cs.bank, GPIO_SETDATAOUT_OFFSET, this->cs.mask);
+			setOutput(this->cs, true);
+		}
+	}
+
+	/*
+	 * Description:
+	 * 	Change the SPI mode. SCK moves to the idle level of the new mode.
+	 */
+	void setMode(const MODE SPI_MODE)
+	{
+		this->cpol = ((unsigned int)SPI_MODE & 2) != 0;
+		this->cpha = ((unsigned int)SPI_MODE & 1) != 0;
+
+		if(!this->valid)
+		{
+			return;
+		}
+
+		this->registers.write(this->sck.bank, this->cpol ? GPIO_SETDATAOUT_OFFSET : GPIO_CLEARDATAOUT_OFFSET, this->sck.mask);
+		setOutput(this->sck, true);
+	}
+
+	/*
+	 * Description:
+	 * 	Change the SCK frequency, 0 for as fast as possible.
+	 */
+	void setClock(const uint32_t CLOCK_HZ)
+	{
+		this->halfPeriodNs = (CLOCK_HZ == 0) ? 0 : (500000000U + CLOCK_HZ - 1) / CLOCK_HZ;
+	}
+
+	/*
+	 * Description:
+	 * 	Full duplex transfer, MSB first. LENGTH bytes of tx are shifted out while
+	 * 	LENGTH bytes are shifted into rx. The chip select (if any) is held low for the
+	 * 	whole transfer, and asserted at least half a period before the first SCK edge
+	 * 	in every mode.
+	 *
+	 * Args:
+	 * 	tx The bytes to send, or nullptr to send 0xFF
+	 * 	rx Where to store the received bytes, or nullptr to discard them
+	 * 	LENGTH The number of bytes
+	 *
+	 * Return
+	 * 	False, without touching the bus, if a pin is not a valid GPIO
+	 */
+	bool transfer(const uint8_t *tx, uint8_t *rx, const size_t LENGTH)
+	{
+		if(!this->valid)
+		{
+			return false;
+		}
+
+		uint64_t deadline = (this->halfPeriodNs != 0) ? monotonicTimeNs() : 0;
+
+		if(this->hasChipSelect)
+		{
+			this->registers.write(this->cs.bank, GPIO_CLEARDATAOUT_OFFSET, this->cs.mask);
+
+			//CS to first SCK edge setup time: CPHA=1 modes store the leading edge first thing
+			waitHalfPeriod(deadline);
+		}
+
+		//The edge that starts a bit (leading) and the one that ends it (trailing)
+		const unsigned int LEADING = this->cpol ? GPIO_CLEARDATAOUT_OFFSET : GPIO_SETDATAOUT_OFFSET;
+		const unsigned int TRAILING = this->cpol ? GPIO_SETDATAOUT_OFFSET : GPIO_CLEARDATAOUT_OFFSET;
+
+		for(size_t index = 0; index < LENGTH; ++index)
+		{
+			const uint8_t OUT = (tx != nullptr) ? tx[index] : 0xFF;
+			uint8_t in = 0;
+
+			for(int bit = 7; bit >= 0; --bit)
+			{
+				const unsigned int MOSI_OFFSET = ((OUT >> bit) & 1) ? GPIO_SETDATAOUT_OFFSET : GPIO_CLEARDATAOUT_OFFSET;
+
+				if(this->cpha)
+				{
+					//Data changes on the leading edge and is sampled on the trailing edge.
+					this->registers.write(this->sck.bank, LEADING, this->sck.mask);
+					this->registers.write(this->mosi.bank, MOSI_OFFSET, this->mosi.mask);
+					waitHalfPeriod(deadline);
+
+					this->registers.write(this->sck.bank, TRAILING, this->sck.mask);
+					in = (in << 1) | ((this->registers.read(this->miso.bank, GPIO_DATAIN_OFFSET) & this->miso.mask) ? 1 : 0);
+					waitHalfPeriod(deadline);
+				}
+				else
+				{
+					//Data is set up before the leading edge and sampled on it.
+					this->registers.write(this->mosi.bank, MOSI_OFFSET, this->mosi.mask);
+					waitHalfPeriod(deadline);
+
+					this->registers.write(this->sck.bank, LEADING, this->sck.mask);
+					in = (in << 1) | ((this->registers.read(this->miso.bank, GPIO_DATAIN_OFFSET) & this->miso.mask) ? 1 : 0);
+					waitHalfPeriod(deadline);
+
+					this->registers.write(this->sck.bank, TRAILING, this->sck.mask);
+				}
+			}
+
+			if(rx != nullptr)
+			{
+				rx[index] = in;
+			}
+		}
+
+		if(this->hasChipSelect)
+		{
+			waitHalfPeriod(deadline);
+			this->registers.write(this->cs.bank, GPIO_SETDATAOUT_OFFSET, this->cs.mask);
+		}
+
+		return true;
+	}
+
+	/*
+	 * Description:
+	 * 	Full duplex transfer between two buffers of the same length. An empty tx sends
+	 * 	0xFF and an empty rx discards what is received.
+	 *
+	 * Return
+	 * 	False, without touching the bus, if the lengths differ or a pin is not a valid GPIO
+	 */
+	bool transfer(span<const uint8_t> tx, span<uint8_t> rx)
+	{
+		if(!tx.empty() && !rx.empty() && tx.size() != rx.size())
+		{
+			cout << "ERROR: SoftSpi - tx and rx must be the same length" << endl;
+			return false;
+		}
+
+		return transfer(tx.empty() ? nullptr : tx.data(), rx.empty() ? nullptr : rx.data(), max(tx.size(), rx.size()));
+	}
+
+	bool write(const uint8_t *tx, const size_t LENGTH) { return transfer(tx, nullptr, LENGTH); }
+	bool read(uint8_t *rx, const size_t LENGTH) { return transfer(nullptr, rx, LENGTH); }
+
+	/* False if a pin given to the constructor is not a valid GPIO */
+	bool isValid(void) const { return valid; }
+
+private:
+	REGISTERS &registers;
+	PinDescriptor sck;
+	PinDescriptor mosi;
+	PinDescriptor miso;
+	PinDescriptor cs;
+	bool hasChipSelect;
+	bool valid;
+	bool cpol;
+	bool cpha;
+	uint32_t halfPeriodNs;
+
+	void setOutput(const PinDescriptor &PIN, const bool OUTPUT)
+	{
+		//OE: a cleared bit makes the pin an output
+		updateBits(this->registers, PIN.bank, GPIO_OE_OFFSET, OUTPUT ? PIN.mask : 0, OUTPUT ? 0 : PIN.mask);
+	}
+
+	/*
+	 * Spin until the next half period of SCK. Deadlines accumulate, so the time taken
+	 * by the stores themselves is absorbed rather than added to every half period.
+	 * After a stall (e.g. preemption) the schedule restarts instead of catching up,
+	 * so SCK never runs faster than asked.
+	 */
+	inline void waitHalfPeriod(uint64_t &deadline) const
+	{
+		if(this->halfPeriodNs == 0)
+		{
+			return;
+		}
+
+		deadline += this->halfPeriodNs;
+
+		uint64_t now;
+		while((now = monotonicTimeNs()) < deadline)
+		{
+		}
+
+		if(now - deadline > this->halfPeriodNs)
+		{
+			deadline = now;
+		}
+	}
+};
+
+#endif /* H_SOFT_SPI_H_ */
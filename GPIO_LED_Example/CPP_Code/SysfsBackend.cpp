@@ -0,0 +1,221 @@
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "SysfsBackend.h"
+
+/* The preformatted contents written to the "value" file, indexed by GpioBase::VALUE */
+static const char VALUE_CHARACTERS[] = {'0', '1'};
+
+/*
+ * Description:
+ * 	Setup the chosen GPIO pin for access through /sys/class/gpio/gpio<PinNumber>/.
+ */
+SysfsBackend::SysfsBackend(unsigned int pin) : pinDirectoryDescriptor(-1), valueFileDescriptor(-1)
+{
+	/*
+	 * Create the path /sys/class/gpio/gpio<PinNumber>/. This gives access to the following attributes:
+	 *     - active_low
+	 *     - direction
+	 *     - edge
+	 *     - label
+	 *     - uevent
+	 *     - value
+	 */
+	this->gpioPinPath = GpioBase::getGpioPath() + "gpio" + to_string(pin) + "/";
+
+	//Configure the selected pin as a GPIO pin and export it, unless that was already done (e.g. by configureAll()).
+	GpioBase::configureAll({pin});
+
+	/*
+	 * Keep the pin directory and the "value" file open. The attribute files are opened
+	 * relative to the directory, and the value is written/read with pwrite()/pread()
+	 * so that toggling a pin does not open, close or allocate anything.
+	 */
+	this->pinDirectoryDescriptor = open(this->gpioPinPath.c_str(), O_RDONLY | O_DIRECTORY);
+	if(this->pinDirectoryDescriptor == -1)
+	{
+		perror(("SysfsBackend - Failed to open the GPIO directory: " + this->gpioPinPath).c_str());
+	}
+	else
+	{
+		this->valueFileDescriptor = openat(this->pinDirectoryDescriptor, "value", O_RDWR | O_NONBLOCK);
+		if(this->valueFileDescriptor == -1)
+		{
+			perror(("SysfsBackend - Failed to open the GPIO value file: " + this->gpioPinPath + "value").c_str());
+		}
+	}
+}
+
+
+/*
+ * Description:
+ *	Updates the value of the selected GPIO pin.
+ *
+ * Args:
+ *	GPIO_VALUE The new value of the selected GPIO pin
+ *
+ * Return
+ * 	None
+ */
+void SysfsBackend::setValue(const VALUE GPIO_VALUE) const
+{
+	//A single byte written at the start of the already open "value" file: same as echo <VALUE> > value
+	if(pwrite(this->valueFileDescriptor, &VALUE_CHARACTERS[(int)GPIO_VALUE], 1, 0) != 1)
+	{
+		perror("SysfsBackend::setValue - Failed to write the GPIO value file: pwrite()");
+	}
+}
+
+/*
+ * Description:
+ *	Reads the current value of the selected GPIO pin.
+ *
+ * Args:
+ *	None
+ *
+ * Return
+ * 	The value of the selected GPIO pin (LOW if the value file could not be read)
+ */
+GpioBase::VALUE SysfsBackend::getValue(void) const
+{
+	VALUE value = VALUE::LOW;
+
+	if(!readValue(value))
+	{
+		perror("SysfsBackend::getValue - Failed to read the GPIO value file: pread()");
+	}
+
+	return value;
+}
+
+/*
+ * Description:
+ *	Reads the current value of the selected GPIO pin without reporting errors.
+ *
+ * Args:
+ *	value Updated with the value of the pin if it could be read
+ *
+ * Return
+ * 	True if the value file could be read
+ */
+bool SysfsBackend::readValue(VALUE &value) const
+{
+	char valueCharacter;
+
+	if(pread(this->valueFileDescriptor, &valueCharacter, 1, 0) != 1)
+	{
+		return false;
+	}
+
+	value = (valueCharacter == VALUE_CHARACTERS[(int)VALUE::HIGH]) ? VALUE::HIGH : VALUE::LOW;
+	return true;
+}
+
+/*
+ * Description:
+ *	Updates the direction of the selected GPIO pin.
+ *
+ * Args:
+ *	GPIO_DIRECTION The new direction for the selected GPIO pin
+ *
+ * Return
+ * 	None
+ */
+void SysfsBackend::setDirection(const DIRECTION GPIO_DIRECTION) const
+{
+	const char *directionValue;
+
+	switch(GPIO_DIRECTION)
+	{
+	case DIRECTION::INPUT:
+		directionValue = "in";
+		break;
+	case DIRECTION::OUTPUT:
+		directionValue = "out";
+		break;
+	default:
+		directionValue = "out";
+		break;
+	}
+
+	writeToFile("direction", directionValue);
+}
+
+void SysfsBackend::setEdge(const EDGE GPIO_EDGE) const
+{
+	const char *edgeValue;
+
+	switch(GPIO_EDGE)
+	{
+	case EDGE::NONE:
+		edgeValue = "none";
+		break;
+	case EDGE::RISING:
+		edgeValue = "rising";
+		break;
+	case EDGE::FALLING:
+		edgeValue = "falling";
+		break;
+	case EDGE::BOTH:
+		edgeValue = "both";
+		break;
+	default:
+		edgeValue = "none";
+		break;
+	}
+
+	writeToFile("edge", edgeValue);
+}
+
+/*
+ * Description:
+ *	Writes specified value to a file in the pin directory.
+ *
+ * Args:
+ *	FILE_NAME The file to write to
+ *	VALUE The value to write into the file
+ *
+ * Return
+ * 	True if the file was opened
+ */
+bool SysfsBackend::writeToFile(const char *FILE_NAME, const char *VALUE) const
+{
+	//Open the file /sys/class/gpio/gpio<PinNumber>/<FILE_NAME> for writing
+	int fileDescriptor = openat(this->pinDirectoryDescriptor, FILE_NAME, O_WRONLY | O_TRUNC);
+
+	bool fileIsOpen = (fileDescriptor != -1);
+
+	if(fileIsOpen)
+	{
+		// same as: echo <VALUE> > <FILE_NAME>
+		if(write(fileDescriptor, VALUE, strlen(VALUE)) == -1)
+		{
+			perror(("Failed to write file: " + this->gpioPinPath + FILE_NAME).c_str());
+		}
+		close(fileDescriptor);
+	}
+	else
+	{
+		perror(("FailedTo open file for writing: " + this->gpioPinPath + FILE_NAME).c_str());
+	}
+
+	return fileIsOpen;
+}
+
+/*
+ * Destructor
+ */
+SysfsBackend::~SysfsBackend()
+{
+	if(this->valueFileDescriptor != -1)
+	{
+		close(this->valueFileDescriptor);
+	}
+
+	if(this->pinDirectoryDescriptor != -1)
+	{
+		close(this->pinDirectoryDescriptor);
+	}
+}
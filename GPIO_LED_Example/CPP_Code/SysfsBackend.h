@@ -0,0 +1,48 @@
+#ifndef H_SYSFS_BACKEND_H_
+#define H_SYSFS_BACKEND_H_
+
+#include <string>
+#include <stdint.h>
+
+#include "GpioBase.h"
+
+/*
+ * GPIO backend that goes through /sys/class/gpio/gpio<PinNumber>/. The pin
+ * directory and the "value" file are kept open, and the value file is also the
+ * descriptor edges are reported on.
+ *
+ * setValue()/getValue() are a single pwrite()/pread() at offset 0 of the pin's own
+ * value descriptor, with no shared file offset, so they can be called from several
+ * threads at once.
+ */
+class SysfsBackend
+{
+public:
+	typedef GpioBase::DIRECTION DIRECTION;
+	typedef GpioBase::VALUE VALUE;
+	typedef GpioBase::EDGE EDGE;
+
+	SysfsBackend(unsigned int pin);
+	~SysfsBackend();
+
+	SysfsBackend(const SysfsBackend &) = delete;
+	SysfsBackend &operator=(const SysfsBackend &) = delete;
+
+	void setValue(const VALUE GPIO_VALUE) const;
+	VALUE getValue(void) const;
+	bool readValue(VALUE &value) const;
+	void setDirection(const DIRECTION GPIO_DIRECTION) const;
+	void setEdge(const EDGE GPIO_EDGE) const;
+	bool setDebounce(const uint64_t) const { return false; } //No hardware debouncer through sysfs
+
+	int getEdgeFileDescriptor(void) const { return valueFileDescriptor; }
+
+private:
+	string gpioPinPath;
+	int pinDirectoryDescriptor; //Kept open so the attribute files can be opened without building paths
+	int valueFileDescriptor;    //Kept open for the lifetime of the pin, see setValue() and getValue()
+
+	bool writeToFile(const char *FILE_NAME, const char *VALUE) const;
+};
+
+#endif /* H_SYSFS_BACKEND_H_ */
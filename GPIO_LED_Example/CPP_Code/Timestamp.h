@@ -0,0 +1,36 @@
+#ifndef H_TIMESTAMP_H_
+#define H_TIMESTAMP_H_
+
+#include <errno.h>
+#include <stdint.h>
+#include <time.h>
+
+/*
+ * Description:
+ * 	Read CLOCK_MONOTONIC in nanoseconds. Used to timestamp edges and measure latencies.
+ */
+inline uint64_t monotonicTimeNs(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return ((uint64_t)now.tv_sec * 1000000000ULL) + (uint64_t)now.tv_nsec;
+}
+
+/*
+ * Description:
+ * 	Sleep until CLOCK_MONOTONIC reaches DEADLINE_NS, a time read with monotonicTimeNs().
+ * 	Absolute deadlines do not drift when a periodic loop is late.
+ */
+inline void sleepUntilNs(const uint64_t DEADLINE_NS)
+{
+	struct timespec deadline;
+	deadline.tv_sec = DEADLINE_NS / 1000000000ULL;
+	deadline.tv_nsec = DEADLINE_NS % 1000000000ULL;
+
+	while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR)
+	{
+	}
+}
+
+#endif /* H_TIMESTAMP_H_ */
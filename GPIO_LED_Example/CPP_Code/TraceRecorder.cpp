@@ -0,0 +1,435 @@
+#include <algorithm>
+#include <bitset>
+#include <map>
+#include <thread>
+#include <vector>
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "TraceRecorder.h"
+#include "MemMap.h"
+#include "PinTable.h"
+
+static const char TRACE_MAGIC[8] = {'G', 'P', 'I', 'O', 'T', 'R', 'C', '1'};
+
+atomic<bool> TraceRecorder::recording(false);
+atomic<unsigned int> TraceRecorder::writers(0);
+
+void *TraceRecorder::mapping = MAP_FAILED;
+size_t TraceRecorder::mappingSize = 0;
+TraceFileHeader *TraceRecorder::header = nullptr;
+TraceRecord *TraceRecorder::records = nullptr;
+uint64_t TraceRecorder::mask = 0;
+
+/*
+ * Description:
+ * 	Create traceFile (or truncate it) to hold a TraceFileHeader and capacity records,
+ * 	map it and start recording into it. The whole file is written once here, so the
+ * 	records never fault a page in.
+ *
+ * Args:
+ * 	traceFile Where to record the trace
+ * 	capacity The number of records kept, rounded up to a power of two
+ *
+ * Return
+ * 	False if a recording is already running or the file could not be mapped
+ */
+bool TraceRecorder::start(const string &traceFile, size_t capacity)
+{
+	if(isRecording() || mapping != MAP_FAILED)
+	{
+		cout << "ERROR: TraceRecorder - A recording is already running" << endl;
+		return false;
+	}
+
+	uint64_t roundedCapacity = 1;
+	while(roundedCapacity < capacity)
+	{
+		roundedCapacity <<= 1;
+	}
+
+	const size_t SIZE = sizeof(TraceFileHeader) + roundedCapacity * sizeof(TraceRecord);
+
+	int fileDescriptor = open(traceFile.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if(fileDescriptor == -1)
+	{
+		perror(("TraceRecorder::start - Failed to open the trace file: " + traceFile).c_str());
+		return false;
+	}
+
+	void *fileMapping = MAP_FAILED;
+
+	if(ftruncate(fileDescriptor, SIZE) == 0)
+	{
+		fileMapping = mmap(nullptr, SIZE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fileDescriptor, 0);
+	}
+	else
+	{
+		perror(("TraceRecorder::start - Failed to size the trace file: " + traceFile).c_str());
+	}
+
+	close(fileDescriptor); //The mapping keeps the file
+
+	if(fileMapping == MAP_FAILED)
+	{
+		perror("TraceRecorder::start - Failed to map the trace file: mmap()");
+		return false;
+	}
+
+	//A file mapping is only populated for pages already in the page cache, so touch every page.
+	memset(fileMapping, 0, SIZE);
+
+	mapping = fileMapping;
+	mappingSize = SIZE;
+	header = static_cast<TraceFileHeader*>(fileMapping);
+	records = reinterpret_cast<TraceRecord*>(header + 1);
+	mask = roundedCapacity - 1;
+
+	struct timespec realTime;
+	clock_gettime(CLOCK_REALTIME, &realTime);
+
+	memcpy(header->magic, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+	header->capacity = roundedCapacity;
+	header->recordCount.store(0, memory_order_relaxed);
+	header->startTimeNs = monotonicTimeNs();
+	header->startRealTimeNs = ((uint64_t)realTime.tv_sec * 1000000000ULL) + (uint64_t)realTime.tv_nsec;
+
+	recording.store(true);
+
+	return true;
+}
+
+/*
+ * Description:
+ * 	Stop recording, wait for the records being appended, write the file back and
+ * 	unmap it. The file stays behind for exportVcd().
+ *
+ * Return
+ * 	The number of records appended, including the ones overwritten
+ */
+uint64_t TraceRecorder::stop(void)
+{
+	if(mapping == MAP_FAILED)
+	{
+		return 0;
+	}
+
+	recording.store(false);
+
+	//A thread that saw recording set before it was cleared is counted in writers
+	while(writers.load() != 0)
+	{
+		this_thread::yield();
+	}
+
+	const uint64_t RECORD_COUNT = header->recordCount.load();
+
+	if(msync(mapping, mappingSize, MS_SYNC) == -1)
+	{
+		perror("TraceRecorder::stop - Failed to write the trace file back: msync()");
+	}
+
+	munmap(mapping, mappingSize);
+
+	mapping = MAP_FAILED;
+	mappingSize = 0;
+	header = nullptr;
+	records = nullptr;
+	mask = 0;
+
+	return RECORD_COUNT;
+}
+
+/*
+ * Description:
+ * 	Claim the next record of the ring and fill it in. The sequence number is stored
+ * 	last, so a reader can tell a record that was still being written from a complete one.
+ */
+void TraceRecorder::append(const TYPE RECORD_TYPE, const unsigned int PIN, const unsigned int OFFSET, const uint32_t VALUE, const uint64_t TIMESTAMP_NS)
+{
+	writers.fetch_add(1);
+
+	//stop() may have cleared recording since the caller looked, and then it may be unmapping
+	if(recording.load())
+	{
+		const uint64_t INDEX = header->recordCount.fetch_add(1, memory_order_relaxed);
+		TraceRecord &record = records[INDEX & mask];
+
+		record.timestampNs = TIMESTAMP_NS;
+		record.value = VALUE;
+		record.offset = (uint16_t)OFFSET;
+		record.type = (uint8_t)RECORD_TYPE;
+		record.pin = (uint8_t)PIN;
+
+		atomic_ref<uint64_t>(record.sequence).store(INDEX + 1, memory_order_release);
+	}
+
+	writers.fetch_sub(1, memory_order_release);
+}
+
+/* ************************************************************************
+ * VCD export
+ * ************************************************************************/
+
+/* A signal of the dump: a pin (1 bit) or a register of a bank (32 bits) */
+struct VcdSignal
+{
+	string name;
+	unsigned int width;
+	string identifier;
+};
+
+/* Signals are keyed by GPIO number, registers after all the pins */
+static const uint32_t REGISTER_KEY = 0x10000;
+
+static uint32_t registerKey(const unsigned int BANK_INDEX, const unsigned int OFFSET)
+{
+	return REGISTER_KEY | (BANK_INDEX << 12) | (OFFSET & 0xFFF);
+}
+
+static string pinSignalName(const unsigned int PIN)
+{
+	string name = "gpio" + to_string(PIN);
+
+	if(PIN < GPIO_COUNT && getPinDescriptor(PIN).headerName != nullptr)
+	{
+		string headerName = getPinDescriptor(PIN).headerName;
+		replace(headerName.begin(), headerName.end(), '.', '_');
+		name += "_" + headerName;
+	}
+
+	return name;
+}
+
+static string registerSignalName(const unsigned int BANK_INDEX, const unsigned int OFFSET)
+{
+	for(const MemMap::SnapshotRegister &REGISTER : MemMap::SNAPSHOT_REGISTERS)
+	{
+		if(REGISTER.offset == OFFSET)
+		{
+			return "gpio" + to_string(BANK_INDEX) + "_" + REGISTER.name;
+		}
+	}
+
+	char hexOffset[8];
+	snprintf(hexOffset, sizeof(hexOffset), "%03X", OFFSET);
+
+	return "gpio" + to_string(BANK_INDEX) + "_0x" + hexOffset;
+}
+
+/* VCD identifiers are strings of the printable characters '!' to '~' */
+static string vcdIdentifier(unsigned int index)
+{
+	string identifier;
+
+	do
+	{
+		identifier += (char)('!' + index % 94);
+		index /= 94;
+	}
+	while(index != 0);
+
+	return identifier;
+}
+
+static bool isDataOutWrite(const TraceRecord &RECORD)
+{
+	return RECORD.offset == GPIO_SETDATAOUT_OFFSET || RECORD.offset == GPIO_CLEARDATAOUT_OFFSET;
+}
+
+/*
+ * Description:
+ * 	Read the trace file traceFile back: the records still in the ring that were
+ * 	written completely, sorted by time. Records that were overwritten or left
+ * 	incomplete are skipped.
+ *
+ * Args:
+ * 	traceFile A file recorded with start()
+ * 	trace Filled in with the start of the recording and the records
+ *
+ * Return
+ * 	False if the file could not be read or is not a trace
+ */
+bool TraceRecorder::read(const string &traceFile, TraceFile &trace)
+{
+	int fileDescriptor = open(traceFile.c_str(), O_RDONLY);
+	if(fileDescriptor == -1)
+	{
+		perror(("TraceRecorder::read - Failed to open the trace file: " + traceFile).c_str());
+		return false;
+	}
+
+	struct stat fileStatus;
+	void *fileMapping = MAP_FAILED;
+
+	if(fstat(fileDescriptor, &fileStatus) == 0 && (size_t)fileStatus.st_size >= sizeof(TraceFileHeader))
+	{
+		fileMapping = mmap(nullptr, fileStatus.st_size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	}
+
+	close(fileDescriptor);
+
+	if(fileMapping == MAP_FAILED)
+	{
+		cout << "ERROR: TraceRecorder - " << traceFile << " could not be mapped or is too small" << endl;
+		return false;
+	}
+
+	const TraceFileHeader *FILE_HEADER = static_cast<const TraceFileHeader*>(fileMapping);
+	const uint64_t CAPACITY = FILE_HEADER->capacity;
+
+	if(memcmp(FILE_HEADER->magic, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0 || CAPACITY == 0 || (CAPACITY & (CAPACITY - 1)) != 0 ||
+	   (size_t)fileStatus.st_size != sizeof(TraceFileHeader) + CAPACITY * sizeof(TraceRecord))
+	{
+		cout << "ERROR: TraceRecorder - " << traceFile << " is not a trace file" << endl;
+		munmap(fileMapping, fileStatus.st_size);
+		return false;
+	}
+
+	const TraceRecord *FILE_RECORDS = reinterpret_cast<const TraceRecord*>(FILE_HEADER + 1);
+
+	trace.recordCount = FILE_HEADER->recordCount.load();
+	trace.startTimeNs = FILE_HEADER->startTimeNs;
+	trace.startRealTimeNs = FILE_HEADER->startRealTimeNs;
+
+	//The last CAPACITY records, in the order they happened
+	trace.records.clear();
+	trace.records.reserve(min(trace.recordCount, CAPACITY));
+
+	for(uint64_t index = (trace.recordCount > CAPACITY) ? trace.recordCount - CAPACITY : 0; index < trace.recordCount; ++index)
+	{
+		const TraceRecord &RECORD = FILE_RECORDS[index & (CAPACITY - 1)];
+
+		if(RECORD.sequence == index + 1)
+		{
+			trace.records.push_back(RECORD);
+		}
+	}
+
+	munmap(fileMapping, fileStatus.st_size);
+
+	stable_sort(trace.records.begin(), trace.records.end(), [](const TraceRecord &A, const TraceRecord &B)
+	{
+		return A.timestampNs < B.timestampNs;
+	});
+
+	return true;
+}
+
+/*
+ * Description:
+ * 	Convert the trace file traceFile into a Value Change Dump, in ns since the start
+ * 	of the recording. Edges and setValue() calls drive the signal of their pin,
+ * 	SETDATAOUT/CLEARDATAOUT writes drive the signals of the pins they set or clear,
+ * 	and every other register written gets a 32 bit signal of its own.
+ *
+ * Args:
+ * 	traceFile A file recorded with start()
+ * 	output Where to write the dump
+ *
+ * Return
+ * 	The number of records converted, 0 if the file is not a trace
+ */
+size_t TraceRecorder::exportVcd(const string &traceFile, ostream &output)
+{
+	TraceFile trace;
+
+	if(!read(traceFile, trace))
+	{
+		return 0;
+	}
+
+	const vector<TraceRecord> &events = trace.records;
+	const uint64_t START_TIME_NS = trace.startTimeNs;
+	const time_t START_SECONDS = (time_t)(trace.startRealTimeNs / 1000000000ULL);
+
+	//Every signal the records drive
+	map<uint32_t, VcdSignal> signals;
+
+	for(const TraceRecord &EVENT : events)
+	{
+		if((TYPE)EVENT.type != TYPE::REGISTER_WRITE)
+		{
+			signals[EVENT.pin] = {pinSignalName(EVENT.pin), 1, ""};
+		}
+		else if(isDataOutWrite(EVENT))
+		{
+			for(unsigned int bit = 0; bit < 32; ++bit)
+			{
+				if(EVENT.value & (1U << bit))
+				{
+					signals[EVENT.pin * 32 + bit] = {pinSignalName(EVENT.pin * 32 + bit), 1, ""};
+				}
+			}
+		}
+		else
+		{
+			signals[registerKey(EVENT.pin, EVENT.offset)] = {registerSignalName(EVENT.pin, EVENT.offset), 32, ""};
+		}
+	}
+
+	char date[64] = "";
+	strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", localtime(&START_SECONDS));
+
+	output << "$date " << date << " $end" << endl;
+	output << "$version GPIO TraceRecorder $end" << endl;
+	output << "$timescale 1ns $end" << endl;
+	output << "$scope module gpio $end" << endl;
+
+	unsigned int signalIndex = 0;
+	for(pair<const uint32_t, VcdSignal> &signal : signals)
+	{
+		signal.second.identifier = vcdIdentifier(signalIndex++);
+		output << "$var wire " << signal.second.width << " " << signal.second.identifier << " " << signal.second.name << " $end" << endl;
+	}
+
+	output << "$upscope $end" << endl << "$enddefinitions $end" << endl << "$dumpvars" << endl;
+
+	for(const pair<const uint32_t, VcdSignal> &SIGNAL : signals)
+	{
+		output << (SIGNAL.second.width == 1 ? "x" : "bx ") << SIGNAL.second.identifier << endl;
+	}
+
+	output << "$end" << endl;
+
+	uint64_t lastTimeNs = UINT64_MAX;
+
+	for(const TraceRecord &EVENT : events)
+	{
+		//An edge is timestamped when its thread woke up, which may be just before the recording started
+		const uint64_t TIME_NS = (EVENT.timestampNs > START_TIME_NS) ? EVENT.timestampNs - START_TIME_NS : 0;
+
+		if(TIME_NS != lastTimeNs)
+		{
+			output << "#" << TIME_NS << endl;
+			lastTimeNs = TIME_NS;
+		}
+
+		if((TYPE)EVENT.type != TYPE::REGISTER_WRITE)
+		{
+			output << (EVENT.value ? '1' : '0') << signals[EVENT.pin].identifier << endl;
+		}
+		else if(isDataOutWrite(EVENT))
+		{
+			const char LEVEL = (EVENT.offset == GPIO_SETDATAOUT_OFFSET) ? '1' : '0';
+
+			for(unsigned int bit = 0; bit < 32; ++bit)
+			{
+				if(EVENT.value & (1U << bit))
+				{
+					output << LEVEL << signals[EVENT.pin * 32 + bit].identifier << endl;
+				}
+			}
+		}
+		else
+		{
+			output << "b" << bitset<32>(EVENT.value) << " " << signals[registerKey(EVENT.pin, EVENT.offset)].identifier << endl;
+		}
+	}
+
+	return events.size();
+}
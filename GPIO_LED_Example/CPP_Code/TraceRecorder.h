@@ -0,0 +1,119 @@
+#ifndef H_TRACE_RECORDER_H_
+#define H_TRACE_RECORDER_H_
+
+#include <atomic>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Timestamp.h"
+
+using namespace std;
+
+/* One traced event, as stored in the trace file */
+struct TraceRecord
+{
+	uint64_t timestampNs; //CLOCK_MONOTONIC time of the event
+	uint64_t sequence;    //Record number + 1, stored last: a record whose sequence does not match its slot is incomplete
+	uint32_t value;       //EDGE: the level after the edge, OUTPUT: the value written, REGISTER_WRITE: the register value
+	uint16_t offset;      //REGISTER_WRITE: the offset of the register in its bank
+	uint8_t type;         //TraceRecorder::TYPE
+	uint8_t pin;          //EDGE and OUTPUT: the GPIO number, REGISTER_WRITE: the bank
+};
+
+/* The start of a trace file, followed by capacity TraceRecord records */
+struct TraceFileHeader
+{
+	char magic[8];                 //"GPIOTRC1"
+	uint64_t capacity;             //Number of records in the file, a power of two
+	atomic<uint64_t> recordCount;  //Records written so far, record i is at (i & (capacity - 1))
+	uint64_t startTimeNs;          //CLOCK_MONOTONIC time the recording started
+	uint64_t startRealTimeNs;      //CLOCK_REALTIME time the recording started
+};
+
+/* A trace file read back by TraceRecorder::read() */
+struct TraceFile
+{
+	uint64_t startTimeNs;         //CLOCK_MONOTONIC time the recording started
+	uint64_t startRealTimeNs;     //CLOCK_REALTIME time the recording started
+	uint64_t recordCount;         //Records written, including the overwritten ones
+	vector<TraceRecord> records;  //The complete records left in the file, in time order
+};
+
+/*
+ * Flight recorder for field units: every edge seen by GpioBase::pollEdge(), every
+ * GPIO::setValue() and every MemMap::registerWrite() is appended as a fixed-size
+ * TraceRecord to a trace file.
+ *
+ * The file is created at its full size, memory-mapped and prefaulted by start(),
+ * so appending a record is a few stores into memory: the hot path never makes a
+ * system call and the kernel writes the pages back on its own. The file is a ring,
+ * once it is full the oldest records are overwritten, so it always holds the
+ * latest capacity events. A unit that crashes leaves the trace behind in the file.
+ *
+ * When no recording is running, tracing costs one relaxed load and a branch.
+ * Records may be appended from any number of threads.
+ *
+ * read() gives the records of a trace file back, e.g. to TraceReplay. exportVcd()
+ * (or the TRACE2VCD tool, "make trace2vcd") converts a trace file into a Value
+ * Change Dump that GTKWave opens: one signal per traced pin, and one 32 bit signal
+ * per register written other than SETDATAOUT/CLEARDATAOUT.
+ */
+class TraceRecorder
+{
+public:
+	enum class TYPE : uint8_t
+	{
+		EDGE           = 1,
+		OUTPUT         = 2,
+		REGISTER_WRITE = 3
+	};
+
+	static bool start(const string &traceFile, size_t capacity);
+	static uint64_t stop(void);
+
+	static inline bool isRecording(void) { return recording.load(memory_order_relaxed); }
+
+	static inline void recordEdge(const unsigned int PIN, const uint32_t LEVEL, const uint64_t TIMESTAMP_NS)
+	{
+		if(isRecording())
+		{
+			append(TYPE::EDGE, PIN, 0, LEVEL, TIMESTAMP_NS);
+		}
+	}
+
+	static inline void recordOutput(const unsigned int PIN, const uint32_t VALUE)
+	{
+		if(isRecording())
+		{
+			append(TYPE::OUTPUT, PIN, 0, VALUE, monotonicTimeNs());
+		}
+	}
+
+	static inline void recordRegisterWrite(const unsigned int BANK_INDEX, const unsigned int OFFSET, const uint32_t VALUE)
+	{
+		if(isRecording())
+		{
+			append(TYPE::REGISTER_WRITE, BANK_INDEX, OFFSET, VALUE, monotonicTimeNs());
+		}
+	}
+
+	static bool read(const string &traceFile, TraceFile &trace);
+	static size_t exportVcd(const string &traceFile, ostream &output);
+
+private:
+	static atomic<bool> recording;
+	static atomic<unsigned int> writers; //Threads appending right now, stop() waits for them before unmapping
+
+	static void *mapping;
+	static size_t mappingSize;
+	static TraceFileHeader *header;
+	static TraceRecord *records;
+	static uint64_t mask;
+
+	static void append(const TYPE RECORD_TYPE, const unsigned int PIN, const unsigned int OFFSET, const uint32_t VALUE, const uint64_t TIMESTAMP_NS);
+};
+
+#endif /* H_TRACE_RECORDER_H_ */
@@ -0,0 +1,406 @@
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <random>
+#include <thread>
+#include <math.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "TraceReplay.h"
+#include "TraceRecorder.h"
+#include "GPIO.h"
+#include "FakeBackend.h"
+#include "GpioEventLoop.h"
+#include "EdgeSubscription.h"
+#include "PinTable.h"
+#include "Timestamp.h"
+
+/* How long run() waits for the edge path to deliver the last edges */
+static const uint64_t DRAIN_TIMEOUT_NS = 100000000ULL;
+
+/* An edge of the trace, scheduled at OFFSET_NS from the start of the replay */
+struct Injection
+{
+	uint64_t offsetNs;
+	unsigned int pinIndex;
+	GpioBase::VALUE level;
+};
+
+/* An edge taken up by the edge path: when its thread woke up, and when it reached the handler */
+struct Delivery
+{
+	uint64_t wakeupNs;
+	uint64_t deliveredNs;
+};
+
+static uint64_t cpuTimeNs(const clockid_t CLOCK)
+{
+	struct timespec now;
+	clock_gettime(CLOCK, &now);
+
+	return ((uint64_t)now.tv_sec * 1000000000ULL) + (uint64_t)now.tv_nsec;
+}
+
+/*
+ * Description:
+ * 	Read the edges of a trace file recorded with TraceRecorder. Outputs and register
+ * 	writes are left out.
+ *
+ * Return
+ * 	The edges in time order, empty if the file could not be read
+ */
+vector<EdgeEvent> TraceReplay::load(const string &traceFile)
+{
+	vector<EdgeEvent> edges;
+	TraceFile trace;
+
+	if(!TraceRecorder::read(traceFile, trace))
+	{
+		return edges;
+	}
+
+	for(const TraceRecord &RECORD : trace.records)
+	{
+		if((TraceRecorder::TYPE)RECORD.type == TraceRecorder::TYPE::EDGE)
+		{
+			edges.push_back({RECORD.timestampNs, RECORD.pin, RECORD.value ? GpioBase::EDGE::RISING : GpioBase::EDGE::FALLING});
+		}
+	}
+
+	return edges;
+}
+
+/*
+ * Description:
+ * 	Make up a trace of random edges: arrivals of a Poisson process at RATE_HZ spread
+ * 	over gpioPins, each pin toggling from LOW. The generator is seeded with SEED and
+ * 	does not depend on the standard library's distributions, so the same arguments
+ * 	give the same trace on every machine.
+ *
+ * Args:
+ * 	gpioPins The pins the edges are spread over
+ * 	RATE_HZ The mean number of edges per second, over all the pins
+ * 	DURATION_NS The length of the trace
+ * 	SEED Seed of the generator
+ *
+ * Return
+ * 	The edges in time order, from timestamp 0
+ */
+vector<EdgeEvent> TraceReplay::synthesize(const vector<unsigned int> &gpioPins, const double RATE_HZ, const uint64_t DURATION_NS, const uint64_t SEED)
+{
+	vector<EdgeEvent> edges;
+
+	if(gpioPins.empty() || RATE_HZ <= 0)
+	{
+		return edges;
+	}
+
+	mt19937_64 generator(SEED);
+	vector<bool> high(gpioPins.size(), false);
+
+	edges.reserve((size_t)(RATE_HZ * (double)DURATION_NS / 1e9) + 1);
+
+	double timeNs = 0;
+
+	while(true)
+	{
+		//Exponential gap from a uniform in [0, 1), built from the top 53 bits
+		const double UNIFORM = (double)(generator() >> 11) / 9007199254740992.0;
+		timeNs += -log(1.0 - UNIFORM) * 1e9 / RATE_HZ;
+
+		if(timeNs >= (double)DURATION_NS)
+		{
+			break;
+		}
+
+		const size_t PIN = generator() % gpioPins.size();
+		high[PIN] = !high[PIN];
+
+		edges.push_back({(uint64_t)timeNs, gpioPins[PIN], high[PIN] ? GpioBase::EDGE::RISING : GpioBase::EDGE::FALLING});
+	}
+
+	return edges;
+}
+
+/*
+ * Description:
+ * 	Replay edges on FakeBackend inputs at SPEED times the speed of the trace, from
+ * 	the calling thread, and measure how the edge path copes. Each pin starts at the
+ * 	opposite of its first edge. An edge (BOTH flips the level) that would not change
+ * 	the level of its pin is skipped.
+ *
+ * Args:
+ * 	edges The trace, in time order
+ * 	EDGE_PATH Which edge path takes the edges
+ * 	SPEED 1.0 replays at the speed of the trace, 2.0 twice as fast
+ *
+ * Return
+ * 	Drops, latency and CPU time of the replay
+ */
+TraceReplay::Report TraceReplay::run(const vector<EdgeEvent> &edges, const PATH EDGE_PATH, const double SPEED)
+{
+	Report report;
+	memset(&report, 0, sizeof(report));
+
+	if(edges.empty() || SPEED <= 0)
+	{
+		cout << "ERROR: TraceReplay::run - The trace is empty or the speed is not positive" << endl;
+		return report;
+	}
+
+	//The pins of the trace and the schedule of the edges that change a level
+	vector<unsigned int> pins;
+	vector<int> pinIndices(GPIO_COUNT, -1);
+	vector<GpioBase::VALUE> levels;
+	vector<Injection> injections;
+	injections.reserve(edges.size());
+
+	const uint64_t FIRST_EDGE_NS = edges.front().timestampNs;
+
+	for(const EdgeEvent &EDGE : edges)
+	{
+		if(EDGE.pin >= GPIO_COUNT)
+		{
+			report.skipped++;
+			continue;
+		}
+
+		if(pinIndices[EDGE.pin] == -1)
+		{
+			pinIndices[EDGE.pin] = (int)pins.size();
+			pins.push_back(EDGE.pin);
+			levels.push_back((EDGE.edge == GpioBase::EDGE::FALLING) ? GpioBase::VALUE::HIGH : GpioBase::VALUE::LOW);
+		}
+
+		const unsigned int PIN_INDEX = pinIndices[EDGE.pin];
+		const GpioBase::VALUE LEVEL = (EDGE.edge == GpioBase::EDGE::RISING) ? GpioBase::VALUE::HIGH :
+									  (EDGE.edge == GpioBase::EDGE::FALLING) ? GpioBase::VALUE::LOW :
+									  (levels[PIN_INDEX] == GpioBase::VALUE::HIGH) ? GpioBase::VALUE::LOW : GpioBase::VALUE::HIGH;
+
+		if(LEVEL == levels[PIN_INDEX])
+		{
+			report.skipped++;
+			continue;
+		}
+
+		levels[PIN_INDEX] = LEVEL;
+		injections.push_back({(uint64_t)((double)(EDGE.timestampNs - FIRST_EDGE_NS) / SPEED), PIN_INDEX, LEVEL});
+	}
+
+	//Drive every pin to its starting level before it detects edges
+	for(size_t index = 0; index < pins.size(); ++index)
+	{
+		levels[index] = GpioBase::VALUE::LOW;
+
+		for(const Injection &INJECTION : injections)
+		{
+			if(INJECTION.pinIndex == index)
+			{
+				levels[index] = (INJECTION.level == GpioBase::VALUE::HIGH) ? GpioBase::VALUE::LOW : GpioBase::VALUE::HIGH;
+				break;
+			}
+		}
+
+		FakeBackend::setInput(pins[index], levels[index]);
+	}
+
+	vector<vector<uint64_t>> injectedNs(pins.size());
+	vector<vector<Delivery>> deliveries(pins.size());
+
+	for(const Injection &INJECTION : injections)
+	{
+		injectedNs[INJECTION.pinIndex].push_back(0);
+	}
+
+	for(size_t index = 0; index < pins.size(); ++index)
+	{
+		deliveries[index].reserve(injectedNs[index].size());
+		injectedNs[index].clear();
+	}
+
+	vector<unique_ptr<BasicGPIO<FakeBackend>>> inputs;
+	for(unsigned int pin : pins)
+	{
+		inputs.push_back(make_unique<BasicGPIO<FakeBackend>>(pin, GpioBase::DIRECTION::INPUT, GpioBase::EDGE::BOTH));
+	}
+
+	//POLL_EDGE: one subscription per pin. EVENT_LOOP: every pin on one loop, into one ring.
+	atomic<uint64_t> deliveredCount(0);
+	vector<EdgeSubscription> subscriptions;
+	GpioEventLoop eventLoop(GpioEventLoop::DEFAULT_MAX_EVENTS);
+	EdgeEventRing ring(injections.size() + pins.size());
+	thread loopThread;
+
+	if(EDGE_PATH == PATH::POLL_EDGE)
+	{
+		subscriptions.reserve(pins.size());
+
+		for(size_t index = 0; index < pins.size(); ++index)
+		{
+			vector<Delivery> &pinDeliveries = deliveries[index];
+
+			subscriptions.push_back(inputs[index]->triggerOnEdge([&pinDeliveries, &deliveredCount](unsigned int, GpioBase::VALUE, uint64_t timestampNs)
+			{
+				pinDeliveries.push_back({timestampNs, monotonicTimeNs()});
+				deliveredCount.fetch_add(1, memory_order_relaxed);
+			}));
+		}
+	}
+	else
+	{
+		for(unique_ptr<BasicGPIO<FakeBackend>> &input : inputs)
+		{
+			eventLoop.addPin(*input, ring);
+		}
+
+		loopThread = thread([&eventLoop]()
+		{
+			eventLoop.run();
+		});
+	}
+
+	usleep(50000); //Let the watching threads reach epoll_wait
+
+	const uint64_t PROCESS_CPU_START_NS = cpuTimeNs(CLOCK_PROCESS_CPUTIME_ID);
+	const uint64_t INJECTOR_CPU_START_NS = cpuTimeNs(CLOCK_THREAD_CPUTIME_ID);
+	const uint64_t START_NS = monotonicTimeNs();
+
+	for(const Injection &INJECTION : injections)
+	{
+		const uint64_t DEADLINE_NS = START_NS + INJECTION.offsetNs;
+
+		uint64_t now = monotonicTimeNs();
+		if(now < DEADLINE_NS)
+		{
+			sleepUntilNs(DEADLINE_NS);
+			now = monotonicTimeNs();
+		}
+
+		report.maxInjectionLateNs = max(report.maxInjectionLateNs, now - DEADLINE_NS);
+
+		injectedNs[INJECTION.pinIndex].push_back(now);
+		FakeBackend::setInput(pins[INJECTION.pinIndex], INJECTION.level);
+	}
+
+	const uint64_t INJECTION_END_NS = monotonicTimeNs();
+
+	//Coalesced edges are never delivered, so wait until nothing has come for a while
+	uint64_t lastCount = 0;
+	uint64_t lastProgressNs = monotonicTimeNs();
+
+	while(monotonicTimeNs() - lastProgressNs < DRAIN_TIMEOUT_NS)
+	{
+		const uint64_t COUNT = (EDGE_PATH == PATH::POLL_EDGE) ? deliveredCount.load(memory_order_relaxed) : ring.getPushedCount();
+
+		if(COUNT >= injections.size())
+		{
+			break;
+		}
+
+		if(COUNT != lastCount)
+		{
+			lastCount = COUNT;
+			lastProgressNs = monotonicTimeNs();
+		}
+
+		usleep(1000);
+	}
+
+	const uint64_t INJECTOR_CPU_NS = cpuTimeNs(CLOCK_THREAD_CPUTIME_ID) - INJECTOR_CPU_START_NS;
+	const uint64_t PROCESS_CPU_NS = cpuTimeNs(CLOCK_PROCESS_CPUTIME_ID) - PROCESS_CPU_START_NS;
+
+	if(EDGE_PATH == PATH::POLL_EDGE)
+	{
+		for(EdgeSubscription &subscription : subscriptions)
+		{
+			subscription.cancel();
+		}
+	}
+	else
+	{
+		eventLoop.stop();
+		loopThread.join();
+
+		vector<EdgeEvent> events(ring.size());
+		const size_t RECEIVED = ring.drain(events.data(), events.size());
+
+		for(size_t index = 0; index < RECEIVED; ++index)
+		{
+			deliveries[pinIndices[events[index].pin]].push_back({events[index].timestampNs, events[index].timestampNs});
+		}
+	}
+
+	/*
+	 * Each delivery is matched to the oldest edge of its pin injected before its thread
+	 * woke up. The other edges injected before that wakeup were taken up by it: dropped.
+	 */
+	vector<uint64_t> latencies;
+	latencies.reserve(injections.size());
+
+	uint64_t lastDeliveryNs = INJECTION_END_NS;
+
+	for(size_t index = 0; index < pins.size(); ++index)
+	{
+		const vector<uint64_t> &INJECTED = injectedNs[index];
+		size_t edge = 0;
+
+		for(const Delivery &DELIVERY : deliveries[index])
+		{
+			if(edge == INJECTED.size())
+			{
+				break;
+			}
+
+			if(INJECTED[edge] > DELIVERY.wakeupNs)
+			{
+				continue;
+			}
+
+			latencies.push_back(DELIVERY.deliveredNs - INJECTED[edge]);
+			lastDeliveryNs = max(lastDeliveryNs, DELIVERY.deliveredNs);
+
+			for(++edge; edge < INJECTED.size() && INJECTED[edge] <= DELIVERY.wakeupNs; ++edge)
+			{
+				report.dropped++;
+			}
+		}
+
+		report.dropped += INJECTED.size() - edge;
+	}
+
+	sort(latencies.begin(), latencies.end());
+
+	report.edges = injections.size();
+	report.delivered = latencies.size();
+	report.durationNs = lastDeliveryNs - START_NS;
+	report.injectedRateHz = (INJECTION_END_NS > START_NS) ? (double)report.edges * 1e9 / (double)(INJECTION_END_NS - START_NS) : 0;
+	report.cpuNsPerEdge = (PROCESS_CPU_NS > INJECTOR_CPU_NS) ? (double)(PROCESS_CPU_NS - INJECTOR_CPU_NS) / (double)report.edges : 0;
+
+	if(!latencies.empty())
+	{
+		double total = 0;
+		for(uint64_t latency : latencies)
+		{
+			total += (double)latency;
+		}
+
+		report.meanNs = total / (double)latencies.size();
+		report.p50Ns = latencies[(latencies.size() - 1) / 2];
+		report.p99Ns = latencies[(size_t)((latencies.size() - 1) * 0.99)];
+		report.p999Ns = latencies[(size_t)((latencies.size() - 1) * 0.999)];
+		report.maxNs = latencies.back();
+	}
+
+	return report;
+}
+
+void TraceReplay::print(const char *name, const Report &report)
+{
+	cout << name << ": " << report.delivered << "/" << report.edges << " edges delivered (" << report.dropped << " dropped, "
+		 << report.skipped << " skipped) at " << (uint64_t)report.injectedRateHz << " edges/s, latency mean " << report.meanNs
+		 << " ns, p50 " << report.p50Ns << " ns, p99 " << report.p99Ns << " ns, p999 " << report.p999Ns << " ns, max "
+		 << report.maxNs << " ns, " << report.cpuNsPerEdge << " ns CPU/edge, injection up to "
+		 << report.maxInjectionLateNs << " ns late" << endl;
+}
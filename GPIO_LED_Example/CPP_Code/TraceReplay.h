@@ -0,0 +1,59 @@
+#ifndef H_TRACE_REPLAY_H_
+#define H_TRACE_REPLAY_H_
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "EdgeEventRing.h"
+
+/*
+ * Load generator for the edge path, without hardware. A trace of edges (recorded
+ * by TraceRecorder, or synthesized from a seed) is replayed on FakeBackend inputs:
+ * every edge signals the pin's eventfd, the stand-in for its sysfs value file, at
+ * the time it happened in the trace divided by a speed factor. The edges are taken
+ * by one of the two edge paths:
+ *     - POLL_EDGE  a triggerOnEdge() subscription per pin, each on its own
+ *                  pollEdge() thread, delivering to a handler
+ *     - EVENT_LOOP one GpioEventLoop thread watching every pin, pushing into an
+ *                  EdgeEventRing
+ *
+ * The same trace and seed always inject the same edges in the same order, so a
+ * change to the edge path can be load-tested against the previous version. Edges
+ * are matched to their delivery per pin: an edge injected before the previous one
+ * was taken up is coalesced into the same wakeup, and counted as dropped.
+ */
+class TraceReplay
+{
+public:
+	enum class PATH
+	{
+		POLL_EDGE  = 0,
+		EVENT_LOOP = 1
+	};
+
+	struct Report
+	{
+		uint64_t edges;              //Edges injected
+		uint64_t delivered;          //Edges delivered on their own
+		uint64_t dropped;            //Edges coalesced into the delivery of another one, or never delivered
+		uint64_t skipped;            //Trace edges that did not change the level of their pin
+		uint64_t durationNs;         //First injection to the last delivery
+		double injectedRateHz;       //Edges injected per second
+		double meanNs;               //Injection to delivery (POLL_EDGE: the handler, EVENT_LOOP: the loop's wakeup)
+		uint64_t p50Ns;
+		uint64_t p99Ns;
+		uint64_t p999Ns;
+		uint64_t maxNs;
+		uint64_t maxInjectionLateNs; //Worst lateness of an injection compared to the trace
+		double cpuNsPerEdge;         //CPU time of the edge path per injected edge, the injecting thread left out
+	};
+
+	static vector<EdgeEvent> load(const string &traceFile);
+	static vector<EdgeEvent> synthesize(const vector<unsigned int> &gpioPins, const double RATE_HZ, const uint64_t DURATION_NS, const uint64_t SEED = 1);
+
+	static Report run(const vector<EdgeEvent> &edges, const PATH EDGE_PATH, const double SPEED = 1.0);
+	static void print(const char *name, const Report &report);
+};
+
+#endif /* H_TRACE_REPLAY_H_ */
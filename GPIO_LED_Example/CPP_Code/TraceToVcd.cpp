@@ -0,0 +1,47 @@
+/*
+ * This program converts a trace file recorded by TraceRecorder into a Value
+ * Change Dump, so the edges and writes of a field unit can be opened in GTKWave.
+ * It does not touch any GPIO, so it runs on any machine the trace is copied to.
+ *
+ * Usage: TRACE2VCD trace_file [vcd_file]
+ * The dump is written to stdout when no vcd_file is given.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <string>
+
+#include "TraceRecorder.h"
+
+using namespace std;
+
+int main(int argc, char *argv[])
+{
+	if(argc < 2)
+	{
+		cerr << "Usage: " << argv[0] << " trace_file [vcd_file]" << endl;
+		return EXIT_FAILURE;
+	}
+
+	size_t converted = 0;
+
+	if(argc > 2)
+	{
+		ofstream vcdFile(argv[2]);
+		if(!vcdFile)
+		{
+			cerr << "ERROR: TraceToVcd - Failed to create " << argv[2] << endl;
+			return EXIT_FAILURE;
+		}
+
+		converted = TraceRecorder::exportVcd(argv[1], vcdFile);
+	}
+	else
+	{
+		converted = TraceRecorder::exportVcd(argv[1], cout);
+	}
+
+	cerr << converted << " records converted" << endl;
+
+	return (converted > 0) ? 0 : EXIT_FAILURE;
+}
@@ -0,0 +1,276 @@
+#include <algorithm>
+#include <sched.h>
+
+#include "WaveformPlayer.h"
+#include "CpuAffinity.h"
+#include "Timestamp.h"
+
+/* The number of stores timed by calibrate() */
+static const unsigned int CALIBRATION_ROUNDS = 1001;
+
+/*
+ * Description:
+ * 	Allocate both stream buffers and the error log up front, and calibrate.
+ *
+ * Args:
+ * 	memmap The mapped GPIO banks the waveform is played on
+ * 	bufferSteps The number of steps each of the two stream buffers holds
+ * 	errorLogSteps The number of steps whose timing error is kept, see getStepErrors()
+ */
+WaveformPlayer::WaveformPlayer(MemMap &memmap, size_t bufferSteps, size_t errorLogSteps) : memmap(memmap),
+	bufferSteps(bufferSteps), leadNs(0), submitIndex(0), playIndex(0), finished(false), errorLogSteps(errorLogSteps), errorSum(0)
+{
+	for(Buffer &buffer : this->buffers)
+	{
+		buffer.steps.reset(new WaveformStep[bufferSteps]);
+		buffer.count = 0;
+		buffer.ready.store(false, memory_order_relaxed);
+	}
+
+	this->stepErrors.reserve(errorLogSteps);
+
+	resetStatistics();
+	calibrate();
+}
+
+/*
+ * Description:
+ *	Measure how long issuing a store and reading the clock back takes on this
+ *	mapping, and use the median as the lead with which steps are issued. The stores
+ *	write 0 to SETDATAOUT, which changes nothing.
+ *
+ * Return
+ * 	The lead, in ns
+ */
+uint64_t WaveformPlayer::calibrate(void)
+{
+	uint64_t durations[CALIBRATION_ROUNDS];
+
+	for(unsigned int round = 0; round < CALIBRATION_ROUNDS; ++round)
+	{
+		const uint64_t START = monotonicTimeNs();
+		this->memmap.write(MemMap::BANK::GPIO0, GPIO_SETDATAOUT_OFFSET, 0);
+		durations[round] = monotonicTimeNs() - START;
+	}
+
+	nth_element(durations, durations + CALIBRATION_ROUNDS / 2, durations + CALIBRATION_ROUNDS);
+	this->leadNs = durations[CALIBRATION_ROUNDS / 2];
+
+	return this->leadNs;
+}
+
+/*
+ * Description:
+ *	Play a waveform held by the caller, from start to end, on the calling thread.
+ *
+ * Args:
+ *	steps The waveform
+ *	COUNT The number of steps
+ *	CPU The core to play on, or -1 to stay where the thread is
+ *
+ * Return
+ * 	False if there was nothing to play
+ */
+bool WaveformPlayer::play(const WaveformStep *steps, const size_t COUNT, const int CPU)
+{
+	if(steps == nullptr || COUNT == 0)
+	{
+		return false;
+	}
+
+	ScopedCpuAffinity affinity(CPU);
+
+	resetStatistics();
+	playSteps(steps, COUNT, monotonicTimeNs());
+	this->statistics.bufferCount = 1;
+
+	return true;
+}
+
+/*
+ * Description:
+ *	Producer side of streaming: copy the next part of the waveform into the free
+ *	buffer, waiting for run() to finish playing it if both are full.
+ *
+ * Args:
+ *	steps The next steps of the waveform
+ *	COUNT The number of steps, at most getBufferSteps()
+ *
+ * Return
+ * 	False if the steps do not fit in a buffer
+ */
+bool WaveformPlayer::submit(const WaveformStep *steps, const size_t COUNT)
+{
+	if(COUNT > this->bufferSteps)
+	{
+		cout << "ERROR: WaveformPlayer::submit - " << COUNT << " steps do not fit in a buffer of " << this->bufferSteps << endl;
+		return false;
+	}
+
+	Buffer &buffer = this->buffers[this->submitIndex];
+
+	while(buffer.ready.load(memory_order_acquire))
+	{
+		sched_yield();
+	}
+
+	copy(steps, steps + COUNT, buffer.steps.get());
+	buffer.count = COUNT;
+	buffer.ready.store(true, memory_order_release);
+
+	this->submitIndex = (this->submitIndex + 1) % BUFFERS;
+
+	return true;
+}
+
+/*
+ * Description:
+ *	Producer side of streaming: no more buffers will be submitted, run() returns
+ *	once the ones already submitted have been played.
+ */
+void WaveformPlayer::finish(void)
+{
+	this->finished.store(true, memory_order_release);
+}
+
+/*
+ * Description:
+ *	Consumer side of streaming: play the submitted buffers in order until finish()
+ *	is called and every buffer has been played. Runs on the calling thread.
+ *
+ * Args:
+ *	CPU The core to play on, or -1 to stay where the thread is
+ *
+ * Return
+ * 	None
+ */
+void WaveformPlayer::run(const int CPU)
+{
+	ScopedCpuAffinity affinity(CPU);
+
+	resetStatistics();
+
+	uint64_t deadline = 0; //0 until the first step is played (and again after an underrun)
+
+	while(true)
+	{
+		Buffer &buffer = this->buffers[this->playIndex];
+
+		if(!buffer.ready.load(memory_order_acquire))
+		{
+			//Submitted buffers are marked ready before finish() is called, so check finished first.
+			while(!this->finished.load(memory_order_acquire) && !buffer.ready.load(memory_order_acquire))
+			{
+				sched_yield();
+			}
+
+			if(!buffer.ready.load(memory_order_acquire))
+			{
+				break;
+			}
+
+			if(deadline != 0)
+			{
+				this->statistics.underrunCount++;
+				deadline = 0;
+			}
+		}
+
+		if(deadline == 0)
+		{
+			deadline = monotonicTimeNs();
+		}
+
+		deadline = playSteps(buffer.steps.get(), buffer.count, deadline);
+
+		buffer.ready.store(false, memory_order_release);
+		this->playIndex = (this->playIndex + 1) % BUFFERS;
+		this->statistics.bufferCount++;
+	}
+
+	this->finished.store(false, memory_order_relaxed);
+}
+
+void WaveformPlayer::resetStatistics(void)
+{
+	this->statistics.stepCount = 0;
+	this->statistics.bufferCount = 0;
+	this->statistics.underrunCount = 0;
+	this->statistics.meanErrorNs = 0;
+	this->statistics.minErrorNs = 0;
+	this->statistics.maxErrorNs = 0;
+	this->errorSum = 0;
+	this->stepErrors.clear();
+}
+
+/*
+ * Description:
+ *	Issue every step at its deadline (minus the calibrated lead), spinning on the
+ *	clock in between. The clock read right after a store both measures the step's
+ *	error and starts the wait for the next step.
+ *
+ * Return
+ * 	The deadline of the last step, where the next buffer continues from
+ */
+uint64_t WaveformPlayer::playSteps(const WaveformStep *steps, const size_t COUNT, uint64_t deadline)
+{
+	const uint64_t LEAD_NS = this->leadNs;
+	uint64_t now = monotonicTimeNs();
+
+	for(size_t index = 0; index < COUNT; ++index)
+	{
+		const WaveformStep &STEP = steps[index];
+
+		deadline += STEP.deltaNs;
+
+		while(now + LEAD_NS < deadline)
+		{
+			now = monotonicTimeNs();
+		}
+
+		if(STEP.setMask != 0)
+		{
+			this->memmap.write(STEP.bank, GPIO_SETDATAOUT_OFFSET, STEP.setMask);
+		}
+
+		if(STEP.clearMask != 0)
+		{
+			this->memmap.write(STEP.bank, GPIO_CLEARDATAOUT_OFFSET, STEP.clearMask);
+		}
+
+		now = monotonicTimeNs();
+
+		const int64_t ERROR = (int64_t)(now - deadline);
+
+		this->errorSum += ERROR;
+
+		if(this->statistics.stepCount == 0 || ERROR < this->statistics.minErrorNs)
+		{
+			this->statistics.minErrorNs = ERROR;
+		}
+
+		if(this->statistics.stepCount == 0 || ERROR > this->statistics.maxErrorNs)
+		{
+			this->statistics.maxErrorNs = ERROR;
+		}
+
+		if(this->stepErrors.size() < this->errorLogSteps)
+		{
+			this->stepErrors.push_back((int32_t)ERROR);
+		}
+
+		this->statistics.stepCount++;
+	}
+
+	this->statistics.meanErrorNs = (this->statistics.stepCount == 0) ? 0 :
+		(double)this->errorSum / (double)this->statistics.stepCount;
+
+	return deadline;
+}
+
+/*
+ * Destructor
+ */
+WaveformPlayer::~WaveformPlayer()
+{
+}
@@ -0,0 +1,98 @@
+#ifndef H_WAVEFORM_PLAYER_H_
+#define H_WAVEFORM_PLAYER_H_
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "MemMap.h"
+
+/* One edge of a waveform: DELTA_NS after the previous step, set then clear bits of a bank */
+struct WaveformStep
+{
+	uint32_t deltaNs;      //Time from the previous step (or from the start of playback)
+	MemMap::BANK bank;
+	uint32_t setMask;      //Written to SETDATAOUT when not 0
+	uint32_t clearMask;    //Written to CLEARDATAOUT when not 0
+};
+
+/*
+ * Replays precomputed output waveforms (WS2812 bit streams, stepper pulse trains,
+ * ...) through the SETDATAOUT/CLEARDATAOUT registers of the mapped banks.
+ *
+ * Steps are issued by a thread spinning on the clock, ideally alone on its core.
+ * The time a store plus a clock read takes is measured once (calibrate()) and the
+ * stores are issued that much early. Deadlines accumulate from the start of
+ * playback, so late steps do not push the rest of the waveform back.
+ *
+ * Long patterns are streamed through two buffers: while run() plays one, the
+ * producer fills the other with submit(). The waveform continues without a gap
+ * as long as the next buffer is ready in time, otherwise the underrun is counted
+ * and the timeline restarts when it arrives.
+ */
+class WaveformPlayer
+{
+public:
+	struct Statistics
+	{
+		uint64_t stepCount;
+		uint64_t bufferCount;
+		uint64_t underrunCount; //Buffers that were not ready when the previous one ended
+		double meanErrorNs;     //Mean of (time the store completed - scheduled time)
+		int64_t minErrorNs;     //Earliest step (negative when issued before its time)
+		int64_t maxErrorNs;     //Latest step
+	};
+
+	WaveformPlayer(MemMap &memmap, size_t bufferSteps, size_t errorLogSteps = 0);
+	~WaveformPlayer();
+
+	WaveformPlayer(const WaveformPlayer &) = delete;
+	WaveformPlayer &operator=(const WaveformPlayer &) = delete;
+
+	uint64_t calibrate(void);
+	uint64_t getLeadNs(void) const { return leadNs; }
+
+	bool play(const WaveformStep *steps, const size_t COUNT, const int CPU = -1);
+
+	bool submit(const WaveformStep *steps, const size_t COUNT);
+	void finish(void);
+	void run(const int CPU = -1);
+
+	const Statistics &getStatistics(void) const { return statistics; }
+	const vector<int32_t> &getStepErrors(void) const { return stepErrors; }
+
+	size_t getBufferSteps(void) const { return bufferSteps; }
+
+private:
+	static const unsigned int BUFFERS = 2;
+	static const size_t CACHE_LINE_SIZE = 64;
+
+	struct Buffer
+	{
+		unique_ptr<WaveformStep[]> steps;
+		size_t count;
+		alignas(CACHE_LINE_SIZE) atomic<bool> ready; //Filled by the producer, not yet played
+	};
+
+	MemMap &memmap;
+	size_t bufferSteps;
+	uint64_t leadNs;
+
+	Buffer buffers[BUFFERS];
+	unsigned int submitIndex; //Next buffer the producer fills
+	unsigned int playIndex;   //Next buffer run() plays
+	atomic<bool> finished;
+
+	vector<int32_t> stepErrors; //Error of the first errorLogSteps steps, preallocated
+	size_t errorLogSteps;
+
+	Statistics statistics;
+	int64_t errorSum;
+
+	void resetStatistics(void);
+	uint64_t playSteps(const WaveformStep *steps, const size_t COUNT, uint64_t deadline);
+};
+
+#endif /* H_WAVEFORM_PLAYER_H_ */
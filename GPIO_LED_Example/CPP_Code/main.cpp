@@ -4,19 +4,52 @@
 
 #include<iostream>
 #include<unistd.h>
+#include<atomic>
+#include<thread>
+#include<limits>
+#include<fstream>
 
 #include "GPIO.h"
+#include "RegisterBackend.h"
 #include "MemMap.h"
+#include "GpioEventLoop.h"
+#include "PinGroup.h"
+#include "Pin.h"
+#include "SampleCapture.h"
+#include "WaveformPlayer.h"
+#include "SoftSpi.h"
+#include "SoftI2c.h"
+#include "LatencySelfTest.h"
+#include "EdgeStatistics.h"
+#include "EdgeWorkerPool.h"
+#include "EdgeReactor.h"
+#include "EdgeCounter.h"
+#include "PulseCapture.h"
+#include "TraceRecorder.h"
+#include "TraceReplay.h"
+#include "OutputScheduler.h"
 
 using namespace std;
 
-void ledTest(void);
-void buttonTest(void);
+template<typename BACKEND> void ledTest(void);
+template<typename BACKEND> void buttonTest(void);
 void i2cTest(void);
 void pwmTest(void);
 void spiTest(void);
 void analogTest(void);
 void registerWRTest(void);
+void eventLoopTest(void);
+void edgeRingTest(void);
+void pinGroupTest(void);
+void captureTest(void);
+void waveformTest(void);
+void latencyTest(void);
+void sequenceTest(void);
+void counterTest(void);
+void pulseTest(void);
+void traceTest(void);
+void replayTest(void);
+void schedulerTest(void);
 
 void activateLed(void);
 
@@ -29,6 +62,20 @@ enum TEST
 	TEST_SPI,
 	TEST_ANALOG,
 	TEST_REGISTER_WR,
+	TEST_EVENT_LOOP,
+	TEST_EDGE_RING,
+	TEST_PIN_GROUP,
+	TEST_GPIO_LED_REGISTER,
+	TEST_GPIO_BUTTON_REGISTER,
+	TEST_CAPTURE,
+	TEST_WAVEFORM,
+	TEST_LATENCY,
+	TEST_SEQUENCE,
+	TEST_COUNTER,
+	TEST_PULSE,
+	TEST_TRACE,
+	TEST_REPLAY,
+	TEST_SCHEDULER,
 	TEST_NUM
 };
 
@@ -37,13 +84,27 @@ void (*test[TEST_NUM]) (void);
 int main()
 {
 	unsigned int testNumber = 0;
-	test[TEST_GPIO_LED] = ledTest;
-	test[TEST_GPIO_BUTTON] = buttonTest;
+	test[TEST_GPIO_LED] = ledTest<SysfsBackend>;
+	test[TEST_GPIO_BUTTON] = buttonTest<SysfsBackend>;
 	test[TEST_I2C] = i2cTest;
 	test[TEST_PWM] = pwmTest;
 	test[TEST_SPI] = spiTest;
 	test[TEST_ANALOG] = analogTest;
 	test[TEST_REGISTER_WR] = registerWRTest;
+	test[TEST_EVENT_LOOP] = eventLoopTest;
+	test[TEST_EDGE_RING] = edgeRingTest;
+	test[TEST_PIN_GROUP] = pinGroupTest;
+	test[TEST_GPIO_LED_REGISTER] = ledTest<RegisterBackend>;
+	test[TEST_GPIO_BUTTON_REGISTER] = buttonTest<RegisterBackend>;
+	test[TEST_CAPTURE] = captureTest;
+	test[TEST_WAVEFORM] = waveformTest;
+	test[TEST_LATENCY] = latencyTest;
+	test[TEST_SEQUENCE] = sequenceTest;
+	test[TEST_COUNTER] = counterTest;
+	test[TEST_PULSE] = pulseTest;
+	test[TEST_TRACE] = traceTest;
+	test[TEST_REPLAY] = replayTest;
+	test[TEST_SCHEDULER] = schedulerTest;
 
 	while(true)
 	{
@@ -55,6 +116,20 @@ int main()
 		cout << "SPI Test:         " << TEST_SPI << endl;
 		cout << "Analog Test:      " << TEST_ANALOG << endl;
 		cout << "Register WR Test: " << TEST_REGISTER_WR << endl;
+		cout << "Event Loop Test:  " << TEST_EVENT_LOOP << endl;
+		cout << "Edge Ring Test:   " << TEST_EDGE_RING << endl;
+		cout << "Pin Group Test:   " << TEST_PIN_GROUP << endl;
+		cout << "GPIO LED Test (registers):    " << TEST_GPIO_LED_REGISTER << endl;
+		cout << "GPIO Button Test (registers): " << TEST_GPIO_BUTTON_REGISTER << endl;
+		cout << "Capture Test:     " << TEST_CAPTURE << endl;
+		cout << "Waveform Test:    " << TEST_WAVEFORM << endl;
+		cout << "Latency Test:     " << TEST_LATENCY << endl;
+		cout << "Sequence Test:    " << TEST_SEQUENCE << endl;
+		cout << "Counter Test:     " << TEST_COUNTER << endl;
+		cout << "Pulse Test:       " << TEST_PULSE << endl;
+		cout << "Trace Test:       " << TEST_TRACE << endl;
+		cout << "Replay Test:      " << TEST_REPLAY << endl;
+		cout << "Scheduler Test:   " << TEST_SCHEDULER << endl;
 		cout << "Exit:             " << TEST_NUM << endl;
 
 		cin >> testNumber;
@@ -72,11 +147,16 @@ int main()
 	return 0;
 }
 
+/*
+ * The GPIO tests are written once and run on any backend, e.g. ledTest<SysfsBackend>
+ * or ledTest<RegisterBackend>.
+ */
+template<typename BACKEND>
 void ledTest(void)
 {
 	cout << "Running GPIO LED Test" << endl;
 
-	GPIO led(49, GPIO::DIRECTION::OUTPUT);
+	BasicGPIO<BACKEND> led(49, GPIO::DIRECTION::OUTPUT);
 
 	for (int i = 0; i < 5; i++)
 	{
@@ -90,15 +170,32 @@ void ledTest(void)
 	cout << "Running GPIO LED Test Completed" << endl;
 }
 
+template<typename BACKEND>
 void buttonTest(void)
 {
 	cout << "Running GPIO Button Test" << endl;
-	GPIO button(115,
+	BasicGPIO<BACKEND> button(115,
 			    GPIO::DIRECTION::INPUT,
 			    GPIO::EDGE::RISING);
 
-	//button.inputWaitTimeMS = 10000; //10 seconds
-	button.triggerOnEdge(&activateLed);
+	button.setDebounce(50000000); //50 ms: one callback per press, however much the contact bounces
+
+	//The handler is told which pin, the level and when, and keeps its count in the lambda.
+	unsigned int presses = 0;
+	EdgeWorkerPool pool(1);
+
+	EdgeSubscription subscription = button.triggerOnEdge([&presses](unsigned int pin, GPIO::VALUE level, uint64_t timestampNs)
+	{
+		cout << "GPIO " << pin << (level == GPIO::VALUE::HIGH ? " HIGH" : " LOW") << " at " << timestampNs
+			 << " ns, press " << presses++ << endl;
+	}, &pool);
+
+	//triggerOnEdge() returned straight away, the pin is watched until the subscription is cancelled.
+	cout << "Press Enter to stop" << endl;
+	cin.ignore(numeric_limits<streamsize>::max(), '\n');
+	cin.get();
+
+	subscription.cancel();
 
 	cout << "Running GPIO Button Test Completed" << endl;
 }
@@ -113,6 +210,34 @@ void i2cTest(void)
 {
 	cout << "Running I2C Test" << endl;
 
+	//I2C1 on P9.17 (SCL) and P9.18 (SDA), bit-banged as GPIOs. The lines need pull-ups.
+	const unsigned int SCL = "p9.17"_pin;
+	const unsigned int SDA = "p9.18"_pin;
+
+	GpioBase::configureAll({SCL, SDA});
+
+	MemMap memmap;
+	SoftI2c<> i2c(memmap, SCL, SDA, 100000);
+
+	if(!i2c.isValid())
+	{
+		return;
+	}
+
+	//Scan the bus for slaves
+	unsigned int found = 0;
+
+	for(uint8_t address = 0x08; address < 0x78; ++address)
+	{
+		if(i2c.probe(address))
+		{
+			cout << "Found a device at 0x" << hex << (unsigned int)address << dec << endl;
+			found++;
+		}
+	}
+
+	cout << found << " device(s) found" << endl;
+	cout << "I2C Test Completed" << endl;
 }
 
 void pwmTest(void)
@@ -125,6 +250,46 @@ void spiTest(void)
 {
 	cout << "Running SPI Test" << endl;
 
+	//SPI0 pins bit-banged as GPIOs: SCLK P9.22, D0 (MISO) P9.21, D1 (MOSI) P9.18, CS0 P9.17.
+	//Wire P9.18 to P9.21 to loop MOSI back to MISO.
+	const unsigned int SCK = "p9.22"_pin;
+	const unsigned int MISO = "p9.21"_pin;
+	const unsigned int MOSI = "p9.18"_pin;
+	const unsigned int CS = "p9.17"_pin;
+
+	GpioBase::configureAll({SCK, MISO, MOSI, CS});
+
+	MemMap memmap;
+	SoftSpi<> spi(memmap, SCK, MOSI, MISO, CS, SoftSpi<>::MODE::MODE0, 1000000);
+
+	if(!spi.isValid())
+	{
+		return;
+	}
+
+	uint8_t tx[256];
+	uint8_t rx[256];
+
+	for(unsigned int index = 0; index < sizeof(tx); ++index)
+	{
+		tx[index] = (uint8_t)index;
+	}
+
+	for(unsigned int mode = 0; mode < 4; ++mode)
+	{
+		spi.setMode((SoftSpi<>::MODE)mode);
+		spi.transfer(tx, rx);
+
+		unsigned int errors = 0;
+		for(unsigned int index = 0; index < sizeof(tx); ++index)
+		{
+			errors += (rx[index] != tx[index]) ? 1 : 0;
+		}
+
+		cout << "Mode " << mode << ": " << errors << " of " << sizeof(tx) << " bytes differ" << endl;
+	}
+
+	cout << "SPI Test Completed" << endl;
 }
 
 void analogTest(void)
@@ -139,9 +304,414 @@ void registerWRTest(void)
 
 	MemMap memmap;
 
+	const MemMap::Snapshot BEFORE = memmap.snapshot();
+
 	memmap.registerWrite(GPIO1_MEM_MAP_ADDR, GPIO_SETDATAOUT_OFFSET, (1 << 17));
+	cout << "GPIO1 DATAOUT: 0x" << hex << memmap.registerRead(GPIO1_MEM_MAP_ADDR, GPIO_DATAOUT_OFFSET) << dec << endl;
+
+	//Every register bit the write changed (OE if the pin was an input, DATAOUT, DATAIN)
+	cout << "Changed bits:" << endl;
+	MemMap::diff(BEFORE, memmap.snapshot()).print(cout);
+
 	sleep(2);
 	memmap.registerWrite(GPIO1_MEM_MAP_ADDR, GPIO_CLEARDATAOUT_OFFSET, (1 << 17));
 
+	//Same LED, with the bank and bit resolved at compile time from the header name
+	Pin<"p9.23"_pin> led(memmap);
+
+	led.setValue(GPIO::VALUE::HIGH);
+	sleep(2);
+	led.setValue(GPIO::VALUE::LOW);
+
 	cout << "Register W/R Test Completed" << endl;
-}
\ No newline at end of file
+}
+void eventLoopTest(void)
+{
+	cout << "Running GPIO Event Loop Test" << endl;
+
+	GPIO button(115,
+			    GPIO::DIRECTION::INPUT,
+			    GPIO::EDGE::RISING);
+
+	GpioEventLoop eventLoop;
+	eventLoop.addPin(button, &activateLed);
+
+	EdgeStatistics::startPeriodicDump(cout, 5000); //Print the edge counters every 5 seconds while the loop runs
+
+	eventLoop.run(10000); //Return once the button has not been pressed for 10 seconds
+
+	EdgeStatistics::stopPeriodicDump();
+	EdgeStatistics::snapshot().toText(cout);
+
+	cout << "GPIO Event Loop Test Completed" << endl;
+}
+
+void edgeRingTest(void)
+{
+	cout << "Running Edge Ring Test" << endl;
+
+	GPIO button(115,
+			    GPIO::DIRECTION::INPUT,
+			    GPIO::EDGE::BOTH);
+
+	EdgeEventRing ring(256);
+	atomic<bool> done(false);
+
+	//The printing happens here, away from the thread detecting the edges.
+	thread consumer([&]()
+	{
+		EdgeEvent batch[32];
+
+		while(!done || ring.size() > 0)
+		{
+			size_t count = ring.drain(batch, 32);
+
+			for(size_t index = 0; index < count; ++index)
+			{
+				cout << "GPIO " << batch[index].pin
+					 << (batch[index].edge == GPIO::EDGE::FALLING ? " RELEASED at " : " PRESSED at ")
+					 << batch[index].timestampNs << " ns" << endl;
+			}
+
+			if(count == 0)
+			{
+				usleep(1000);
+			}
+		}
+	});
+
+	GpioEventLoop eventLoop;
+	eventLoop.addPin(button, ring);
+
+	eventLoop.run(10000); //Return once the button has not been touched for 10 seconds
+
+	done = true;
+	consumer.join();
+
+	cout << "Edges dropped: " << ring.getDroppedCount() << endl;
+	cout << "Edge Ring Test Completed" << endl;
+}
+
+void pinGroupTest(void)
+{
+	cout << "Running Pin Group Test" << endl;
+
+	MemMap memmap;
+
+	//The four user LEDs USR0 - USR3 (GPIO1_21 - GPIO1_24), counted up in binary
+	PinGroup userLeds(memmap, {53, 54, 55, 56});
+
+	for(uint32_t count = 0; count < 16; ++count)
+	{
+		userLeds.write(count);
+		usleep(500000);
+	}
+
+	userLeds.write(0);
+
+	cout << "Pin Group Test Completed" << endl;
+}
+
+void captureTest(void)
+{
+	cout << "Running Capture Test" << endl;
+
+	MemMap memmap;
+
+	//Sample the button (P9.27) at 1 MHz for 5 seconds, press it a few times
+	SampleCapture capture(memmap, {115}, 4096);
+	capture.run(1000000, 5000000000ULL, 0);
+
+	const SampleCapture::Statistics &STATISTICS = capture.getStatistics();
+
+	cout << "Samples: " << STATISTICS.sampleCount << " at " << STATISTICS.achievedRateHz << " Hz (target "
+		 << STATISTICS.targetRateHz << " Hz), missed " << STATISTICS.missedSampleCount << endl;
+	cout << "Jitter: mean " << STATISTICS.meanJitterNs << " ns, max " << STATISTICS.maxJitterNs << " ns" << endl;
+
+	for(size_t index = 0; index < capture.size(); ++index)
+	{
+		const SampleTransition &TRANSITION = capture.getTransition(index);
+		cout << "Sample " << TRANSITION.sampleIndex << ": " << ((TRANSITION.levels[3] & (1U << 19)) ? "HIGH" : "LOW") << endl;
+	}
+
+	cout << "Capture Test Completed" << endl;
+}
+
+void waveformTest(void)
+{
+	cout << "Running Waveform Test" << endl;
+
+	MemMap memmap;
+	Pin<"p9.23"_pin> led(memmap);
+
+	//A stepper style pulse train on P9.23: 1000 pulses of 10 us every 100 us, twice over through the stream buffers
+	const size_t PULSES = 1000;
+	vector<WaveformStep> steps;
+
+	for(size_t pulse = 0; pulse < PULSES; ++pulse)
+	{
+		steps.push_back({90000, led.BANK, led.MASK, 0});
+		steps.push_back({10000, led.BANK, 0, led.MASK});
+	}
+
+	WaveformPlayer player(memmap, steps.size());
+
+	thread producer([&]()
+	{
+		player.submit(steps.data(), steps.size());
+		player.submit(steps.data(), steps.size());
+		player.finish();
+	});
+
+	player.run(0);
+	producer.join();
+
+	const WaveformPlayer::Statistics &STATISTICS = player.getStatistics();
+
+	cout << "Steps: " << STATISTICS.stepCount << ", underruns: " << STATISTICS.underrunCount
+		 << ", lead: " << player.getLeadNs() << " ns" << endl;
+	cout << "Timing error: mean " << STATISTICS.meanErrorNs << " ns, min " << STATISTICS.minErrorNs
+		 << " ns, max " << STATISTICS.maxErrorNs << " ns" << endl;
+
+	cout << "Waveform Test Completed" << endl;
+}
+
+void latencyTest(void)
+{
+	cout << "Running Latency Test" << endl;
+
+	LatencySelfTest::print("Default scheduling", LatencySelfTest::run(RealTimeProfile()));
+	LatencySelfTest::print("Real-time profile", LatencySelfTest::run(RealTimeProfile::lowLatency()));
+
+	cout << "Latency Test Completed" << endl;
+}
+
+/*
+ * Wait for the button, then for a pulse on the sensor input within 2 seconds, as
+ * straight-line code: every step is resumed by the reactor, with no callbacks or
+ * thread per step. Ends after 3 sequences or 10 seconds without a press.
+ */
+EdgeTask buttonThenPulse(GPIO &button, GPIO &sensor)
+{
+	for(unsigned int sequence = 0; sequence < 3; ++sequence)
+	{
+		if(!co_await button.edge(GPIO::EDGE::RISING, 10000000000ULL))
+		{
+			cout << "No button press within 10 seconds" << endl;
+			break;
+		}
+
+		cout << "Button pressed, waiting for the sensor" << endl;
+
+		WhenAnyResult first = co_await whenAny(sensor.edge(GPIO::EDGE::RISING),
+											   button.edge(GPIO::EDGE::RISING),
+											   EdgeReactor::sleepFor(2000000000ULL));
+
+		if(first.index == 0)
+		{
+			EdgeResult fall = co_await sensor.edge(GPIO::EDGE::FALLING, 1000000000ULL);
+
+			if(fall)
+			{
+				cout << "Sensor pulse of " << (fall.timestampNs - first.result.timestampNs) << " ns" << endl;
+			}
+			else
+			{
+				cout << "Sensor stuck high" << endl;
+			}
+		}
+		else if(first.index == 1)
+		{
+			cout << "Button pressed again, starting over" << endl;
+		}
+		else
+		{
+			cout << "No sensor pulse within 2 seconds" << endl;
+		}
+	}
+}
+
+void sequenceTest(void)
+{
+	cout << "Running Sequence Test" << endl;
+
+	GPIO button(115,
+			    GPIO::DIRECTION::INPUT,
+			    GPIO::EDGE::RISING);
+
+	GPIO sensor(117,
+			    GPIO::DIRECTION::INPUT,
+			    GPIO::EDGE::BOTH);
+
+	EdgeReactor reactor;
+	reactor.spawn(buttonThenPulse(button, sensor));
+	reactor.run();
+
+	cout << "Sequence Test Completed" << endl;
+}
+
+void counterTest(void)
+{
+	cout << "Running Counter Test" << endl;
+
+	//Pulse inputs, e.g. a flow meter on P9.27 and a fan tachometer on P9.25
+	const unsigned int FLOW = 115;
+	const unsigned int TACHOMETER = 117;
+
+	GpioBase::configureAll({FLOW, TACHOMETER});
+
+	MemMap memmap;
+	MemMap::Transaction(memmap).setInput(getPinDescriptor(FLOW).bank, getPinDescriptor(FLOW).mask)
+							   .setInput(getPinDescriptor(TACHOMETER).bank, getPinDescriptor(TACHOMETER).mask).commit();
+
+	//Rising edges latch in IRQSTATUS_RAW_0 and are collected every 20 us: no wakeup per pulse, up to 50 kHz per pin
+	EdgeCounter<> counter(memmap, {FLOW, TACHOMETER}, GpioBase::EDGE::RISING);
+	counter.start(20000);
+
+	for(unsigned int second = 0; second < 10; ++second)
+	{
+		sleep(1);
+
+		cout << "Flow: " << counter.getCount(FLOW) << " pulses, " << counter.getFrequencyHz(FLOW) << " Hz. "
+			 << "Tachometer: " << counter.getCount(TACHOMETER) << " pulses, " << counter.getFrequencyHz(TACHOMETER) << " Hz" << endl;
+	}
+
+	counter.stop();
+
+	cout << "Counter Test Completed" << endl;
+}
+
+void pulseTest(void)
+{
+	cout << "Running Pulse Test" << endl;
+
+	//Ultrasonic ranger (HC-SR04): trigger on P9.23, echo on P9.25 (through a 5V to 3.3V divider)
+	GPIO trigger(49, GPIO::DIRECTION::OUTPUT);
+	GPIO echo(117, GPIO::DIRECTION::INPUT, GPIO::EDGE::BOTH);
+
+	PulseCapture capture(echo, 64);
+
+	for(unsigned int ping = 0; ping < 20; ++ping)
+	{
+		trigger.setValue(GPIO::VALUE::HIGH);
+		usleep(10);
+		trigger.setValue(GPIO::VALUE::LOW);
+
+		usleep(100000);
+
+		//The echo is high for the round trip of the sound: 58 us per cm
+		PulseMeasurement latest;
+		if(capture.getLatest(latest) && latest.highNs != 0)
+		{
+			cout << "Distance: " << (double)latest.highNs / 58000.0 << " cm (echo " << latest.highNs / 1000 << " us)" << endl;
+		}
+		else
+		{
+			cout << "No echo" << endl;
+		}
+	}
+
+	const PulseCapture::Statistics STATISTICS = capture.getStatistics();
+
+	cout << "Echo over the last " << STATISTICS.high.samples << " pings: min " << STATISTICS.high.min / 1000
+		 << " us, mean " << STATISTICS.high.mean / 1000 << " us, p90 " << STATISTICS.high.p90 / 1000
+		 << " us, max " << STATISTICS.high.max / 1000 << " us, " << STATISTICS.missedEdges << " missed edges" << endl;
+
+	cout << "Pulse Test Completed" << endl;
+}
+
+void traceTest(void)
+{
+	cout << "Running Trace Test" << endl;
+
+	const string TRACE_FILE = "gpio_trace.bin";
+	const string VCD_FILE = "gpio_trace.vcd";
+
+	//The last million events are kept, 32 MB on disk
+	if(!TraceRecorder::start(TRACE_FILE, 1 << 20))
+	{
+		return;
+	}
+
+	//The LED on P9.23 follows the button on P9.27: both edges and every write are recorded
+	GPIO led(49, GPIO::DIRECTION::OUTPUT);
+	GPIO button(115, GPIO::DIRECTION::INPUT, GPIO::EDGE::BOTH);
+
+	EdgeSubscription subscription = button.triggerOnEdge([&led](unsigned int, GPIO::VALUE level, uint64_t)
+	{
+		led.setValue(level);
+	});
+
+	cout << "Press Enter to stop" << endl;
+	cin.ignore(numeric_limits<streamsize>::max(), '\n');
+	cin.get();
+
+	subscription.cancel();
+
+	cout << TraceRecorder::stop() << " events recorded into " << TRACE_FILE << endl;
+
+	//The same conversion as "TRACE2VCD gpio_trace.bin gpio_trace.vcd" on another machine
+	ofstream vcdFile(VCD_FILE);
+	cout << TraceRecorder::exportVcd(TRACE_FILE, vcdFile) << " events written to " << VCD_FILE << ", open it with GTKWave" << endl;
+
+	cout << "Trace Test Completed" << endl;
+}
+
+void replayTest(void)
+{
+	cout << "Running Replay Test" << endl;
+
+	//The edges recorded by the Trace Test, or else 1 second of 50k edges/s over 8 pins
+	vector<EdgeEvent> edges = TraceReplay::load("gpio_trace.bin");
+
+	if(edges.empty())
+	{
+		cout << "No recorded edges, replaying a synthetic burst" << endl;
+		edges = TraceReplay::synthesize({110, 111, 112, 113, 114, 115, 116, 117}, 50000.0, 1000000000ULL);
+	}
+
+	//Replayed on FakeBackend inputs: the pins of the board are not touched
+	TraceReplay::print("pollEdge()", TraceReplay::run(edges, TraceReplay::PATH::POLL_EDGE));
+	TraceReplay::print("GpioEventLoop", TraceReplay::run(edges, TraceReplay::PATH::EVENT_LOOP));
+
+	cout << "Replay Test Completed" << endl;
+}
+
+void schedulerTest(void)
+{
+	cout << "Running Scheduler Test" << endl;
+
+	MemMap memmap;
+	Pin<"p9.23"_pin> led(memmap);
+
+	//Changes falling in the same 1 ms tick are written together
+	OutputScheduler scheduler(memmap, 1000000, 64, 32);
+	scheduler.start();
+
+	//The LED blinks 10 times at 1 Hz, on for 200 ms, then stays on from 11 s to 12 s
+	const uint64_t START_NS = monotonicTimeNs() + 100000000;
+
+	scheduler.schedulePeriodic(49, START_NS, 1000000000, 200000000, 10);
+	scheduler.schedule(49, GpioBase::VALUE::HIGH, START_NS + 11000000000ULL);
+	scheduler.schedule(49, GpioBase::VALUE::LOW, START_NS + 12000000000ULL);
+
+	while(scheduler.getPendingCount() != 0)
+	{
+		sleep(1);
+	}
+
+	scheduler.stop();
+
+	const OutputScheduler::Statistics STATISTICS = scheduler.getStatistics();
+	const HistogramSnapshot LATENESS = scheduler.getLateness();
+
+	cout << STATISTICS.fired << " changes written in " << STATISTICS.stores << " stores, lateness mean "
+		 << LATENESS.getMean() / 1000 << " us, max " << LATENESS.getMax() / 1000 << " us" << endl;
+
+	for(const uint32_t LATE_NS : scheduler.getLatenessLog())
+	{
+		cout << LATE_NS / 1000 << " us ";
+	}
+
+	cout << endl << "Scheduler Test Completed" << endl;
+}